@@ -0,0 +1,198 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+
+#include "batch_eval.h"
+#include "nnue.h"
+
+using std::vector;
+
+namespace {
+
+// ---------- Tables
+// EVAL_TABLES flattened to one entry per (Color, PieceType, square), with
+// Black's values negated, so that the sums are White minus Black. The last
+// entry is 0, for empty slots.
+constexpr int BATCH_TABLE_SIZE =
+    COLORS_COUNT * PIECE_TYPES_COUNT * BOARD_SPACES + 1;
+constexpr int EMPTY_SLOT = BATCH_TABLE_SIZE - 1;
+
+struct BatchTables {
+    std::array<std::int32_t, BATCH_TABLE_SIZE> mg{};
+    std::array<std::int32_t, BATCH_TABLE_SIZE> eg{};
+};
+
+constexpr int tableIndex(Short c, Short pt, Square sq) {
+    return (c * PIECE_TYPES_COUNT + pt) * BOARD_SPACES + sq;
+}
+
+constexpr BatchTables makeBatchTables() {
+    BatchTables t;
+    for (Short c = 0; c < COLORS_COUNT; ++c) {
+        int sign = c == colorIndex(Color::White) ? 1 : -1;
+        for (Short pt = 0; pt < PIECE_TYPES_COUNT; ++pt) {
+            for (Square sq = 0; sq < BOARD_SPACES; ++sq) {
+                t.mg[tableIndex(c, pt, sq)] = sign * EVAL_TABLES.mg[c][pt][sq];
+                t.eg[tableIndex(c, pt, sq)] = sign * EVAL_TABLES.eg[c][pt][sq];
+            }
+        }
+    }
+    return t;
+}
+
+constexpr BatchTables BATCH_TABLES = makeBatchTables();
+
+// ---------- Vectors across positions
+// The compiler maps them to the widest instructions the build flags allow.
+#pragma GCC diagnostic ignored "-Wpsabi"
+using IntVec = std::int32_t __attribute__((vector_size(4 * BATCH_LANES)));
+
+// A block of positions, struct-of-arrays: Row s holds the table index of
+// the s-th Piece of each position.
+struct PositionBlock {
+    std::array<std::array<std::uint16_t, BATCH_LANES>, BOARD_SPACES> slots;
+    IntVec phase;
+    int slotCount; // Rows in use: The most Pieces of any position
+};
+
+// A PawnHashTable key: The Pawn bitboards, mixed. Only the tables of a
+// BatchEvaluator use it, so it need not match Board::pawnHash.
+Hash pawnKey(const PawnBitboards &pawns) {
+    auto mix = [](std::uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    };
+    return mix(pawns[0] + 0x9e3779b97f4a7c15ULL) ^ mix(~pawns[1]);
+}
+
+} // namespace
+
+// ========================================
+// BatchEvaluator
+
+// ---------- Constructor
+BatchEvaluator::BatchEvaluator(ThreadPool &pool, bool useNnue /* =true */)
+    : _poolP{&pool}, _useNnue{useNnue}, _pawnTables(pool.size())
+{}
+
+// ---------- Write methods
+void BatchEvaluator::evaluate(const Position *positions, std::size_t count,
+                              EvalValue *scores)
+{
+    std::size_t blockCount = (count + BATCH_LANES - 1) / BATCH_LANES;
+    _poolP->parallelFor(blockCount, [&](std::size_t block, Short worker) {
+        std::size_t first = block * BATCH_LANES;
+        int size = int(std::min<std::size_t>(BATCH_LANES, count - first));
+        _evaluateBlock(positions + first, size, scores + first, worker);
+    }, 16);
+}
+
+vector<EvalValue> BatchEvaluator::evaluate(const vector<Position> &positions)
+{
+    vector<EvalValue> scores(positions.size());
+    evaluate(positions.data(), positions.size(), scores.data());
+    return scores;
+}
+
+// ---------- Private write methods
+void BatchEvaluator::_evaluateBlock(const Position *positions, int count,
+                                    EvalValue *scores, Short worker)
+{
+    const Nnue *nnueP = _useNnue ? Nnue::active() : nullptr;
+    if (nnueP) {
+        NnueAccumulator acc;
+        int features[NNUE_MAX_FEATURES];
+        for (int k = 0; k < count; ++k) {
+            for (Color p : {Color::Black, Color::White}) {
+                int featureCount = nnueFeatures(positions[k], p, features);
+                assert(featureCount <= NNUE_MAX_FEATURES);
+                nnueP->refresh(acc, p, features, featureCount);
+            }
+            scores[k] = nnueP->evaluate(acc, positions[k].sideToMove());
+        }
+        return;
+    }
+
+    // Material and piece-square tables: Lay the block out, then sum each
+    // row across the positions.
+    PositionBlock block;
+    block.phase = IntVec{};
+    block.slotCount = 0;
+    for (auto &row : block.slots) {
+        row.fill(EMPTY_SLOT);
+    }
+    for (int k = 0; k < count; ++k) {
+        int slot = 0;
+        for (Short c = 0; c < COLORS_COUNT; ++c) {
+            for (Short pt = 0; pt < PIECE_TYPES_COUNT; ++pt) {
+                Bitboard bb = positions[k].pieces(Color(c), PieceType(pt));
+                block.phase[k] += popCount(bb) * PHASE_WEIGHTS[pt];
+                while (bb) {
+                    block.slots[slot++][k] = tableIndex(c, pt, popLsb(bb));
+                }
+            }
+        }
+        block.slotCount = std::max(block.slotCount, slot);
+    }
+    IntVec mg{};
+    IntVec eg{};
+    for (int s = 0; s < block.slotCount; ++s) {
+        IntVec mgRow;
+        IntVec egRow;
+        for (int lane = 0; lane < BATCH_LANES; ++lane) {
+            mgRow[lane] = BATCH_TABLES.mg[block.slots[s][lane]];
+            egRow[lane] = BATCH_TABLES.eg[block.slots[s][lane]];
+        }
+        mg += mgRow;
+        eg += egRow;
+    }
+    // taper(), across the positions
+    IntVec phaseMax = IntVec{} + PHASE_MAX;
+    IntVec phase = block.phase < phaseMax ? block.phase : phaseMax;
+    IntVec material = (mg * phase + eg * (phaseMax - phase)) / phaseMax;
+
+    // Pawn structure and mobility, per position
+    PawnHashTable &pawnTable = _pawnTables[worker];
+    for (int k = 0; k < count; ++k) {
+        const Position &pos = positions[k];
+        PieceBitboards pieces;
+        for (Short c = 0; c < COLORS_COUNT; ++c) {
+            for (Short pt = 0; pt < PIECE_TYPES_COUNT; ++pt) {
+                pieces[c][pt] = pos.pieces(Color(c), PieceType(pt));
+            }
+        }
+        Short pawn = static_cast<Short>(PieceType::Pawn);
+        PawnBitboards pawns{pieces[0][pawn], pieces[1][pawn]};
+        Hash key = pawnKey(pawns);
+        const PawnEntry *entry = pawnTable.probe(key);
+        if (!entry) {
+            entry = &pawnTable.store(evaluatePawns(key, pawns));
+        }
+        Color c = pos.sideToMove();
+        Short phaseK = Short(block.phase[k]);
+        EvalValue value = c == Color::White ? material[k] : -material[k];
+        value += entry->value(c, pos.kingSquare(Color::Black),
+                              pos.kingSquare(Color::White), phaseK);
+        value += evaluateMobility(c, pieces, phaseK);
+        scores[k] = value;
+    }
+}
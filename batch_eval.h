@@ -0,0 +1,65 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "eval.h"
+#include "position.h"
+#include "thread_pool.h"
+#include "util.h"
+
+// Positions per block: The lanes of the vector registers used across
+// positions.
+constexpr int BATCH_LANES = 8;
+
+// ========================================
+// BatchEvaluator
+//
+// Static evaluation of many positions at once (e.g., for an analysis
+// service), for throughput rather than latency. Blocks of BATCH_LANES
+// positions are split across the workers of a ThreadPool. Each block is laid
+// out struct-of-arrays style, with one row of table indexes per Piece slot
+// and one column per position, so that the material and piece-square sums
+// and the taper run across the positions in vector registers. The pawn
+// structure (cached in a PawnHashTable per worker) and mobility are computed
+// per position, and so is the NNUE input layer, with the SIMD kernels of
+// nnue.h across its accumulator.
+class BatchEvaluator {
+  public:
+    // ---------- Constructor
+    BatchEvaluator(ThreadPool &pool, bool useNnue = true);
+
+    // ---------- Write methods
+    // The static evaluation of each position, in centipawns, from the point
+    // of view of its side to move: What a Search with the same useNnue
+    // setting computes for it.
+    void evaluate(const Position *positions, std::size_t count,
+                  EvalValue *scores);
+    std::vector<EvalValue> evaluate(const std::vector<Position> &positions);
+
+  private:
+    // ---------- Private write methods
+    void _evaluateBlock(const Position *positions, int count,
+                        EvalValue *scores, Short worker);
+
+    ThreadPool *_poolP;
+    bool _useNnue;
+    std::vector<PawnHashTable> _pawnTables; // Per worker
+};
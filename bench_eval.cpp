@@ -0,0 +1,114 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <libgen.h>
+
+#include "batch_eval.h"
+#include "clock.h"
+#include "nnue.h"
+#include "position.h"
+#include "thread_pool.h"
+#include "util.h"
+
+using std::cerr, std::cout;
+using std::string, std::vector;
+
+// Positions from random games, each up to 80 plies long.
+vector<Position> mkPositions(std::size_t count) {
+    std::mt19937 gen{1};
+    vector<Position> positions{};
+    Position pos = *Position::fromFen(START_FEN);
+    Short ply = 0;
+    while (positions.size() < count) {
+        FastMoves moves;
+        pos.legalMoves(moves);
+        if (moves.empty() || ply == 80) {
+            pos = *Position::fromFen(START_FEN);
+            ply = 0;
+            continue;
+        }
+        PositionUndo undo;
+        pos.makeMove(moves[gen() % moves.size()], undo);
+        ++ply;
+        positions.push_back(pos);
+    }
+    return positions;
+}
+
+// Throughput of BatchEvaluator: Positions per second, evaluated as one batch,
+// and one at a time.
+int main(int argc, char **argv) {
+    string progname{basename(argv[0])};
+    vector<string> args(argv + 1, argv + argc);
+    string usage = "Usage: " + progname
+        + " [<positions> [<threads> [<network_file>]]]\n";
+    std::size_t count = 200'000;
+    Short threads = 0; // All hardware threads
+    try {
+        if (args.size() > 0) {
+            count = std::stoul(args[0]);
+        }
+        if (args.size() > 1) {
+            threads = std::stoi(args[1]);
+        }
+    } catch (std::exception &) {
+        cerr << progname << ": " << usage;
+        exit(1);
+    }
+    if (args.size() > 3) {
+        cerr << progname << ": " << usage;
+        exit(1);
+    }
+    if (args.size() == 3 && !Nnue::load(args[2])) {
+        cerr << progname << ": Cannot load network: " << args[2] << "\n";
+        exit(1);
+    }
+
+    vector<Position> positions = mkPositions(count);
+    ThreadPool pool{threads};
+    vector<EvalValue> scores(count);
+    auto measure = [&](const string &name, bool useNnue, bool isBatch) {
+        BatchEvaluator evaluator{pool, useNnue};
+        SteadyClock::time_point start = SteadyClock::now();
+        if (isBatch) {
+            evaluator.evaluate(positions.data(), count, scores.data());
+        } else {
+            for (std::size_t k = 0; k < count; ++k) {
+                evaluator.evaluate(&positions[k], 1, &scores[k]);
+            }
+        }
+        double ms = std::chrono::duration<double, std::milli>(
+                        SteadyClock::now() - start).count();
+        cout << name << (isBatch ? ", batch" : ", one at a time")
+             << ": positions/s=" << static_cast<long long>(count * 1000 / ms)
+             << "\n";
+    };
+    cout << "positions=" << count << ", threads=" << pool.size() << "\n";
+    measure("classical", false, true);
+    measure("classical", false, false);
+    if (Nnue::active()) {
+        cout << "simd=" << to_string(Nnue::simd()) << "\n";
+        measure("nnue", true, true);
+        measure("nnue", true, false);
+    }
+}
@@ -0,0 +1,82 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <libgen.h>
+
+#include "mcts.h"
+#include "position.h"
+#include "util.h"
+
+using std::cerr, std::cout;
+using std::string, std::vector;
+
+// Benchmark of tree-parallel MCTS: Playouts per second from the initial
+// position, for 1, 2, 4, ... worker threads.
+int main(int argc, char **argv) {
+    string progname{basename(argv[0])};
+    vector<string> args(argv + 1, argv + argc);
+    Short maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    long long iterations = 50'000;
+    try {
+        if (args.size() > 0) {
+            maxThreads = std::stoi(args[0]);
+        }
+        if (args.size() > 1) {
+            iterations = std::stoll(args[1]);
+        }
+    } catch (std::invalid_argument &ex) {
+        cerr << progname << ": Usage: " << progname
+             << " [<max_threads> [<iterations>]]\n";
+        exit(1);
+    }
+
+    vector<Short> threadCounts{};
+    for (Short threads = 1; threads < maxThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    Position pos = *Position::fromFen(START_FEN);
+    cout << "Hardware threads: " << std::thread::hardware_concurrency()
+         << ", iterations per run: " << iterations << "\n"
+         << "threads  playouts/s  playout_plies/s  speedup  tree_nodes\n";
+    double baseRate = 0.0;
+    for (Short threads : threadCounts) {
+        Mcts mcts{MctsConfig{iterations, 1.4, 200, threads}};
+        mcts.timeManager().startUnlimited();
+        mcts.search(pos);
+        const MctsStats &stats = mcts.stats();
+        double rate = stats.iterationsPerSec();
+        double plyRate = stats.elapsed.count() > 0
+            ? 1000.0 * stats.playoutPlies / stats.elapsed.count() : 0.0;
+        if (baseRate == 0.0) {
+            baseRate = rate;
+        }
+        cout << std::setw(7) << threads << std::setw(12)
+             << static_cast<long long>(rate) << std::setw(17)
+             << static_cast<long long>(plyRate) << std::setw(9)
+             << std::fixed << std::setprecision(2)
+             << (baseRate > 0 ? rate / baseRate : 0.0) << std::setw(12)
+             << stats.nodes << "\n";
+    }
+}
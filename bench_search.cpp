@@ -0,0 +1,128 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <libgen.h>
+
+#include "board.h"
+#include "move.h"
+#include "position.h"
+#include "search.h"
+#include "util.h"
+
+using std::cerr, std::cout;
+using std::string, std::vector;
+
+// Positions searched when no suite file is given
+const vector<string> DEFAULT_SUITE{
+    START_FEN,
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 1",
+    "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+    "8/8/4k3/3p4/3P4/4K3/8/8 w - - 0 1"};
+
+// Benchmark of the root drivers: Nodes (incl. quiescence nodes) and wall
+// time of aspiration PVS and of MTD(f), per position of a suite (one FEN per
+// line), with fresh tables for each search. Positions where the two drivers
+// disagree on the score are marked with '*'. Selective search makes some of
+// that expected: MTD(f) searches no PV nodes, so it prunes every node.
+int main(int argc, char **argv) {
+    string progname{basename(argv[0])};
+    vector<string> args(argv + 1, argv + argc);
+    Short depth = 4;
+    vector<string> suite{DEFAULT_SUITE};
+    try {
+        if (args.size() > 0) {
+            depth = std::stoi(args[0]);
+        }
+    } catch (std::invalid_argument &ex) {
+        cerr << progname << ": Usage: " << progname
+             << " [<depth> [<fen_file>]]\n";
+        exit(1);
+    }
+    if (args.size() > 1) {
+        std::ifstream ifs{args[1]};
+        if (!ifs) {
+            cerr << progname << ": Cannot read " << args[1] << "\n";
+            exit(1);
+        }
+        suite.clear();
+        for (string line; std::getline(ifs, line);) {
+            if (!line.empty()) {
+                suite.push_back(line);
+            }
+        }
+    }
+
+    cout << "depth=" << depth << ", positions=" << suite.size() << "\n"
+         << "  #       pvs_nodes  pvs_ms  pvs_score     mtdf_nodes  mtdf_ms"
+            "  mtdf_score  passes\n";
+    long long totalNodes[2] = {0, 0};
+    long long totalMillis[2] = {0, 0};
+    Short mismatches = 0;
+    for (std::size_t k = 0; k < suite.size(); ++k) {
+        std::optional<Position> oPos = Position::fromFen(suite[k]);
+        if (!oPos) {
+            cerr << progname << ": Unrecognized FEN: " << suite[k] << "\n";
+            continue;
+        }
+        cout << std::setw(3) << k + 1;
+        Score scores[2] = {0, 0};
+        for (bool useMtdf : {false, true}) {
+            Move::reset();
+            Board b = oPos->toBoard();
+            Search search{SearchConfig{depth, 18}};
+            search.config().useMtdf = useMtdf;
+            SearchResult result = search.search(b, oPos->sideToMove());
+            const SearchStats &stats = search.stats();
+            long long nodes = stats.nodes + stats.qnodes;
+            totalNodes[useMtdf] += nodes;
+            totalMillis[useMtdf] += result.elapsed.count();
+            scores[useMtdf] = result.score;
+            cout << std::setw(15) << nodes << std::setw(8)
+                 << result.elapsed.count() << std::setw(11) << result.score;
+            if (useMtdf) {
+                cout << std::setw(8) << stats.mtdfPasses;
+            }
+        }
+        if (scores[0] != scores[1]) {
+            ++mismatches;
+            cout << "  *";
+        }
+        cout << "\n";
+    }
+    cout << "total" << std::setw(13) << totalNodes[0] << std::setw(8)
+         << totalMillis[0] << std::setw(26) << totalNodes[1] << std::setw(8)
+         << totalMillis[1] << "\n"
+         << "mtdf/pvs: nodes " << std::fixed << std::setprecision(2)
+         << (totalNodes[0] > 0 ? double(totalNodes[1]) / totalNodes[0] : 0.0)
+         << ", time "
+         << (totalMillis[0] > 0 ? double(totalMillis[1]) / totalMillis[0]
+                                : 0.0)
+         << "\n";
+    if (mismatches > 0) {
+        cout << "score mismatches: " << mismatches << " of " << suite.size()
+             << " (*)\n";
+    }
+}
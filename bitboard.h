@@ -0,0 +1,190 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "geometry.h"
+#include "piece.h"
+#include "util.h"
+
+// ========================================
+// Bitboard
+
+// A set of squares: Bit i is the square with Pos index i (a1 = 0, b1 = 1, ...,
+// h8 = 63).
+using Bitboard = std::uint64_t;
+using Square = Short; // Pos index
+
+constexpr Square NO_SQUARE = -1;
+constexpr Short RAY_DIRS = 8; // N, NE, E, SE, S, SW, W, NW
+
+constexpr Bitboard squareBB(Square sq) { return Bitboard{1} << sq; }
+constexpr Col squareCol(Square sq) { return sq % BOARD_COLS; }
+constexpr Row squareRow(Square sq) { return sq / BOARD_COLS; }
+constexpr Square toSquare(Col x, Row y) { return x + BOARD_COLS * y; }
+constexpr Bitboard rowBB(Row y) { return Bitboard{0xff} << (BOARD_COLS * y); }
+constexpr Bitboard colBB(Col x) { return Bitboard{0x0101010101010101} << x; }
+constexpr Short colorIndex(Color c) { return static_cast<Short>(c); }
+
+inline Short popCount(Bitboard bb) { return __builtin_popcountll(bb); }
+// The lowest and highest squares in a non-empty set.
+inline Square lsbSquare(Bitboard bb) { return __builtin_ctzll(bb); }
+inline Square msbSquare(Bitboard bb) { return 63 - __builtin_clzll(bb); }
+inline Square popLsb(Bitboard &bb) {
+    Square sq = lsbSquare(bb);
+    bb &= bb - 1;
+    return sq;
+}
+
+// ---------- Attack tables (built at compile time)
+
+struct AttackTables {
+    std::array<std::array<Bitboard, BOARD_SPACES>, COLORS_COUNT> pawn{};
+    std::array<Bitboard, BOARD_SPACES> knight{};
+    std::array<Bitboard, BOARD_SPACES> king{};
+    // Squares reached by sliding from a square to the edge, per direction.
+    std::array<std::array<Bitboard, BOARD_SPACES>, RAY_DIRS> rays{};
+};
+
+constexpr Bitboard stepBB(Square sq, Col dx, Row dy) {
+    Col x = squareCol(sq) + dx;
+    Row y = squareRow(sq) + dy;
+    bool isOnBoard = x >= 0 && y >= 0 && x < BOARD_COLS && y < BOARD_ROWS;
+    return isOnBoard ? squareBB(toSquare(x, y)) : 0;
+}
+
+constexpr AttackTables makeAttackTables() {
+    constexpr Short rayDx[RAY_DIRS] = {0, 1, 1, 1, 0, -1, -1, -1};
+    constexpr Short rayDy[RAY_DIRS] = {1, 1, 0, -1, -1, -1, 0, 1};
+    constexpr Short knightDx[8] = {1, 2, 2, 1, -1, -2, -2, -1};
+    constexpr Short knightDy[8] = {2, 1, -1, -2, -2, -1, 1, 2};
+
+    AttackTables tables{};
+    for (Square sq = 0; sq < BOARD_SPACES; ++sq) {
+        tables.pawn[colorIndex(Color::White)][sq] =
+            stepBB(sq, -1, 1) | stepBB(sq, 1, 1);
+        tables.pawn[colorIndex(Color::Black)][sq] =
+            stepBB(sq, -1, -1) | stepBB(sq, 1, -1);
+        for (Short k = 0; k < 8; ++k) {
+            tables.knight[sq] |= stepBB(sq, knightDx[k], knightDy[k]);
+            tables.king[sq] |= stepBB(sq, rayDx[k], rayDy[k]);
+        }
+        for (Short dir = 0; dir < RAY_DIRS; ++dir) {
+            for (Short step = 1; step < BOARD_COLS; ++step) {
+                tables.rays[dir][sq] |=
+                    stepBB(sq, rayDx[dir] * step, rayDy[dir] * step);
+            }
+        }
+    }
+    return tables;
+}
+
+inline constexpr AttackTables ATTACK_TABLES = makeAttackTables();
+
+inline Bitboard pawnAttacks(Color c, Square sq) {
+    return ATTACK_TABLES.pawn[colorIndex(c)][sq];
+}
+inline Bitboard knightAttacks(Square sq) { return ATTACK_TABLES.knight[sq]; }
+inline Bitboard kingAttacks(Square sq) { return ATTACK_TABLES.king[sq]; }
+
+// A ray stops at its first blocker, which is included.
+inline Bitboard rayAttacks(Short dir, Square sq, Bitboard occupied) {
+    Bitboard ray = ATTACK_TABLES.rays[dir][sq];
+    Bitboard blockers = ray & occupied;
+    if (blockers) {
+        // N, NE, E and NW rays run towards higher squares.
+        bool isAscending = dir <= 2 || dir == 7;
+        Square first = isAscending ? lsbSquare(blockers) : msbSquare(blockers);
+        ray ^= ATTACK_TABLES.rays[dir][first];
+    }
+    return ray;
+}
+
+inline Bitboard bishopAttacks(Square sq, Bitboard occupied) {
+    return rayAttacks(1, sq, occupied) | rayAttacks(3, sq, occupied)
+        | rayAttacks(5, sq, occupied) | rayAttacks(7, sq, occupied);
+}
+
+inline Bitboard rookAttacks(Square sq, Bitboard occupied) {
+    return rayAttacks(0, sq, occupied) | rayAttacks(2, sq, occupied)
+        | rayAttacks(4, sq, occupied) | rayAttacks(6, sq, occupied);
+}
+
+inline Bitboard queenAttacks(Square sq, Bitboard occupied) {
+    return bishopAttacks(sq, occupied) | rookAttacks(sq, occupied);
+}
+
+// Squares attacked by a piece of the given type and color.
+inline Bitboard pieceAttacks(PieceType pt, Color c, Square sq,
+                             Bitboard occupied)
+{
+    switch (pt) {
+    case PieceType::Pawn:   return pawnAttacks(c, sq);
+    case PieceType::Knight: return knightAttacks(sq);
+    case PieceType::Bishop: return bishopAttacks(sq, occupied);
+    case PieceType::Rook:   return rookAttacks(sq, occupied);
+    case PieceType::Queen:  return queenAttacks(sq, occupied);
+    default:                return kingAttacks(sq);
+    }
+}
+
+// Squares strictly between two squares on a row, column or diagonal, or 0.
+inline Bitboard betweenBB(Square sq1, Square sq2) {
+    Bitboard bb1 = squareBB(sq1);
+    Bitboard bb2 = squareBB(sq2);
+    if (rookAttacks(sq1, bb2) & bb2) {
+        return rookAttacks(sq1, bb2) & rookAttacks(sq2, bb1);
+    }
+    if (bishopAttacks(sq1, bb2) & bb2) {
+        return bishopAttacks(sq1, bb2) & bishopAttacks(sq2, bb1);
+    }
+    return 0;
+}
+
+// ========================================
+// PieceBitboards
+
+// The squares of the Pieces of each Color and PieceType, e.g., as kept by
+// Board alongside its Piece map.
+using PieceBitboards =
+    std::array<std::array<Bitboard, PIECE_TYPES_COUNT>, COLORS_COUNT>;
+
+inline Bitboard colorBB(const PieceBitboards &pieces, Color c) {
+    Bitboard result = 0;
+    for (Bitboard bb : pieces[colorIndex(c)]) {
+        result |= bb;
+    }
+    return result;
+}
+
+// Whether a Piece of byColor attacks sq, as in Position::isAttacked.
+inline bool isSquareAttacked(const PieceBitboards &pieces, Square sq,
+                             Color byColor)
+{
+    const auto &by = pieces[colorIndex(byColor)];
+    auto of = [&by](PieceType pt) { return by[static_cast<Short>(pt)]; };
+    Bitboard occupied =
+        colorBB(pieces, Color::Black) | colorBB(pieces, Color::White);
+    Bitboard queens = of(PieceType::Queen);
+    return (pawnAttacks(opponent(byColor), sq) & of(PieceType::Pawn))
+        || (knightAttacks(sq) & of(PieceType::Knight))
+        || (kingAttacks(sq) & of(PieceType::King))
+        || (bishopAttacks(sq, occupied) & (of(PieceType::Bishop) | queens))
+        || (rookAttacks(sq, occupied) & (of(PieceType::Rook) | queens));
+}
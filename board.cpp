@@ -36,7 +36,9 @@ ostream &operator<<(ostream &os, WinType wt) {
     static const map<WinType, const char *> wt2s{
         {WinType::Agreement, "agreement"},
         {WinType::Checkmate, "checkmate"},
-        {WinType::Conceding, "conceding"}
+        {WinType::Conceding, "conceding"},
+        {WinType::Clock, "time forfeit"},
+        {WinType::Tablebase, "tablebase adjudication"}
     };
     os << wt2s.at(wt);
     return os;
@@ -83,8 +85,10 @@ template <> struct hash<Board> {
 // ---------- Board - Constructors
 
 Board::Board(bool doPopulate)
-    : color2PiecePs{}, _color2KingP{}, _pos2PieceP{}, _currentMoveIndex{1},
-      _boardHashHistory{}, _pmocHistory{1}
+    : color2PiecePs{}, _color2KingP{}, _pos2PieceP{},
+      _color2NonPawnMaterial{{Color::Black, 0.0}, {Color::White, 0.0}},
+      _eval{}, _hash{0}, _pawnHash{0}, _pieceBBs{}, _nnue{},
+      _currentMoveIndex{1}, _boardHashHistory{}, _pmocHistory{1}
 {
     assert(_pmocHistory.size() < 10'000);
     if (doPopulate) {
@@ -96,7 +100,13 @@ Board::Board(const Board &other)
     : color2PiecePs{other.color2PiecePs},
     _color2KingP{other._color2KingP},
     _pos2PieceP{other._pos2PieceP},
-    _currentMoveIndex{1},
+    _color2NonPawnMaterial{other._color2NonPawnMaterial},
+    _eval{other._eval},
+    _hash{other._hash},
+    _pawnHash{other._pawnHash},
+    _pieceBBs{other._pieceBBs},
+    _nnue{other._nnue},
+    _currentMoveIndex{other._currentMoveIndex},
     _boardHashHistory{other._boardHashHistory},
     _pmocHistory{other._pmocHistory}
 {
@@ -119,6 +129,19 @@ PieceP Board::pieceAt(Short index) const {
     return pieceAt(Pos(index % BOARD_COLS, index / BOARD_COLS));
 }
 
+// Put a previously-removed Piece back on the Board, preserving its MoveIndex
+// history. Used to restore captured Pieces on undo.
+void Board::addPiecePTo(PieceP pieceP, const Pos &to) {
+    assert(!pieceAt(to));
+    pieceP->moveTo(to);
+    color2PiecePs[pieceP->color()].insert(pieceP);
+    _pos2PieceP[to] = pieceP;
+    if (pieceP->pieceType() == PieceType::King) {
+        _color2KingP[pieceP->color()] = pieceP;
+    }
+    _updateMaterial(pieceP->color(), pieceP->pieceType(), to.index(), 1);
+}
+
 void Board::addPieceTo(Color c, PieceType pt, Short index,
                        Short lastMoveIndex /* =0 */)
 {
@@ -133,6 +156,7 @@ void Board::addPieceTo(Color c, PieceType pt, Short index,
     if (pt == PieceType::King) {
         _color2KingP[c] = pieceP;
     }
+    _updateMaterial(c, pt, index, 1);
 }
 
 void Board::addPieceTo(Color c, PieceType pt, const string &posStr,
@@ -155,6 +179,10 @@ void Board::movePiece(const Pos &from, const Pos &to) {
     assert(!pieceAt(to)); // Captured piece has been removed by apply()
     PieceP pieceP = pieceAt(from);
     pieceP->moveTo(to);
+    _eval.move(pieceP->color(), pieceP->pieceType(), from.index(), to.index());
+    _updateKeys(pieceP->color(), pieceP->pieceType(), from.index());
+    _updateKeys(pieceP->color(), pieceP->pieceType(), to.index());
+    _updateNnue(pieceP->color(), pieceP->pieceType(), from.index(), to.index());
     _pos2PieceP[to] = pieceP;
     assert(_pos2PieceP.find(from) != _pos2PieceP.end()); // Is in map
     _pos2PieceP.erase(from);
@@ -194,21 +222,67 @@ void Board::removePieceAt(const Pos &pos) {
     }
     _pos2PieceP.erase(pos);
     assert(!pieceAt(pos));
+    _updateMaterial(c, pt, pos.index(), -1);
     // return pieceP;
 }
 
+void Board::setPieceTypeAt(const Pos &pos, PieceType pt) {
+    PieceP pieceP = pieceAt(pos);
+    assert(pieceP);
+    _updateMaterial(pieceP->color(), pieceP->pieceType(), pos.index(), -1);
+    pieceP->setPieceType(pt);
+    _updateMaterial(pieceP->color(), pt, pos.index(), 1);
+}
+
 // ---------- Board data - read
 float Board::boardValue() const {
     return boardValue(Color::Black) - boardValue(Color::White);
 }
 
 float Board::boardValue(Color c) const {
-    return std::accumulate(color2PiecePs.at(c).begin(),
-                           color2PiecePs.at(c).end(), 0.0,
-                           [&](float a, const PieceP b) {
-                               return a + Piece::pieceValue(b->pieceType());
-                           }
-                           );
+    return _eval.material[static_cast<Short>(c)];
+}
+
+EvalValue Board::nnueEvaluate(Color c) const {
+    const Nnue *nnueP = Nnue::active();
+    if (!nnueP) {
+        return evaluate(c);
+    }
+    if (_nnue.generation != Nnue::generation()) {
+        _nnue.isValid.fill(false);
+        _nnue.generation = Nnue::generation();
+    }
+    for (Color p : allColors) {
+        if (_nnue.isValid[colorIndex(p)]) {
+            continue;
+        }
+        Square kingSq = king(p).pos().index();
+        int features[NNUE_MAX_FEATURES];
+        int count = 0;
+        for (const auto &[pos, pieceP] : _pos2PieceP) {
+            if (pieceP->pieceType() != PieceType::King) {
+                assert(count < NNUE_MAX_FEATURES);
+                features[count++] = nnueFeature(p, kingSq, pieceP->color(),
+                                                pieceP->pieceType(),
+                                                pos.index());
+            }
+        }
+        nnueP->refresh(_nnue, p, features, count);
+    }
+    return nnueP->evaluate(_nnue, c);
+}
+
+Board Board::clone() const {
+    Board result{false};
+    for (const auto &[c, piecePs] : color2PiecePs) {
+        for (const PieceP &pieceP : piecePs) {
+            result.addPiecePTo(std::make_shared<Piece>(*pieceP), pieceP->pos());
+        }
+    }
+    result._currentMoveIndex = _currentMoveIndex;
+    result._boardHashHistory = _boardHashHistory;
+    result._pmocHistory = _pmocHistory;
+    return result;
 }
 
 bool Board::hasInsufficientResources() const {
@@ -402,6 +476,59 @@ void Board::updatePmocHistory(bool isPawnMoveOrCapture) {
     _pmocHistory.push_back(isPawnMoveOrCapture);
 }
 
+// ---------- Private methods
+void Board::_updateMaterial(Color c, PieceType pt, Short index, int sign) {
+    _eval.add(c, pt, index, sign);
+    _updateKeys(c, pt, index);
+    if (sign > 0) {
+        _updateNnue(c, pt, NO_SQUARE, index);
+    } else {
+        _updateNnue(c, pt, index, NO_SQUARE);
+    }
+    if (pt != PieceType::King && pt != PieceType::Pawn) {
+        _color2NonPawnMaterial[c] += sign * Piece::pieceValue(pt);
+    }
+}
+
+// Zobrist keys and bitboards: Adding and removing a Piece are the same XOR.
+// ZIndex is as in _getZIndex, without its map lookups.
+void Board::_updateKeys(Color c, PieceType pt, Short index) {
+    ZIndex zi = static_cast<ZIndex>(c) * PIECE_TYPES_COUNT
+              + static_cast<ZIndex>(pt);
+    Hash z = _zobristTable[index][zi];
+    _hash ^= z;
+    _pieceBBs[static_cast<Short>(c)][static_cast<Short>(pt)] ^= squareBB(index);
+    if (pt == PieceType::Pawn) {
+        _pawnHash ^= z;
+    }
+}
+
+void Board::_updateNnue(Color c, PieceType pt, Square from, Square to) {
+    const Nnue *nnueP = Nnue::active();
+    if (!nnueP || _nnue.generation != Nnue::generation()) {
+        return; // Refreshed before use
+    }
+    if (pt == PieceType::King) {
+        _nnue.isValid[colorIndex(c)] = false; // Every feature changes
+        return;
+    }
+    for (Color p : allColors) {
+        if (!_nnue.isValid[colorIndex(p)]) {
+            continue;
+        }
+        Square kingSq = king(p).pos().index();
+        if (from == NO_SQUARE) {
+            nnueP->addFeature(_nnue, p, nnueFeature(p, kingSq, c, pt, to));
+        } else if (to == NO_SQUARE) {
+            nnueP->removeFeature(_nnue, p,
+                                 nnueFeature(p, kingSq, c, pt, from));
+        } else {
+            nnueP->moveFeature(_nnue, p, nnueFeature(p, kingSq, c, pt, from),
+                               nnueFeature(p, kingSq, c, pt, to));
+        }
+    }
+}
+
 // ---------- Custom printing
 ostream &operator<<(ostream &os, const Board &b) {
     string hRule{1, '+'};
@@ -25,7 +25,9 @@
 
 #include <cassert>
 
+#include "eval.h"
 #include "geometry.h"
+#include "nnue.h"
 #include "piece.h"
 #include "player.h"
 #include "util.h"
@@ -82,8 +84,9 @@ enum class WinType {
     None,
     Agreement,
     Checkmate,
-    Conceding
-    // Clock - No clock used
+    Conceding,
+    Clock,
+    Tablebase // Adjudicated: The active Tablebases show a forced mate
 };
 
 std::ostream &operator<<(std::ostream &os, WinType wt);
@@ -107,10 +110,11 @@ enum DrawFlag {
     Draw_Agreement = 1 << 2,
     Draw_Claimed_3xRepetition = 1 << 3,
     Draw_Claimed_50MoveRule = 1 << 4,
-    // Draw_Clock,
     // Draw_DeadPosition,  // Not including InsufficientResources
     Draw_InsufficientResources = 1 << 5,
-    Draw_Stalemate = 1 << 6
+    Draw_Stalemate = 1 << 6,
+    Draw_Clock = 1 << 7, // Flag fell, but the opponent cannot checkmate
+    Draw_Tablebase = 1 << 8 // Adjudicated: The active Tablebases show a draw
 };
 
 // ----------
@@ -132,13 +136,19 @@ class Board {
 
     // ---------- Constructors
     Board(bool doPopulate = false);
-    Board(const Board &other);
+    Board(const Board &other); // Shares Pieces with other. See clone().
 
     // Rule of three
     Board &operator=(const Board &other) {
         color2PiecePs = other.color2PiecePs;
         _color2KingP = other._color2KingP;
         _pos2PieceP = other._pos2PieceP;
+        _color2NonPawnMaterial = other._color2NonPawnMaterial;
+        _eval = other._eval;
+        _hash = other._hash;
+        _pawnHash = other._pawnHash;
+        _pieceBBs = other._pieceBBs;
+        _nnue = other._nnue;
         _currentMoveIndex = other._currentMoveIndex;
         _boardHashHistory = other._boardHashHistory;
         _pmocHistory = other._pmocHistory;
@@ -157,7 +167,7 @@ class Board {
     const Piece &king(Color c) const { return *_color2KingP.at(c); }
 
     // ---------- Piece data - write
-    // void addPiecePTo(PieceP pieceP, const Pos& to);
+    void addPiecePTo(PieceP pieceP, const Pos &to);
     void addPieceTo(Color c, PieceType pt, Short index,
                     Short lastMoveIndex = 0);
     void addPieceTo(Color c, PieceType pt, const std::string &posStr,
@@ -165,16 +175,41 @@ class Board {
     void addPiecePair(PieceType pt, Short index, bool preserveCol = false);
     void movePiece(const Pos &from, const Pos &to);
     PieceTypes pieceTypes(Color c) const;
+    void setPieceTypeAt(const Pos &pos, PieceType pt); // Promotion, and undo
     const PiecePs &piecesWithColor(Color c) const;
     void removePieceAt(const Pos &pos);
 
     // ---------- Board data - read
+    Board clone() const; // Copy with its own Pieces, e.g., for another thread
     float boardValue() const;
     float boardValue(Color c) const;
     Short currentMoveIndex() const { return _currentMoveIndex; }
+    // Tapered material and piece-square evaluation in centipawns, from the
+    // point of view of c. Maintained incrementally (see EvalAccumulator).
+    EvalValue evaluate(Color c) const { return _eval.value(c); }
+    const EvalAccumulator &evalAccumulator() const { return _eval; }
+    // Evaluation by the active Nnue (or evaluate(), if there is none), in
+    // centipawns, from the point of view of c. Its accumulators are updated
+    // incrementally, and refreshed here after a King move.
+    EvalValue nnueEvaluate(Color c) const;
+    Hash hash() const { return _hash; } // Zobrist hash of Piece placement
+    // Zobrist hash of Pawn placement, with the Pawns by Color. Both are
+    // maintained incrementally, like hash(), e.g., for a PawnHashTable.
+    Hash pawnHash() const { return _pawnHash; }
+    PawnBitboards pawns() const {
+        Short pawn = static_cast<Short>(PieceType::Pawn);
+        return {_pieceBBs[0][pawn], _pieceBBs[1][pawn]};
+    }
+    // Piece placement as bitboards, also maintained incrementally, for the
+    // attack tables of bitboard.h (e.g., check detection and mobility).
+    const PieceBitboards &pieceBitboards() const { return _pieceBBs; }
     bool hasInsufficientResources() const;
     std::size_t maxBoardRepetitionCount(Color c) const;
     Short movesSinceLastPmoc() const;
+    // Incrementally maintained value of Pieces other than King and Pawns
+    PieceValue nonPawnMaterial(Color c) const {
+        return _color2NonPawnMaterial.at(c);
+    }
     Short pieceCount(Color c) const { return color2PiecePs.at(c).size(); }
     Short pieceCount() const {
         return pieceCount(Color::Black) + pieceCount(Color::White);
@@ -243,8 +278,20 @@ class Board {
 
     static ZTable _zobristTable;
 
+    void _updateMaterial(Color c, PieceType pt, Short index, int sign);
+    // Zobrist keys and bitboards: Add or remove
+    void _updateKeys(Color c, PieceType pt, Short index);
+    // from or to is NO_SQUARE when a Piece is added or removed.
+    void _updateNnue(Color c, PieceType pt, Square from, Square to);
+
     Color2KingP _color2KingP;
     Pos2PieceP _pos2PieceP;
+    std::map<Color, PieceValue> _color2NonPawnMaterial;
+    EvalAccumulator _eval;
+    Hash _hash;
+    Hash _pawnHash;
+    PieceBitboards _pieceBBs;
+    mutable NnueAccumulator _nnue; // Refreshed lazily by nnueEvaluate
 
     // ---------- History
     MoveIndex
@@ -20,12 +20,19 @@
 #include <libgen.h>
 
 #include "board.h"
+#include "clock.h"
 #include "game.h"
 #include "game_state.h"
 #include "geometry.h"
+#include "mate_solver.h"
+#include "mcts.h"
 #include "move.h"
+#include "nnue.h"
 #include "piece.h"
 #include "player.h"
+#include "position.h"
+#include "search.h"
+#include "tablebase.h"
 #include "util.h"
 
 using std::cerr, std::cout;
@@ -38,18 +45,46 @@ int main(int argc, char **argv) {
     PlayerType bPlayer = PlayerType::Computer_Random;
     PlayerType wPlayer = PlayerType::Computer_Random;
     Short matchGameCount = 5; // 0 represents unlimited
+    TimeControl timeControl{}; // No clock
     string helpMsg =
         "A chess platform that supports Human (H) vs Computer (C) play, H vs. "
         "H, "
         "or C vs. C.\n"
         "  Options:\n"
-        "    -1 <player1_type>, where <player1_type> is human, random, or "
-        "randomCapture\n"
-        "    -2 <player2_type>, where <player2_type> is human, random, or "
-        "randomCapture\n"
+        "    -1 <player1_type>, where <player1_type> is human, random, "
+        "randomCapture, alphabeta, or mcts\n"
+        "    -2 <player2_type>, where <player2_type> is human, random, "
+        "randomCapture, alphabeta, or mcts\n"
+        "    -d <depth>,        to set the alphabeta search depth (default 3,\n"
+        "                       or unlimited with a clock)\n"
+        "    -o1 <name>=<value>, -o2 <name>=<value>\n"
+        "                       to set a search option for player 1 or 2, "
+        "e.g., lmr=off.\n"
+        "                       Options: depth=<n>, extBudget=<n>, "
+        "multiPv=<k>, evalCache=<log2 size>; ordering, "
+        "nullMove, lmr, rfp, lmp,\n"
+        "                       pvs, aspiration, checkExt, recaptureExt, "
+        "pawnExt, singularExt, ponder, mtdf, nnue, lazyEval,\n"
+        "                       verifyLazyEval, tablebases=on|off;\n"
+        "                       for mcts, iterations=<n>, exploration=<c>, "
+        "playoutPlies=<n>, threads=<n>,\n"
+        "                       nodes=<n> (tree capacity); for --solve-mate, "
+        "mateNodes=<n>,\n"
+        "                       matePlies=<n>, mateHash=<log2 size>\n"
+        "    -t <base>[+<increment>],\n"
+        "                       to play with a chess clock, e.g., -t 180+2 "
+        "(in seconds)\n"
         "    -n <games_count>,  to set the number of games in a match\n"
         "                       (default is 5 for batch play; unlimited for "
         "interactive play)\n"
+        "    --solve-mate <FEN>, to prove or disprove a forced mate by checks "
+        "for the side\n"
+        "                       to move, instead of playing\n"
+        "    --nnue <file>,     to evaluate with the neural network in file "
+        "(see train_nnue)\n"
+        "    --tb <dir>,        to search and adjudicate endings with the "
+        "tablebases\n"
+        "                       in dir (see gen_tb)\n"
         "So, for example,\n"
         "    % chess -1 human -2 human\n"
         "plays an unlimited number of games between two humans.\n"
@@ -58,11 +93,16 @@ int main(int argc, char **argv) {
         "when playing interactively.\n";
     bool isArgParsingError = false;
     bool isMatchGameCountSpecified = false;
+    map<Color, bool> isDepthSpecified{}; // With -d, or -o1/-o2 depth=<n>
+    std::optional<string> solveMateFen{};
+    MateSolver mateSolver{};
 
     map<string, PlayerType> s2pt{
         {"human", PlayerType::Human},
         {"random", PlayerType::Computer_Random},
-        {"randomCapture", PlayerType::Computer_RandomCapture}};
+        {"randomCapture", PlayerType::Computer_RandomCapture},
+        {"alphabeta", PlayerType::Computer_AlphaBeta},
+        {"mcts", PlayerType::Computer_MCTS}};
     for (auto i = args.begin(); i != args.end(); ++i) {
         if (*i == "-1" || *i == "-w") {
             ++i;
@@ -86,6 +126,47 @@ int main(int argc, char **argv) {
                 bPlayer = s2pt.at(player2);
             }
             continue;
+        } else if (*i == "-d") {
+            ++i;
+            for (Color c : allColors) {
+                if (!Search::forColor(c).setOption("depth", *i)) {
+                    cerr << progname << ": Unrecognized depth: " << *i
+                         << "\n";
+                    isArgParsingError = true;
+                    break;
+                }
+                isDepthSpecified[c] = true;
+            }
+            continue;
+        } else if (*i == "-o1" || *i == "-o2") {
+            Color c = *i == "-o1" ? Color::White : Color::Black;
+            ++i;
+            std::size_t eqPos = i->find('=');
+            string name = i->substr(0, eqPos);
+            string value = eqPos == string::npos ? "" : i->substr(eqPos + 1);
+            if (eqPos == string::npos
+                || (!Search::forColor(c).setOption(name, value)
+                    && !Mcts::forColor(c).setOption(name, value)
+                    && !mateSolver.setOption(name, value)))
+            {
+                cerr << progname << ": Unrecognized search option: " << *i
+                     << "\n";
+                isArgParsingError = true;
+            } else if (name == "depth") {
+                isDepthSpecified[c] = true;
+            }
+            continue;
+        } else if (*i == "-t") {
+            ++i;
+            std::optional<TimeControl> oTimeControl = TimeControl::parse(*i);
+            if (!oTimeControl) {
+                cerr << progname << ": Unrecognized time control: " << *i
+                     << "\n";
+                isArgParsingError = true;
+            } else {
+                timeControl = *oTimeControl;
+            }
+            continue;
         } else if (*i == "-n") {
             ++i;
             try {
@@ -96,6 +177,24 @@ int main(int argc, char **argv) {
                 isArgParsingError = true;
             }
             continue;
+        } else if (*i == "--nnue") {
+            ++i;
+            if (!Nnue::load(*i)) {
+                cerr << progname << ": Cannot load network: " << *i << "\n";
+                isArgParsingError = true;
+            }
+            continue;
+        } else if (*i == "--tb") {
+            ++i;
+            if (!Tablebases::load(*i)) {
+                cerr << progname << ": No tablebases in: " << *i << "\n";
+                isArgParsingError = true;
+            }
+            continue;
+        } else if (*i == "--solve-mate") {
+            ++i;
+            solveMateFen = *i;
+            continue;
         } else {
             cerr << progname << ": Unrecognized argument: " << *i << "\n";
             isArgParsingError = true;
@@ -105,6 +204,18 @@ int main(int argc, char **argv) {
         cout << progname << ": " << helpMsg;
         exit(1);
     }
+    if (solveMateFen) {
+        std::optional<Position> oPos = Position::fromFen(*solveMateFen);
+        if (!oPos) {
+            cerr << progname << ": Unrecognized FEN: " << *solveMateFen
+                 << "\n";
+            exit(1);
+        }
+        MateResult result = mateSolver.solve(*oPos);
+        cout << to_string(oPos->sideToMove()) << ": " << result << "\n"
+             << mateSolver.stats() << "\n";
+        return 0;
+    }
     if (!isMatchGameCountSpecified) {
         if (bPlayer == PlayerType::Human && wPlayer == PlayerType::Human) {
             matchGameCount = 0; // Unlimited
@@ -113,11 +224,19 @@ int main(int argc, char **argv) {
         }
     }
 
+    if (timeControl.isEnabled()) {
+        for (Color c : allColors) {
+            if (!isDepthSpecified[c]) {
+                Search::forColor(c).config().maxDepth = MAX_PLY - 1;
+            }
+        }
+    }
+
     Logger::init(LogError);
     // Logger::setReportLevel(LogTrace);
     Logger::logToCout();
     // Logger::logToFile("foo.txt");
 
-    Game game{};
+    Game game{timeControl};
     game.play(matchGameCount, wPlayer, bPlayer);
 }
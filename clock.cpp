@@ -0,0 +1,117 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cmath>
+#include <iomanip>
+
+#include "clock.h"
+#include "util.h"
+
+using std::ostream;
+
+// ========================================
+// TimeControl
+
+// Longer times (about 30 years) are rejected, so that Millis cannot overflow.
+constexpr double TIME_CONTROL_MAX_SECS = 1e9;
+
+std::optional<TimeControl> TimeControl::parse(const std::string &s) {
+    std::size_t plusPos = s.find('+');
+    try {
+        double baseSecs = std::stod(s.substr(0, plusPos));
+        double incrSecs = plusPos == std::string::npos
+            ? 0.0
+            : std::stod(s.substr(plusPos + 1));
+        if (!std::isfinite(baseSecs) || !std::isfinite(incrSecs)
+            || baseSecs <= 0.0 || incrSecs < 0.0
+            || baseSecs > TIME_CONTROL_MAX_SECS
+            || incrSecs > TIME_CONTROL_MAX_SECS)
+        {
+            return std::nullopt;
+        }
+        return TimeControl{Millis{std::lround(1000 * baseSecs)},
+                           Millis{std::lround(1000 * incrSecs)}};
+    } catch (std::invalid_argument &ex) {
+        return std::nullopt;
+    } catch (std::out_of_range &ex) {
+        return std::nullopt;
+    }
+}
+
+ostream &operator<<(ostream &os, const TimeControl &tc) {
+    os << tc.base.count() / 1000.0 << "s+" << tc.increment.count() / 1000.0
+       << 's';
+    return os;
+}
+
+// ========================================
+// ChessClock
+
+// ---------- Constructor
+ChessClock::ChessClock(const TimeControl &tc /* =TimeControl{} */)
+    : _timeControl{tc}, _remaining{}, _running{std::nullopt}, _turnStart{}
+{
+    reset();
+}
+
+// ---------- Public read methods
+Millis ChessClock::remaining(Color c) const {
+    Millis result = _remaining.at(c);
+    if (_running == c) {
+        result -= std::chrono::duration_cast<Millis>(SteadyClock::now()
+                                                     - _turnStart);
+    }
+    return result;
+}
+
+// ---------- Public write methods
+void ChessClock::reset() {
+    for (Color c : allColors) {
+        _remaining[c] = _timeControl.base;
+    }
+    _running = std::nullopt;
+}
+
+void ChessClock::start(Color c) {
+    if (_running) {
+        stop();
+    }
+    _running = c;
+    _turnStart = SteadyClock::now();
+}
+
+void ChessClock::stop() {
+    if (!_running) {
+        return;
+    }
+    Color c = *_running;
+    _remaining[c] = remaining(c);
+    _running = std::nullopt;
+    if (!isFlagged(c)) {
+        _remaining[c] += _timeControl.increment;
+    }
+}
+
+// ---------- Custom printing
+ostream &operator<<(ostream &os, const ChessClock &clock) {
+    for (Color c : allColors) {
+        Millis ms = clock.remaining(c);
+        os << (c == Color::White ? "" : ", ") << to_string(c) << ": "
+           << std::fixed << std::setprecision(1) << ms.count() / 1000.0 << 's'
+           << std::defaultfloat;
+    }
+    return os;
+}
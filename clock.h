@@ -0,0 +1,74 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <string>
+
+#include "util.h"
+
+using SteadyClock = std::chrono::steady_clock; // Monotonic
+using Millis = std::chrono::milliseconds;
+
+// ========================================
+// TimeControl
+
+// Fischer time control: Each player starts with base time, and gains the
+// increment after each move.
+struct TimeControl {
+    Millis base{0};
+    Millis increment{0};
+
+    bool isEnabled() const { return base > Millis{0}; }
+    // Parse "<base_seconds>[+<increment_seconds>]", e.g., "180+2" or "0.5+0.1".
+    static std::optional<TimeControl> parse(const std::string &s);
+};
+
+std::ostream &operator<<(std::ostream &os, const TimeControl &tc);
+
+// ========================================
+// ChessClock
+
+// A pair of countdown clocks, at most one of which is running.
+class ChessClock {
+  public:
+    ChessClock(const TimeControl &tc = TimeControl{});
+
+    // ---------- Public read methods
+    const TimeControl &timeControl() const { return _timeControl; }
+    bool isEnabled() const { return _timeControl.isEnabled(); }
+    bool isFlagged(Color c) const { return remaining(c) <= Millis{0}; }
+    Millis remaining(Color c) const; // Includes the current turn, if running
+    std::optional<Color> running() const { return _running; }
+
+    // ---------- Public write methods
+    void reset(); // Both players get base time
+    void start(Color c);
+    // Stop the running clock. Its player gains the increment, unless flagged.
+    void stop();
+
+  private:
+    TimeControl _timeControl;
+    std::map<Color, Millis> _remaining;
+    std::optional<Color> _running;
+    SteadyClock::time_point _turnStart;
+
+    friend std::ostream &operator<<(std::ostream &os, const ChessClock &clock);
+};
@@ -0,0 +1,144 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <algorithm>
+
+#include "eval.h"
+
+// ========================================
+// Pawn structure
+
+EvalValue PawnEntry::value(Color c, Square blackKing, Square whiteKing,
+                           Short phase) const
+{
+    EvalValue shieldMg = 0;
+    for (Color kc : {Color::Black, Color::White}) {
+        Square kingSq = kc == Color::White ? whiteKing : blackKing;
+        if (relativeRow(kc, squareRow(kingSq)) <= 1) {
+            EvalValue v = shield[colorIndex(kc)][squareCol(kingSq)];
+            shieldMg += kc == Color::White ? v : -v;
+        }
+    }
+    EvalValue whiteValue = taper(mg + shieldMg, eg, phase);
+    return c == Color::White ? whiteValue : -whiteValue;
+}
+
+PawnEntry evaluatePawns(Hash key, const PawnBitboards &pawns) {
+    PawnEntry entry;
+    entry.key = key;
+    entry.isValid = true;
+    EvalValue mg[COLORS_COUNT] = {0, 0};
+    EvalValue eg[COLORS_COUNT] = {0, 0};
+    for (Color c : {Color::Black, Color::White}) {
+        Short ci = colorIndex(c);
+        visitPawnTerms(c, pawns, [&](int mgParam, int egParam, int count) {
+            mg[ci] += count * EVAL_PARAMS[mgParam];
+            eg[ci] += count * EVAL_PARAMS[egParam];
+        });
+        for (Col x = 0; x < BOARD_COLS; ++x) {
+            visitShieldTerms(c, pawns[ci], x, [&](int mgParam, int, int count) {
+                entry.shield[ci][x] += count * EVAL_PARAMS[mgParam];
+            });
+        }
+    }
+    Short w = colorIndex(Color::White);
+    Short b = colorIndex(Color::Black);
+    entry.mg = mg[w] - mg[b];
+    entry.eg = eg[w] - eg[b];
+    return entry;
+}
+
+// ========================================
+// PawnHashTable
+
+// ---------- Constructor
+PawnHashTable::PawnHashTable(Short sizeLog2 /* =12 */)
+    : _entries(std::size_t{1} << sizeLog2), _mask{(Hash{1} << sizeLog2) - 1}
+{}
+
+// ---------- Read methods
+const PawnEntry *PawnHashTable::probe(Hash key) const {
+    const PawnEntry &entry = _entries[key & _mask];
+    return entry.isValid && entry.key == key ? &entry : nullptr;
+}
+
+// ---------- Write methods
+const PawnEntry &PawnHashTable::store(const PawnEntry &entry) {
+    PawnEntry &slot = _entries[entry.key & _mask];
+    slot = entry;
+    return slot;
+}
+
+void PawnHashTable::clear() {
+    std::fill(_entries.begin(), _entries.end(), PawnEntry{});
+}
+
+// ========================================
+// Mobility and King safety
+
+EvalValue evaluateMobility(Color c, const PieceBitboards &pieces,
+                           Short phase)
+{
+    EvalValue mg = 0;
+    EvalValue eg = 0;
+    for (Color side : {Color::Black, Color::White}) {
+        int sign = side == c ? 1 : -1;
+        visitMobilityTerms(side, pieces, [&](int mgParam, int egParam,
+                                             int count) {
+            mg += sign * count * EVAL_PARAMS[mgParam];
+            if (egParam != NO_EVAL_PARAM) {
+                eg += sign * count * EVAL_PARAMS[egParam];
+            }
+        });
+    }
+    return taper(mg, eg, phase);
+}
+
+// ========================================
+// EvalCache
+
+// ---------- Constructor
+EvalCache::EvalCache(Short sizeLog2 /* =16 */)
+    : _entries(sizeLog2 > 0 ? std::size_t{1} << sizeLog2 : 0),
+      _mask{sizeLog2 > 0 ? (Hash{1} << sizeLog2) - 1 : 0}, _hits{0},
+      _misses{0}
+{}
+
+// ---------- Write methods
+std::optional<EvalValue> EvalCache::probe(Hash key, Evaluator evaluator) {
+    if (!_entries.empty()) {
+        const EvalCacheEntry &entry = _entries[key & _mask];
+        if (entry.key == key && entry.evaluator == evaluator) {
+            ++_hits;
+            return entry.value;
+        }
+    }
+    ++_misses;
+    return std::nullopt;
+}
+
+void EvalCache::store(Hash key, Evaluator evaluator, EvalValue value) {
+    if (!_entries.empty()) {
+        _entries[key & _mask] = EvalCacheEntry{key, value, evaluator};
+    }
+}
+
+void EvalCache::clear() {
+    std::fill(_entries.begin(), _entries.end(), EvalCacheEntry{});
+    _hits = 0;
+    _misses = 0;
+}
@@ -0,0 +1,362 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "bitboard.h"
+#include "eval_params.h"
+#include "geometry.h"
+#include "piece.h"
+#include "util.h"
+
+// ========================================
+// Evaluation terms
+//
+// Material and piece-square values in centipawns, each with a middlegame (mg)
+// and an endgame (eg) value. The two are blended by game phase, which falls
+// from PHASE_MAX (all non-Pawn material on the board) to 0 (Kings and Pawns).
+
+using EvalValue = int;
+
+constexpr Short PHASE_MAX = 24;
+
+// Blend of a middlegame and an endgame value. phase is capped at PHASE_MAX.
+inline EvalValue taper(EvalValue mg, EvalValue eg, Short phase) {
+    Short ph = phase < PHASE_MAX ? phase : PHASE_MAX;
+    return (mg * ph + eg * (PHASE_MAX - ph)) / PHASE_MAX;
+}
+
+// Indexed by PieceType: King, Queen, Rook, Bishop, Knight, Pawn.
+constexpr std::array<Short, PIECE_TYPES_COUNT> PHASE_WEIGHTS{0, 4, 2, 1, 1, 0};
+
+// ---------- Parameters
+// Every tunable value, in one flat array, so that tune_eval can fit them
+// together and write them back as eval_params.h. Index layout:
+
+constexpr int EP_MG_MATERIAL = 0; // + PieceType
+constexpr int EP_EG_MATERIAL = EP_MG_MATERIAL + PIECE_TYPES_COUNT;
+// Piece-square tables: + PieceType * BOARD_SPACES + entry (see pstEntry)
+constexpr int EP_MG_PST = EP_EG_MATERIAL + PIECE_TYPES_COUNT;
+constexpr int EP_EG_PST = EP_MG_PST + PIECE_TYPES_COUNT * BOARD_SPACES;
+// Pawn structure, per Pawn: The middlegame value, then the endgame value.
+constexpr int EP_DOUBLED = EP_EG_PST + PIECE_TYPES_COUNT * BOARD_SPACES;
+constexpr int EP_ISOLATED = EP_DOUBLED + 2;
+constexpr int EP_BACKWARD = EP_ISOLATED + 2;
+constexpr int EP_MG_PASSED = EP_BACKWARD + 2; // + row from the Pawn's side
+constexpr int EP_EG_PASSED = EP_MG_PASSED + BOARD_ROWS;
+// Per column in front of a castled King: The shield Pawn is on the King's
+// third row rather than its second, or missing. Middlegame only.
+constexpr int EP_SHIELD_ADVANCED = EP_EG_PASSED + BOARD_ROWS;
+constexpr int EP_SHIELD_MISSING = EP_SHIELD_ADVANCED + 1;
+// Per safe square a Piece attacks (see visitMobilityTerms): + PieceType
+constexpr int EP_MG_MOBILITY = EP_SHIELD_MISSING + 1;
+constexpr int EP_EG_MOBILITY = EP_MG_MOBILITY + PIECE_TYPES_COUNT;
+// Per square next to the enemy King a Piece attacks: + PieceType. Middlegame
+// only.
+constexpr int EP_KING_ATTACK = EP_EG_MOBILITY + PIECE_TYPES_COUNT;
+constexpr int EVAL_PARAM_COUNT = EP_KING_ATTACK + PIECE_TYPES_COUNT;
+constexpr int NO_EVAL_PARAM = -1; // E.g., the endgame value of a shield
+
+using EvalParams = std::array<EvalValue, EVAL_PARAM_COUNT>;
+
+static_assert(EVAL_PARAMS.size() == EVAL_PARAM_COUNT,
+              "eval_params.h does not match the layout of EvalParams");
+
+// Piece-square tables are written from White's point of view, with row 8
+// first, as on a diagram.
+constexpr Short pstEntry(Color c, Square sq) {
+    return c == Color::White ? sq ^ 56 : sq;
+}
+
+// ---------- Combined tables (built at compile time)
+// Material plus piece-square value, per Color, PieceType and Pos index.
+
+using PieceSquareTable = std::array<EvalValue, BOARD_SPACES>;
+
+struct EvalTables {
+    using Values = std::array<std::array<PieceSquareTable, PIECE_TYPES_COUNT>,
+                              COLORS_COUNT>;
+    Values mg{};
+    Values eg{};
+};
+
+constexpr EvalTables makeEvalTables(const EvalParams &params) {
+    EvalTables t;
+    for (Short pt = 0; pt < PIECE_TYPES_COUNT; ++pt) {
+        for (Short index = 0; index < BOARD_SPACES; ++index) {
+            for (Short c = 0; c < COLORS_COUNT; ++c) {
+                Short entry = pt * BOARD_SPACES + pstEntry(Color(c), index);
+                t.mg[c][pt][index] =
+                    params[EP_MG_MATERIAL + pt] + params[EP_MG_PST + entry];
+                t.eg[c][pt][index] =
+                    params[EP_EG_MATERIAL + pt] + params[EP_EG_PST + entry];
+            }
+        }
+    }
+    return t;
+}
+
+inline constexpr EvalTables EVAL_TABLES = makeEvalTables(EVAL_PARAMS);
+
+// ========================================
+// EvalAccumulator
+//
+// Per-Color sums of the tables above over the Pieces on a Board, kept up to
+// date as Pieces are added, removed, moved and promoted, so that a static
+// evaluation costs a few adds rather than a walk over the Pieces.
+
+struct EvalAccumulator {
+    std::array<EvalValue, COLORS_COUNT> mg{};
+    std::array<EvalValue, COLORS_COUNT> eg{};
+    std::array<PieceValue, COLORS_COUNT> material{}; // Piece::pieceValue sums
+    Short phase = 0; // Sum of PHASE_WEIGHTS. May exceed PHASE_MAX.
+
+    void add(Color c, PieceType pt, Short index, int sign) {
+        Short ci = static_cast<Short>(c);
+        Short pti = static_cast<Short>(pt);
+        mg[ci] += sign * EVAL_TABLES.mg[ci][pti][index];
+        eg[ci] += sign * EVAL_TABLES.eg[ci][pti][index];
+        material[ci] += sign * Piece::pieceValue(pt);
+        phase += sign * PHASE_WEIGHTS[pti];
+    }
+    void move(Color c, PieceType pt, Short from, Short to) {
+        Short ci = static_cast<Short>(c);
+        Short pti = static_cast<Short>(pt);
+        mg[ci] += EVAL_TABLES.mg[ci][pti][to] - EVAL_TABLES.mg[ci][pti][from];
+        eg[ci] += EVAL_TABLES.eg[ci][pti][to] - EVAL_TABLES.eg[ci][pti][from];
+    }
+
+    // Tapered evaluation, from the point of view of c.
+    EvalValue value(Color c) const {
+        Short ci = static_cast<Short>(c);
+        Short oi = 1 - ci;
+        return taper(mg[ci] - mg[oi], eg[ci] - eg[oi], phase);
+    }
+};
+
+// ========================================
+// Pawn structure
+//
+// Doubled, isolated, backward and passed Pawns, and the Pawn shield in front
+// of a castled King. These depend only on where the Pawns are, which changes
+// rarely, so they are computed once per Pawn structure and cached in a
+// PawnHashTable, keyed by a Zobrist key over the Pawns only (see
+// Board::pawnHash).
+
+using PawnBitboards = std::array<Bitboard, COLORS_COUNT>; // By Color
+
+struct PawnEntry {
+    Hash key = 0;
+    bool isValid = false;
+    EvalValue mg = 0; // Structure terms, White minus Black
+    EvalValue eg = 0;
+    // Middlegame shield value, by Color and King column. It applies while the
+    // King stands on one of its first two rows.
+    std::array<std::array<EvalValue, BOARD_COLS>, COLORS_COUNT> shield{};
+
+    // Tapered value, from the point of view of c.
+    EvalValue value(Color c, Square blackKing, Square whiteKing,
+                    Short phase) const;
+};
+
+PawnEntry evaluatePawns(Hash key, const PawnBitboards &pawns);
+
+// ---------- Terms
+// Each visit function calls term(mgParam, egParam, count) for the terms of
+// the Pawns of c, where the params are EvalParams indexes. evaluatePawns and
+// tune_eval both use them, so that the tuner fits the terms the engine uses.
+
+constexpr Row relativeRow(Color c, Row y) {
+    return c == Color::White ? y : BOARD_ROWS - 1 - y;
+}
+
+// The rows in front of row y, from the point of view of c.
+constexpr Bitboard forwardRowsBB(Color c, Row y) {
+    if (c == Color::White) {
+        return y == BOARD_ROWS - 1 ? 0 : ~Bitboard{0} << (BOARD_COLS * (y + 1));
+    }
+    return (Bitboard{1} << (BOARD_COLS * y)) - 1;
+}
+
+constexpr Bitboard adjacentColsBB(Col x) {
+    return (x > 0 ? colBB(x - 1) : 0) | (x < BOARD_COLS - 1 ? colBB(x + 1) : 0);
+}
+
+template <typename Term>
+void visitPawnTerms(Color c, const PawnBitboards &pawns, Term &&term) {
+    Bitboard own = pawns[colorIndex(c)];
+    Bitboard theirs = pawns[colorIndex(opponent(c))];
+    for (Col x = 0; x < BOARD_COLS; ++x) {
+        Short count = popCount(own & colBB(x));
+        if (count > 1) {
+            term(EP_DOUBLED, EP_DOUBLED + 1, count - 1);
+        }
+    }
+    for (Bitboard bb = own; bb;) {
+        Square sq = popLsb(bb);
+        Col x = squareCol(sq);
+        Row y = squareRow(sq);
+        Bitboard adjacent = adjacentColsBB(x);
+        Bitboard ahead = forwardRowsBB(c, y);
+        if (!(theirs & ahead & (colBB(x) | adjacent))) {
+            Row r = relativeRow(c, y);
+            term(EP_MG_PASSED + r, EP_EG_PASSED + r, 1);
+        }
+        if (!(own & adjacent)) {
+            term(EP_ISOLATED, EP_ISOLATED + 1, 1);
+            continue;
+        }
+        // Backward: No Pawn on an adjacent column can support it, and an
+        // enemy Pawn controls the square in front of it.
+        Square stop = sq + (c == Color::White ? BOARD_COLS : -BOARD_COLS);
+        bool isSupportable = own & adjacent & ~ahead;
+        if (!isSupportable && stop >= 0 && stop < BOARD_SPACES
+            && (pawnAttacks(c, stop) & theirs))
+        {
+            term(EP_BACKWARD, EP_BACKWARD + 1, 1);
+        }
+    }
+}
+
+// The shield in front of a King of c on column kingCol. It applies while the
+// King stands on one of its first two rows.
+template <typename Term>
+void visitShieldTerms(Color c, Bitboard own, Col kingCol, Term &&term) {
+    Row second = relativeRow(c, 1);
+    Row third = relativeRow(c, 2);
+    for (Col x = kingCol > 0 ? kingCol - 1 : 0;
+         x <= (kingCol < BOARD_COLS - 1 ? kingCol + 1 : kingCol); ++x) {
+        if (own & colBB(x) & rowBB(second)) {
+            continue;
+        }
+        if (own & colBB(x) & rowBB(third)) {
+            term(EP_SHIELD_ADVANCED, NO_EVAL_PARAM, 1);
+        } else {
+            term(EP_SHIELD_MISSING, NO_EVAL_PARAM, 1);
+        }
+    }
+}
+
+// Fixed-size, direct-mapped. Each Search has its own, so it needs no locks.
+class PawnHashTable {
+  public:
+    PawnHashTable(Short sizeLog2 = 12);
+
+    // ---------- Read methods
+    const PawnEntry *probe(Hash key) const;
+    std::size_t size() const { return _entries.size(); }
+
+    // ---------- Write methods
+    const PawnEntry &store(const PawnEntry &entry);
+    void clear();
+
+  private:
+    std::vector<PawnEntry> _entries;
+    Hash _mask;
+};
+
+// ========================================
+// Mobility and King safety
+//
+// Per Knight, Bishop, Rook and Queen: The squares it attacks that hold no
+// Piece of its own and are not attacked by an enemy Pawn (mobility), and the
+// squares it attacks around the enemy King (King zone). They depend on all
+// the Pieces, so they are computed at each evaluation (and kept in the
+// EvalCache), in one pass over the bitboards of the Board, with the attack
+// tables that move generation and check detection use.
+
+// Calls term(mgParam, egParam, count) for the terms of the Pieces of c, as
+// visitPawnTerms does.
+template <typename Term>
+void visitMobilityTerms(Color c, const PieceBitboards &pieces, Term &&term) {
+    Color o = opponent(c);
+    Bitboard own = colorBB(pieces, c);
+    Bitboard occupied = own | colorBB(pieces, o);
+    Bitboard theirPawns = pieces[colorIndex(o)][Short(PieceType::Pawn)];
+    Bitboard pawnAttacked = 0;
+    for (Bitboard bb = theirPawns; bb;) {
+        pawnAttacked |= pawnAttacks(o, popLsb(bb));
+    }
+    Bitboard safe = ~own & ~pawnAttacked;
+    Bitboard theirKing = pieces[colorIndex(o)][Short(PieceType::King)];
+    Bitboard kingZone = 0;
+    if (theirKing) {
+        kingZone = kingAttacks(lsbSquare(theirKing)) | theirKing;
+    }
+    for (PieceType pt : {PieceType::Queen, PieceType::Rook, PieceType::Bishop,
+                         PieceType::Knight}) {
+        Short pti = static_cast<Short>(pt);
+        for (Bitboard bb = pieces[colorIndex(c)][pti]; bb;) {
+            Bitboard attacks = pieceAttacks(pt, c, popLsb(bb), occupied);
+            term(EP_MG_MOBILITY + pti, EP_EG_MOBILITY + pti,
+                 popCount(attacks & safe));
+            term(EP_KING_ATTACK + pti, NO_EVAL_PARAM,
+                 popCount(attacks & kingZone));
+        }
+    }
+}
+
+// Tapered value of the terms above, from the point of view of c.
+EvalValue evaluateMobility(Color c, const PieceBitboards &pieces,
+                           Short phase);
+
+// ========================================
+// EvalCache
+//
+// Full static evaluations of recent positions, keyed by Zobrist key (incl.
+// side to move). The transposition table keeps search results, not static
+// evaluations, and the same leaves are evaluated again and again: In
+// quiescence search, across iterations, and across the positions of a batch
+// analysis. Fixed-size, direct-mapped and always replaced. Each Search has
+// its own, so it needs no locks.
+
+// Identifies what computed a value (e.g., which network), so that values of
+// different evaluators never mix. 0 marks an empty entry.
+using Evaluator = std::uint32_t;
+
+struct EvalCacheEntry {
+    Hash key = 0;
+    EvalValue value = 0; // From the point of view of the side to move
+    Evaluator evaluator = 0;
+};
+
+class EvalCache {
+  public:
+    EvalCache(Short sizeLog2 = 16); // 0: No entries; every probe misses
+
+    // ---------- Read methods
+    std::size_t size() const { return _entries.size(); }
+    long long hits() const { return _hits; } // Since the last clear
+    long long misses() const { return _misses; }
+
+    // ---------- Write methods
+    // The value stored for key by evaluator, if any. Counts a hit or a miss.
+    std::optional<EvalValue> probe(Hash key, Evaluator evaluator);
+    void store(Hash key, Evaluator evaluator, EvalValue value);
+    void clear();
+
+  private:
+    std::vector<EvalCacheEntry> _entries;
+    Hash _mask;
+    long long _hits;
+    long long _misses;
+};
@@ -0,0 +1,153 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Evaluation parameters, in centipawns, in the index layout of eval.h (see
+// EvalParams). Written by tune_eval from: hand-set starting values
+
+#pragma once
+
+#include <array>
+
+// clang-format off
+inline constexpr std::array<int, 822> EVAL_PARAMS{
+    // Material (mg): King, Queen, Rook, Bishop, Knight, Pawn
+       0, 1025,  477,  365,  337,   82,
+    // Material (eg)
+       0,  936,  512,  297,  281,   94,
+    // Piece-square table (mg): King
+     -30,  -40,  -40,  -50,  -50,  -40,  -40,  -30,
+     -30,  -40,  -40,  -50,  -50,  -40,  -40,  -30,
+     -30,  -40,  -40,  -50,  -50,  -40,  -40,  -30,
+     -30,  -40,  -40,  -50,  -50,  -40,  -40,  -30,
+     -20,  -30,  -30,  -40,  -40,  -30,  -30,  -20,
+     -10,  -20,  -20,  -20,  -20,  -20,  -20,  -10,
+      20,   20,    0,    0,    0,    0,   20,   20,
+      20,   30,   10,    0,    0,   10,   30,   20,
+    // Piece-square table (mg): Queen
+     -20,  -10,  -10,   -5,   -5,  -10,  -10,  -20,
+     -10,    0,    0,    0,    0,    0,    0,  -10,
+     -10,    0,    5,    5,    5,    5,    0,  -10,
+      -5,    0,    5,    5,    5,    5,    0,   -5,
+       0,    0,    5,    5,    5,    5,    0,   -5,
+     -10,    5,    5,    5,    5,    5,    0,  -10,
+     -10,    0,    5,    0,    0,    0,    0,  -10,
+     -20,  -10,  -10,   -5,   -5,  -10,  -10,  -20,
+    // Piece-square table (mg): Rook
+       0,    0,    0,    0,    0,    0,    0,    0,
+       5,   10,   10,   10,   10,   10,   10,    5,
+      -5,    0,    0,    0,    0,    0,    0,   -5,
+      -5,    0,    0,    0,    0,    0,    0,   -5,
+      -5,    0,    0,    0,    0,    0,    0,   -5,
+      -5,    0,    0,    0,    0,    0,    0,   -5,
+      -5,    0,    0,    0,    0,    0,    0,   -5,
+       0,    0,    0,    5,    5,    0,    0,    0,
+    // Piece-square table (mg): Bishop
+     -20,  -10,  -10,  -10,  -10,  -10,  -10,  -20,
+     -10,    0,    0,    0,    0,    0,    0,  -10,
+     -10,    0,    5,   10,   10,    5,    0,  -10,
+     -10,    5,    5,   10,   10,    5,    5,  -10,
+     -10,    0,   10,   10,   10,   10,    0,  -10,
+     -10,   10,   10,   10,   10,   10,   10,  -10,
+     -10,    5,    0,    0,    0,    0,    5,  -10,
+     -20,  -10,  -10,  -10,  -10,  -10,  -10,  -20,
+    // Piece-square table (mg): Knight
+     -50,  -40,  -30,  -30,  -30,  -30,  -40,  -50,
+     -40,  -20,    0,    0,    0,    0,  -20,  -40,
+     -30,    0,   10,   15,   15,   10,    0,  -30,
+     -30,    5,   15,   20,   20,   15,    5,  -30,
+     -30,    0,   15,   20,   20,   15,    0,  -30,
+     -30,    5,   10,   15,   15,   10,    5,  -30,
+     -40,  -20,    0,    5,    5,    0,  -20,  -40,
+     -50,  -40,  -30,  -30,  -30,  -30,  -40,  -50,
+    // Piece-square table (mg): Pawn
+       0,    0,    0,    0,    0,    0,    0,    0,
+      50,   50,   50,   50,   50,   50,   50,   50,
+      10,   10,   20,   30,   30,   20,   10,   10,
+       5,    5,   10,   25,   25,   10,    5,    5,
+       0,    0,    0,   20,   20,    0,    0,    0,
+       5,   -5,  -10,    0,    0,  -10,   -5,    5,
+       5,   10,   10,  -20,  -20,   10,   10,    5,
+       0,    0,    0,    0,    0,    0,    0,    0,
+    // Piece-square table (eg): King
+     -50,  -40,  -30,  -20,  -20,  -30,  -40,  -50,
+     -30,  -20,  -10,    0,    0,  -10,  -20,  -30,
+     -30,  -10,   20,   30,   30,   20,  -10,  -30,
+     -30,  -10,   30,   40,   40,   30,  -10,  -30,
+     -30,  -10,   30,   40,   40,   30,  -10,  -30,
+     -30,  -10,   20,   30,   30,   20,  -10,  -30,
+     -30,  -30,    0,    0,    0,    0,  -30,  -30,
+     -50,  -30,  -30,  -30,  -30,  -30,  -30,  -50,
+    // Piece-square table (eg): Queen
+     -20,  -10,  -10,   -5,   -5,  -10,  -10,  -20,
+     -10,    0,    0,    0,    0,    0,    0,  -10,
+     -10,    0,    5,    5,    5,    5,    0,  -10,
+      -5,    0,    5,    5,    5,    5,    0,   -5,
+       0,    0,    5,    5,    5,    5,    0,   -5,
+     -10,    5,    5,    5,    5,    5,    0,  -10,
+     -10,    0,    5,    0,    0,    0,    0,  -10,
+     -20,  -10,  -10,   -5,   -5,  -10,  -10,  -20,
+    // Piece-square table (eg): Rook
+       5,    5,    5,    5,    5,    5,    5,    5,
+      10,   10,   10,   10,   10,   10,   10,   10,
+       0,    0,    0,    0,    0,    0,    0,    0,
+       0,    0,    0,    0,    0,    0,    0,    0,
+       0,    0,    0,    0,    0,    0,    0,    0,
+       0,    0,    0,    0,    0,    0,    0,    0,
+       0,    0,    0,    0,    0,    0,    0,    0,
+       0,    0,    0,    0,    0,    0,    0,    0,
+    // Piece-square table (eg): Bishop
+     -20,  -10,  -10,  -10,  -10,  -10,  -10,  -20,
+     -10,    0,    0,    0,    0,    0,    0,  -10,
+     -10,    0,    5,   10,   10,    5,    0,  -10,
+     -10,    5,    5,   10,   10,    5,    5,  -10,
+     -10,    0,   10,   10,   10,   10,    0,  -10,
+     -10,   10,   10,   10,   10,   10,   10,  -10,
+     -10,    5,    0,    0,    0,    0,    5,  -10,
+     -20,  -10,  -10,  -10,  -10,  -10,  -10,  -20,
+    // Piece-square table (eg): Knight
+     -50,  -40,  -30,  -30,  -30,  -30,  -40,  -50,
+     -40,  -20,    0,    0,    0,    0,  -20,  -40,
+     -30,    0,   10,   15,   15,   10,    0,  -30,
+     -30,    5,   15,   20,   20,   15,    5,  -30,
+     -30,    0,   15,   20,   20,   15,    0,  -30,
+     -30,    5,   10,   15,   15,   10,    5,  -30,
+     -40,  -20,    0,    5,    5,    0,  -20,  -40,
+     -50,  -40,  -30,  -30,  -30,  -30,  -40,  -50,
+    // Piece-square table (eg): Pawn
+       0,    0,    0,    0,    0,    0,    0,    0,
+      80,   80,   80,   80,   80,   80,   80,   80,
+      50,   50,   50,   50,   50,   50,   50,   50,
+      30,   30,   30,   30,   30,   30,   30,   30,
+      15,   15,   15,   15,   15,   15,   15,   15,
+       5,    5,    5,    5,    5,    5,    5,    5,
+       0,    0,    0,    0,    0,    0,    0,    0,
+       0,    0,    0,    0,    0,    0,    0,    0,
+    // Doubled, isolated and backward Pawn (mg, eg)
+     -10,  -20,  -10,  -15,   -8,  -10,
+    // Passed Pawn, by relative row (mg)
+       0,    5,   10,   15,   25,   40,   60,    0,
+    // Passed Pawn, by relative row (eg)
+       0,   10,   20,   35,   60,  100,  150,    0,
+    // Shield Pawn advanced, shield Pawn missing (mg)
+     -10,  -25,
+    // Mobility, per safe square (mg), by PieceType
+       0,    1,    2,    4,    4,    0,
+    // Mobility, per safe square (eg)
+       0,    2,    4,    5,    4,    0,
+    // King zone attack, per square (mg), by PieceType
+       0,    5,    4,    3,    3,    0,
+};
+// clang-format on
@@ -22,7 +22,9 @@
 // #include "piece.h"
 #include "board.h"
 #include "game.h"
+#include "mcts.h"
 #include "move.h"
+#include "search.h"
 
 using std::cout, std::ostringstream;
 using std::vector;
@@ -49,7 +51,7 @@ void Game::printVerboseMatchSummary(const vector<GameState> &gss) {
 }
 
 // ---------- Constructor
-Game::Game() {
+Game::Game(const TimeControl &tc /* =TimeControl{} */) : _clock{tc} {
     // Init board not needed---use default layout
     _initPlayers();
 }
@@ -66,7 +68,11 @@ const GameState Game::gameLoop() {
         c = opponent(c);
 
         cout << "Turn #" << _board.currentMoveIndex() << " (" << to_string(c)
-             << "):\n";
+             << "):";
+        if (_clock.isEnabled()) {
+            cout << " [Clock: " << _clock << "]";
+        }
+        cout << "\n";
         cout << _board;
 
         _board.updateBoardHashHistory(c);
@@ -75,8 +81,27 @@ const GameState Game::gameLoop() {
                 ? _validPlayerMovesCache // Cached from end of prev turn
                 : Move::getValidPlayerMoves(_board, c);
 
+        // While a human thinks, an AlphaBeta opponent ponders.
+        Color opp = opponent(c);
+        bool isPondering = Player::playerType(c) == PlayerType::Human
+            && Player::playerType(opp) == PlayerType::Computer_AlphaBeta
+            && Search::forColor(opp).config().usePonder;
+        if (isPondering) {
+            _ponderer.start(Search::forColor(opp), _board, c);
+        }
+        if (_clock.isEnabled()) {
+            _clock.start(c);
+        }
         ExtMove extMove = Move::getPlayerMove(Player::playerType(c), _board, c,
                                               validPlayerMoves);
+        _clock.stop();
+        if (isPondering) {
+            _ponderer.stop(extMove.optMove);
+        }
+        if (_clock.isEnabled() && _clock.isFlagged(c)) {
+            result = GameState::timeForfeit(_board, c);
+            break;
+        }
 
         if (extMove.optMove == std::nullopt) {
             if (extMove.isDrawClaim) {
@@ -119,6 +144,12 @@ const GameState Game::gameLoop() {
                  << " Moved: " << move << "\n";
             cout << "-------------------------\n";
             move.apply(_board);
+            // MCTS bots keep the subtree below the move played.
+            for (Color mc : allColors) {
+                if (Player::playerType(mc) == PlayerType::Computer_MCTS) {
+                    Mcts::forColor(mc).advance(FastMove::fromMove(move));
+                }
+            }
 
             // Determine GameState from board
             _validPlayerMovesCache // Cached for beginning of next turn
@@ -182,6 +213,10 @@ void Game::_printGameStats() const {
     _board.printBoardHashRepetitions();
     cout << "Moves since last Pawn move or capture:\n\t"
          << _board.movesSinceLastPmoc() << "\n";
+    if (_ponderer.hits() + _ponderer.misses() > 0) {
+        cout << "Pondering (all games so far):\n\thits=" << _ponderer.hits()
+             << ", misses=" << _ponderer.misses() << "\n";
+    }
 }
 
 // ---------- Private write members
@@ -189,6 +224,14 @@ void Game::_initPlayers() {}
 
 void Game::_reset() {
     _board = Board{true};
+    _clock.reset();
+    Search::setClock(&_clock);
+    Mcts::setClock(&_clock);
+    for (Color c : allColors) {
+        if (Player::playerType(c) == PlayerType::Computer_MCTS) {
+            Mcts::forColor(c).clear(); // A new game, a new tree
+        }
+    }
     _validPlayerMovesCache.clear();
     Move::reset();
 }
@@ -19,9 +19,11 @@
 #include <vector>
 
 #include "board.h"
+#include "clock.h"
 #include "game_state.h"
 #include "move.h"
 #include "player.h"
+#include "ponder.h"
 #include "util.h"
 
 class Game {
@@ -29,7 +31,7 @@ class Game {
     static void printConciseMatchSummary(std::vector<GameState> &gss);
     static void printVerboseMatchSummary(const std::vector<GameState> &gss);
 
-    Game();
+    Game(const TimeControl &tc = TimeControl{});
 
     const GameState gameLoop();
     void play(Short autoReplayCount = 0,
@@ -47,5 +49,7 @@ class Game {
     void _reset();
 
     Board _board;
+    ChessClock _clock;
+    Ponderer _ponderer;
     Pos2Moves _validPlayerMovesCache{};
 };
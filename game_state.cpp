@@ -23,6 +23,21 @@
 #include "game_state.h"
 #include "move.h"
 #include "piece.h"
+#include "position.h"
+#include "tablebase.h"
+
+// ---------- Static methods
+GameState GameState::timeForfeit(const Board &b, Color c) {
+    PieceTypes oppPts = b.pieceTypes(opponent(c));
+    bool canOppMate = oppPts.size() > 2
+        || (oppPts.size() == 2 && oppPts[1] != PieceType::Bishop
+            && oppPts[1] != PieceType::Knight);
+    if (!canOppMate) {
+        return GameState{GameEnd::Draw, WinType::None, Draw_Clock};
+    }
+    return GameState{c == Color::White ? GameEnd::WinBlack : GameEnd::WinWhite,
+                     WinType::Clock, Draw_None};
+}
 
 // ---------- Constructors
 GameState::GameState()
@@ -101,6 +116,22 @@ GameState::GameState(const Board &b, Color colorPlayed, bool isDrawClaim,
     }
     if (_drawFlags != Draw_None) {
         _gameEnd = GameEnd::Draw;
+        return;
+    }
+
+    // Adjudicate endings covered by the active Tablebases
+    const Tablebases *tablesP = Tablebases::active();
+    if (tablesP && b.pieceCount() <= tablesP->maxPieces()) {
+        std::optional<TbValue> oValue =
+            tablesP->probe(Position::fromBoard(b, oppColor));
+        if (oValue && *oValue == TB_DRAW) {
+            _gameEnd = GameEnd::Draw;
+            _drawFlags |= Draw_Tablebase;
+        } else if (oValue && *oValue != TB_BROKEN) {
+            bool isWhiteWin = isTbWin(*oValue) == (oppColor == Color::White);
+            _gameEnd = isWhiteWin ? GameEnd::WinWhite : GameEnd::WinBlack;
+            _winType = WinType::Tablebase;
+        }
     }
 }
 
@@ -163,6 +194,12 @@ std::ostream &operator<<(std::ostream &os, const GameState &gs) {
         if ((gs._drawFlags & Draw_Stalemate) != Draw_None) {
             os << "Stalemate. ";
         }
+        if ((gs._drawFlags & Draw_Clock) != Draw_None) {
+            os << "Time forfeit, with insufficient mating material. ";
+        }
+        if ((gs._drawFlags & Draw_Tablebase) != Draw_None) {
+            os << "Tablebase. ";
+        }
         break;
     case GameEnd::WinBlack:
     case GameEnd::WinWhite:
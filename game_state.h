@@ -28,6 +28,10 @@
 // State of Game (Win, Draw, or still in play) determined after each move.
 class GameState {
   public:
+    // The flag of Color c fell. The opponent wins, unless it has too little
+    // material to checkmate (only a King, or a King and a minor piece).
+    static GameState timeForfeit(const Board &b, Color c);
+
     GameState();
     GameState(GameEnd gameEnd, WinType winType, DrawFlags drawFlags);
     GameState(const Board &b, Color c, bool isDrawClaim,
@@ -0,0 +1,139 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <csignal>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <libgen.h>
+
+#include "tablebase.h"
+#include "tb_generator.h"
+#include "thread_pool.h"
+#include "util.h"
+
+using std::cerr, std::cout;
+using std::string, std::vector;
+
+namespace {
+
+TbGenerator *generatorP = nullptr;
+
+// Interrupted: Stop at the next checkpoint, if out of core.
+void onSignal(int) {
+    if (generatorP) {
+        generatorP->stop();
+    }
+}
+
+} // namespace
+
+// Builds endgame tablebases (see TbGenerator) in a directory: For the given
+// Materials (e.g., KRPvKR), or for all Materials with the given number of
+// pieces, plus any smaller tables they need that the directory lacks. With
+// a scratch directory, tables that need more than the memory limit are
+// built out of core, and an interrupted build resumes when run again.
+int main(int argc, char **argv) {
+    string progname{basename(argv[0])};
+    vector<string> args(argv + 1, argv + argc);
+    string usage = "Usage: " + progname
+        + " [-j <threads>] [-s <scratch_dir> [-m <megabytes>]] <dir>"
+          " <material|piece_count>...\n";
+    Short threads = 0; // All hardware threads
+    string scratchDir{};
+    std::size_t memoryLimitMb = 1024;
+    std::size_t first = 0;
+    try {
+        for (; first + 1 < args.size() && args[first].size() == 2
+                 && args[first][0] == '-';
+             first += 2)
+        {
+            const string &value = args[first + 1];
+            switch (args[first][1]) {
+            case 'j': threads = std::stoi(value); break;
+            case 's': scratchDir = value; break;
+            case 'm': memoryLimitMb = std::stoul(value); break;
+            default:
+                throw std::invalid_argument("Unknown option: " + args[first]);
+            }
+        }
+    } catch (std::exception &ex) {
+        cerr << progname << ": Bad argument: " << ex.what() << "\n" << usage;
+        exit(1);
+    }
+    if (args.size() < first + 2) {
+        cerr << progname << ": " << usage;
+        exit(1);
+    }
+
+    string dir = args[first];
+    vector<Material> materials{};
+    for (std::size_t k = first + 1; k < args.size(); ++k) {
+        const string &arg = args[k];
+        std::optional<Material> oMaterial = Material::fromString(arg);
+        if (oMaterial && oMaterial->pieceCount() <= TB_MAX_PIECES) {
+            materials.push_back(*oMaterial);
+        } else if (arg.size() == 1 && arg[0] >= '3'
+                   && arg[0] <= '0' + TB_MAX_PIECES)
+        {
+            for (const Material &m : Material::all(arg[0] - '0')) {
+                materials.push_back(m);
+            }
+        } else {
+            cerr << progname << ": Not a Material with at most "
+                 << TB_MAX_PIECES << " pieces: " << arg << "\n";
+            exit(1);
+        }
+    }
+
+    ThreadPool pool{threads};
+    Tablebases tables{dir};
+    TbGenerator generator{pool, tables, [](const TbGenStats &stats) {
+        cout << stats << (stats.isSaved ? "" : " (not saved)") << "\n";
+    }};
+    cout << "threads=" << pool.size() << ", dir=" << dir;
+    if (!scratchDir.empty()) {
+        generator.setScratch(scratchDir, memoryLimitMb << 20);
+        cout << ", scratch=" << scratchDir << ", memory=" << memoryLimitMb
+             << " MB";
+    }
+    cout << "\n";
+    generatorP = &generator;
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    bool isSaved = true;
+    for (const Material &m : materials) {
+        if (generator.isStopped()) {
+            break;
+        }
+        isSaved = generator.generate(m) && isSaved;
+    }
+    if (generator.isStopped()) {
+        cerr << progname << ": Stopped."
+             << (scratchDir.empty() ? ""
+                                    : " Run again to resume from the scratch"
+                                      " directory.")
+             << "\n";
+        exit(1);
+    }
+    if (!isSaved) {
+        cerr << progname << ": Cannot write all tables to " << dir << "\n";
+        exit(1);
+    }
+}
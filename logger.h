@@ -122,6 +122,11 @@ class Logger {
         (*_outP) << std::flush;
     }
 
+    // Lets callers skip building expensive log arguments.
+    static bool isEnabled(LogLevel eventLevel) {
+        return eventLevel <= _reportLevel;
+    }
+
     static LogLevel reportLevel() {
         assert(_outP);
         return _reportLevel;
@@ -0,0 +1,347 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "mate_solver.h"
+#include "position.h"
+#include "util.h"
+
+using std::ostream, std::string;
+using std::vector;
+
+constexpr Short FIFTY_MOVE_PLIES = 100;
+
+// ========================================
+// MateSolverStats / MateResult
+
+double MateSolverStats::nodesPerSec() const {
+    return elapsed.count() > 0 ? 1000.0 * nodes / elapsed.count() : 0.0;
+}
+
+ostream &operator<<(ostream &os, const MateSolverStats &stats) {
+    os << "nodes=" << stats.nodes << " ("
+       << static_cast<long long>(stats.nodesPerSec()) << "/s)"
+       << ", hash=" << stats.hashHits << "/" << stats.hashProbes << " hits"
+       << ", time=" << stats.elapsed.count() << "ms";
+    return os;
+}
+
+string to_string(MateStatus status) {
+    switch (status) {
+    case MateStatus::Mate:   return "mate";
+    case MateStatus::NoMate: return "no mate by checks";
+    default:                 return "unknown";
+    }
+}
+
+ostream &operator<<(ostream &os, const MateResult &result) {
+    if (result.status != MateStatus::Mate) {
+        os << to_string(result.status);
+        return os;
+    }
+    os << "mate in " << (result.plies + 1) / 2 << " (" << result.plies
+       << " plies):";
+    for (std::size_t k = 0; k < result.pv.size(); ++k) {
+        os << (k == 0 ? " " : ", ") << result.pv[k];
+    }
+    return os;
+}
+
+// ========================================
+// MateHashTable
+
+// ---------- Constructor
+MateHashTable::MateHashTable(Short sizeLog2 /* =20 */)
+    : _entries(std::size_t{1} << sizeLog2), _mask{(Hash{1} << sizeLog2) - 1},
+      _probes{0}, _hits{0}
+{}
+
+// ---------- Read methods
+MateEntry MateHashTable::lookup(Hash key, Short remaining) const {
+    ++_probes;
+    const MateEntry &entry = _entries[key & _mask];
+    if (entry.remaining >= 0 && entry.key == key) {
+        bool isUsable = entry.pn == 0 ? entry.distance <= remaining
+            : entry.dn == 0           ? entry.remaining >= remaining
+                                      : entry.remaining == remaining;
+        if (isUsable) {
+            ++_hits;
+            MateEntry result{entry};
+            result.remaining = remaining;
+            return result;
+        }
+    }
+    return MateEntry{key, 1, 1, remaining, 0};
+}
+
+// ---------- Write methods
+void MateHashTable::clear() {
+    std::fill(_entries.begin(), _entries.end(), MateEntry{});
+    _probes = 0;
+    _hits = 0;
+}
+
+// ========================================
+// MateSolver
+
+// ---------- Constructor
+MateSolver::MateSolver(const MateSolverConfig &config /* =MateSolverConfig{} */)
+    : _config{config}, _stats{}, _table{config.hashSizeLog2},
+      _attacker{Color::White}, _path{}, _isAborted{false}
+{}
+
+// ---------- Public write methods
+bool MateSolver::setOption(const string &name, const string &value) {
+    // Parse into a local, so that an invalid value leaves _config unchanged.
+    try {
+        if (name == "mateNodes") {
+            long long maxNodes = std::stoll(value);
+            if (maxNodes <= 0) {
+                return false;
+            }
+            _config.maxNodes = maxNodes;
+            return true;
+        }
+        if (name == "matePlies") {
+            Short maxPlies = std::stoi(value);
+            if (maxPlies < 0 || maxPlies > MAX_MATE_PLIES) {
+                return false;
+            }
+            _config.maxPlies = maxPlies;
+            return true;
+        }
+        if (name == "mateHash") {
+            Short hashSizeLog2 = std::stoi(value);
+            if (hashSizeLog2 <= 0 || hashSizeLog2 > 30) {
+                return false;
+            }
+            _config.hashSizeLog2 = hashSizeLog2;
+            return true;
+        }
+    } catch (std::invalid_argument &ex) {
+        return false;
+    } catch (std::out_of_range &ex) {
+        return false;
+    }
+    return false;
+}
+
+// df-pn proves a mate, not necessarily the fastest one: Once a mate is
+// found, the search is repeated with a tighter ply limit, until no faster
+// mate exists. The hash table is kept, since proofs and disproofs stay valid.
+MateResult MateSolver::solve(const Position &pos) {
+    SteadyClock::time_point startTime = SteadyClock::now();
+    _stats.clear();
+    if (_table.size() != std::size_t{1} << _config.hashSizeLog2) {
+        _table = MateHashTable{_config.hashSizeLog2};
+    } else {
+        _table.clear();
+    }
+    _attacker = pos.sideToMove();
+    _path.clear();
+    _isAborted = false;
+
+    Short remaining = _config.maxPlies > 0
+        ? std::min(_config.maxPlies, MAX_MATE_PLIES)
+        : MAX_MATE_PLIES;
+    Position root{pos};
+    MateResult result{};
+    while (remaining > 0) {
+        MateEntry entry = _solveRoot(root, remaining);
+        if (entry.pn != 0) {
+            if (result.status == MateStatus::Unknown && entry.dn == 0) {
+                result.status = MateStatus::NoMate;
+            }
+            break;
+        }
+        result.status = MateStatus::Mate;
+        result.plies = entry.distance;
+        result.pv = _pv(root, entry.distance);
+        remaining = entry.distance - 2;
+    }
+    _stats.hashProbes = _table.probes();
+    _stats.hashHits = _table.hits();
+    _stats.elapsed = std::chrono::duration_cast<Millis>(SteadyClock::now()
+                                                        - startTime);
+    return result;
+}
+
+// ---------- Private read methods
+// OR nodes: Checking moves, if a ply is left and the game is not drawn.
+// AND nodes: Check evasions.
+void MateSolver::_moves(const Position &pos, FastMoves &moves) const {
+    if (!_isAttacker(pos)) {
+        pos.checkEvasions(moves);
+    } else if (pos.hasInsufficientMaterial()) {
+        moves.clear();
+    } else {
+        pos.checkingMoves(moves);
+    }
+}
+
+// From a proven position: The attacker's fastest mate, and the defender's
+// longest resistance.
+vector<FastMove> MateSolver::_pv(Position pos, Short remaining) const {
+    vector<FastMove> result{};
+    FastMoves moves{};
+    PositionUndo undo;
+    while (remaining > 0) {
+        bool isOr = _isAttacker(pos);
+        _moves(pos, moves);
+        std::optional<FastMove> best{};
+        Short bestDistance = 0;
+        for (const FastMove &move : moves) {
+            pos.makeMove(move, undo);
+            MateEntry child = _table.lookup(pos.key(), remaining - 1);
+            pos.unmakeMove(move, undo);
+            if (child.pn != 0) {
+                if (!isOr) {
+                    return result; // Part of the proof was overwritten
+                }
+                continue;
+            }
+            if (!best || (isOr ? child.distance < bestDistance
+                               : child.distance > bestDistance))
+            {
+                best = move;
+                bestDistance = child.distance;
+            }
+        }
+        if (!best) {
+            break; // Mate, or the proof was overwritten
+        }
+        result.push_back(*best);
+        pos.makeMove(*best, undo);
+        --remaining;
+    }
+    return result;
+}
+
+// ---------- Private write methods
+// The root is searched with infinite thresholds until it is proven or
+// disproven, or the node limit is reached.
+MateEntry MateSolver::_solveRoot(Position &root, Short remaining) {
+    MateEntry entry = _table.lookup(root.key(), remaining);
+    while (entry.pn != 0 && entry.dn != 0 && !_isAborted) {
+        _mid(root, remaining, PN_INFINITE, PN_INFINITE);
+        entry = _table.lookup(root.key(), remaining);
+    }
+    return entry;
+}
+
+MateEntry MateSolver::_childEntry(Position &pos, const FastMove &move,
+                                  Short remaining)
+{
+    PositionUndo undo;
+    pos.makeMove(move, undo);
+    Hash key = pos.key();
+    pos.unmakeMove(move, undo);
+    if (std::find(_path.begin(), _path.end(), key) != _path.end()) {
+        return MateEntry{key, PN_INFINITE, 0, remaining - 1, 0}; // Repetition
+    }
+    return _table.lookup(key, remaining - 1);
+}
+
+// Multiple iterative deepening: Search below the node until its proof
+// number reaches pnLimit or its disproof number reaches dnLimit.
+// OR node: pn = min(child pn), dn = sum(child dn).
+// AND node: pn = sum(child pn), dn = min(child dn).
+void MateSolver::_mid(Position &pos, Short remaining, std::uint32_t pnLimit,
+                      std::uint32_t dnLimit)
+{
+    if (++_stats.nodes > _config.maxNodes) {
+        _isAborted = true;
+        return;
+    }
+    bool isOr = _isAttacker(pos);
+    MateEntry entry{pos.key(), 1, 1, remaining, 0};
+    FastMoves moves{};
+    _moves(pos, moves);
+    if (moves.empty() && !isOr) { // Checkmate
+        entry.pn = 0;
+        entry.dn = PN_INFINITE;
+        _table.store(entry);
+        return;
+    }
+    if (moves.empty() || remaining <= 0
+        || pos.halfmoveClock() >= FIFTY_MOVE_PLIES)
+    {
+        entry.pn = PN_INFINITE;
+        entry.dn = 0;
+        _table.store(entry);
+        return;
+    }
+
+    _path.push_back(entry.key);
+    vector<MateEntry> children(moves.size());
+    PositionUndo undo;
+    while (true) {
+        // The child with the smallest pn (OR) or dn (AND) is the most
+        // proving. The second smallest bounds how far it is searched.
+        std::uint32_t minValue = PN_INFINITE;
+        std::uint32_t secondValue = PN_INFINITE;
+        std::uint32_t sum = 0;
+        Short best = 0;
+        for (Short k = 0; k < moves.size(); ++k) {
+            children[k] = _childEntry(pos, moves[k], remaining);
+            std::uint32_t value = isOr ? children[k].pn : children[k].dn;
+            std::uint32_t summand = isOr ? children[k].dn : children[k].pn;
+            if (value < minValue) {
+                secondValue = minValue;
+                minValue = value;
+                best = k;
+            } else if (value < secondValue) {
+                secondValue = value;
+            }
+            sum = summand >= PN_INFINITE || sum >= PN_INFINITE
+                ? PN_INFINITE
+                : std::min(sum + summand, PN_INFINITE - 1);
+        }
+        entry.pn = isOr ? minValue : sum;
+        entry.dn = isOr ? sum : minValue;
+        if (entry.pn >= pnLimit || entry.dn >= dnLimit || _isAborted) {
+            break;
+        }
+        const MateEntry &child = children[best];
+        std::uint32_t childPnLimit = isOr
+            ? std::min(pnLimit, secondValue + 1)
+            : pnLimit - entry.pn + child.pn;
+        std::uint32_t childDnLimit = isOr
+            ? dnLimit - entry.dn + child.dn
+            : std::min(dnLimit, secondValue + 1);
+        pos.makeMove(moves[best], undo);
+        _mid(pos, remaining - 1, childPnLimit, childDnLimit);
+        pos.unmakeMove(moves[best], undo);
+    }
+    _path.pop_back();
+
+    // Proven: The fastest mate (OR), or the longest resistance (AND).
+    if (entry.pn == 0) {
+        Short distance = isOr ? MAX_MATE_PLIES : 0;
+        for (const MateEntry &child : children) {
+            if (child.pn == 0) {
+                distance = isOr ? std::min(distance, child.distance)
+                                : std::max(distance, child.distance);
+            }
+        }
+        entry.distance = distance + 1;
+    }
+    _table.store(entry);
+}
@@ -0,0 +1,162 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "clock.h"
+#include "position.h"
+#include "util.h"
+
+// Proof and disproof numbers at least this large are infinite.
+constexpr std::uint32_t PN_INFINITE = std::uint32_t{1} << 30;
+constexpr Short MAX_MATE_PLIES = 127; // Longest mate searched for
+
+// ========================================
+// MateSolverConfig / MateSolverStats / MateResult
+
+struct MateSolverConfig {
+    long long maxNodes = 10'000'000; // Give up after expanding this many
+    Short maxPlies = 0;      // Mates in at most this many plies; 0: any
+    Short hashSizeLog2 = 20; // The hash table holds 2^hashSizeLog2 entries
+};
+
+struct MateSolverStats {
+    long long nodes = 0; // Positions expanded
+    long long hashProbes = 0;
+    long long hashHits = 0;
+    Millis elapsed{0};
+
+    double nodesPerSec() const;
+    void clear() { *this = MateSolverStats{}; }
+};
+
+std::ostream &operator<<(std::ostream &os, const MateSolverStats &stats);
+
+enum class MateStatus {
+    Mate,
+    NoMate, // No mate by a series of checks (within maxPlies)
+    Unknown // The node limit was reached
+};
+
+std::string to_string(MateStatus status);
+
+struct MateResult {
+    MateStatus status = MateStatus::Unknown;
+    Short plies = 0; // Mate: Plies of both sides, up to the mate
+    // Mate: The attacker's moves, each followed by the longest defence. It
+    // ends early if the hash table lost part of the proof.
+    std::vector<FastMove> pv;
+};
+
+std::ostream &operator<<(std::ostream &os, const MateResult &result);
+
+// ========================================
+// MateHashTable
+
+// Proof and disproof numbers from the attacker's viewpoint. A proof (pn 0)
+// holds whenever at least `distance` plies remain, and a disproof (dn 0)
+// whenever at most `remaining` plies remain; other numbers are only used
+// with the same plies remaining.
+struct MateEntry {
+    Hash key = 0;
+    std::uint32_t pn = 1;
+    std::uint32_t dn = 1;
+    Short remaining = -1; // Plies left when stored; -1: Empty
+    Short distance = 0;   // Proven: Plies to the mate
+};
+
+// Fixed-size, direct-mapped table of MateEntries, keyed by Zobrist hash.
+// Later entries replace earlier ones.
+class MateHashTable {
+  public:
+    MateHashTable(Short sizeLog2 = 20);
+
+    // ---------- Read methods
+    // The entry for the position, or a fresh one (pn = dn = 1).
+    MateEntry lookup(Hash key, Short remaining) const;
+    std::size_t size() const { return _entries.size(); }
+    long long probes() const { return _probes; }
+    long long hits() const { return _hits; }
+
+    // ---------- Write methods
+    void store(const MateEntry &entry) { _entries[entry.key & _mask] = entry; }
+    void clear();
+
+  private:
+    std::vector<MateEntry> _entries;
+    Hash _mask;
+
+    mutable long long _probes;
+    mutable long long _hits;
+};
+
+// ========================================
+// MateSolver
+
+// Depth-first proof-number search (df-pn) for a forced mate by the side to
+// move, in which every move of the attacker checks (as in most mate-in-N
+// puzzles). At OR nodes the attacker tries only checking moves; at AND
+// nodes the defender tries every check evasion. The most-proving child is
+// searched until its proof or disproof number passes a threshold derived
+// from its siblings, so memory stays bounded by the hash table. Once a mate
+// is proven, shorter ones are searched for.
+// A repetition counts as a failure for the attacker. Such disproofs are
+// stored like any other, so rarely a mate can be missed, but a reported
+// mate is always forced.
+class MateSolver {
+  public:
+    // ---------- Constructor
+    MateSolver(const MateSolverConfig &config = MateSolverConfig{});
+
+    // ---------- Public read methods
+    const MateSolverConfig &config() const { return _config; }
+    const MateSolverStats &stats() const { return _stats; }
+
+    // ---------- Public write methods
+    MateSolverConfig &config() { return _config; }
+    // Set a MateSolverConfig field by name (e.g., "mateNodes", "100000").
+    // Returns false if the name or value is not recognized.
+    bool setOption(const std::string &name, const std::string &value);
+    MateResult solve(const Position &pos);
+
+  private:
+    // ---------- Private read methods
+    bool _isAttacker(const Position &pos) const {
+        return pos.sideToMove() == _attacker;
+    }
+    void _moves(const Position &pos, FastMoves &moves) const;
+    std::vector<FastMove> _pv(Position pos, Short remaining) const;
+
+    // ---------- Private write methods
+    MateEntry _solveRoot(Position &root, Short remaining);
+    MateEntry _childEntry(Position &pos, const FastMove &move,
+                          Short remaining);
+    void _mid(Position &pos, Short remaining, std::uint32_t pnLimit,
+              std::uint32_t dnLimit);
+
+    MateSolverConfig _config;
+    MateSolverStats _stats;
+    MateHashTable _table;
+    Color _attacker;
+    std::vector<Hash> _path; // Keys of the positions being searched
+    bool _isAborted;         // The node limit was reached
+};
@@ -0,0 +1,584 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mcts.h"
+#include "move.h"
+#include "position.h"
+#include "util.h"
+
+using std::cout, std::ostream;
+using std::map, std::vector;
+
+constexpr Short PLAYOUT_DRAW_PLIES = 150; // 75 Move Rule
+// Visits added to each node of a worker's path while its playout runs. One
+// of them becomes the real visit.
+constexpr std::uint32_t VIRTUAL_LOSS = 3;
+// Pruning releases at least this share of the pool, in up to this many
+// passes (each pass can only prune nodes whose children are all leaves).
+constexpr NodeIndex PRUNE_SHARE_DIVISOR = 4;
+constexpr Short MAX_PRUNE_PASSES = 8;
+
+const ChessClock *Mcts::_clockP = nullptr;
+
+// ========================================
+// MctsStats / MctsNode
+
+double MctsStats::iterationsPerSec() const {
+    return elapsed.count() > 0 ? 1000.0 * iterations / elapsed.count() : 0.0;
+}
+
+ostream &operator<<(ostream &os, const MctsStats &stats) {
+    os << "iterations=" << stats.iterations << " ("
+       << static_cast<long long>(stats.iterationsPerSec()) << "/s)"
+       << ", threads=" << stats.threads
+       << ", playout_plies=" << stats.playoutPlies
+       << ", time=" << stats.elapsed.count() << "ms"
+       << ", tree=" << stats.nodes << " nodes ("
+       << stats.memoryBytes / 1024 << " KiB), reused="
+       << stats.reusedVisits << " visits, pruned=" << stats.prunedNodes
+       << " nodes";
+    return os;
+}
+
+void MctsNode::reset(const FastMove &m) {
+    move = m;
+    childCount = 0;
+    firstChild = 0;
+    state.store(NodeState::Leaf, std::memory_order_relaxed);
+    visits.store(0, std::memory_order_relaxed);
+    halfPoints.store(0, std::memory_order_relaxed);
+}
+
+void MctsNode::assign(const MctsNode &other) {
+    move = other.move;
+    childCount = other.childCount;
+    firstChild = other.firstChild;
+    state.store(other.state.load(std::memory_order_relaxed),
+                std::memory_order_relaxed);
+    visits.store(other.visits.load(std::memory_order_relaxed),
+                 std::memory_order_relaxed);
+    halfPoints.store(other.halfPoints.load(std::memory_order_relaxed),
+                     std::memory_order_relaxed);
+}
+
+double MctsNode::score() const {
+    std::uint32_t n = visits.load(std::memory_order_relaxed);
+    return n > 0 ? halfPoints.load(std::memory_order_relaxed) / (2.0 * n)
+                 : 0.0;
+}
+
+// ========================================
+// MctsNodePool
+
+MctsNodePool::MctsNodePool() : _nodes{nullptr}, _capacity{0}, _top{0} {}
+
+void MctsNodePool::reset(NodeIndex capacity) {
+    if (capacity != _capacity) {
+        _capacity = capacity;
+        _nodes.reset(new MctsNode[_capacity]);
+    }
+    _top.store(1);
+    _nodes[0].reset(FastMove{});
+}
+
+std::optional<NodeIndex> MctsNodePool::allocate(NodeIndex count) {
+    NodeIndex top = _top.load(std::memory_order_relaxed);
+    while (top + count <= _capacity) {
+        if (_top.compare_exchange_weak(top, top + count)) {
+            return top;
+        }
+    }
+    return std::nullopt;
+}
+
+// ========================================
+// Mcts
+
+// ---------- Static methods
+Mcts &Mcts::forColor(Color c) {
+    static map<Color, Mcts> c2m;
+    return c2m[c];
+}
+
+ExtMove Mcts::strategyMcts(const Board &b, Color c,
+                           const Pos2Moves &validPlayerMoves)
+{
+    Mcts &mcts = Mcts::forColor(c);
+    if (_clockP && _clockP->isEnabled()) {
+        mcts.timeManager().start(_clockP->remaining(c),
+                                 _clockP->timeControl().increment);
+    } else {
+        mcts.timeManager().startUnlimited();
+    }
+    FastMove best = mcts.search(Position::fromBoard(b, c));
+    OptMove optMove = _toMove(best, validPlayerMoves);
+    if (!optMove) {
+        return Move::strategyRandomCapture(b, c, validPlayerMoves);
+    }
+    const MctsNode &bestNode = *mcts.children(mcts.root()).front();
+    cout << "MCTS (" << to_string(c) << "): best=" << optMove->to_pgn()
+         << ", visits=" << bestNode.visits << ", score=" << bestNode.score()
+         << "; " << mcts.stats() << "\n";
+    return ExtMove(optMove, false, GameEnd::InPlay);
+}
+
+// ---------- Constructor
+Mcts::Mcts(const MctsConfig &config /* =MctsConfig{} */)
+    : _config{config}, _stats{}, _timeManager{}, _pool{}, _rootPos{},
+      _hasTree{false}, _iterations{0}, _isPoolFull{false},
+      _isPruningDone{false}, _prng{prng()()}
+{}
+
+// ---------- Public read methods
+vector<const MctsNode *> Mcts::children(const MctsNode &node) const {
+    vector<const MctsNode *> result{};
+    for (NodeIndex k = 0; k < node.childCount; ++k) {
+        result.push_back(&_pool[node.firstChild + k]);
+    }
+    std::stable_sort(result.begin(), result.end(),
+                     [](const MctsNode *a, const MctsNode *b) {
+                         return a->visits > b->visits;
+                     });
+    return result;
+}
+
+// ---------- Public write methods
+bool Mcts::setOption(const std::string &name, const std::string &value) {
+    // Parse into a local, so that an invalid value leaves _config unchanged.
+    try {
+        if (name == "iterations") {
+            long long maxIterations = std::stoll(value);
+            if (maxIterations <= 0) {
+                return false;
+            }
+            _config.maxIterations = maxIterations;
+            return true;
+        }
+        if (name == "exploration") {
+            double exploration = std::stod(value);
+            if (!std::isfinite(exploration) || exploration < 0) {
+                return false;
+            }
+            _config.exploration = exploration;
+            return true;
+        }
+        if (name == "playoutPlies") {
+            Short maxPlayoutPlies = std::stoi(value);
+            if (maxPlayoutPlies <= 0) {
+                return false;
+            }
+            _config.maxPlayoutPlies = maxPlayoutPlies;
+            return true;
+        }
+        if (name == "threads") {
+            Short threads = std::stoi(value);
+            if (threads <= 0) {
+                return false;
+            }
+            _config.threads = threads;
+            return true;
+        }
+        if (name == "nodes") {
+            long long maxNodes = std::stoll(value);
+            if (maxNodes <= MAX_POSITION_MOVES || maxNodes >= (1LL << 32)) {
+                return false;
+            }
+            _config.maxNodes = maxNodes;
+            return true;
+        }
+    } catch (std::invalid_argument &ex) {
+        return false;
+    } catch (std::out_of_range &ex) {
+        return false;
+    }
+    return false;
+}
+
+// The caller starts the TimeManager. With a time limit, iterations continue
+// until the soft limit; otherwise, until maxIterations.
+// The workers stop when the pool is full. It is pruned, and they restart.
+FastMove Mcts::search(const Position &pos) {
+    SteadyClock::time_point startTime = SteadyClock::now();
+    _stats.clear();
+    if (!_hasTree || pos.key() != _rootPos.key()
+        || _pool.capacity() != _config.maxNodes)
+    {
+        _pool.reset(_config.maxNodes);
+        _rootPos = pos;
+        _hasTree = true;
+    }
+    _stats.reusedVisits = root().visits;
+    _iterations.store(0);
+    _isPruningDone = false;
+
+    if (root().state != NodeState::Expanded && !_expand(0, pos)) {
+        _prune();
+        _expand(0, pos);
+    }
+    vector<Worker> workers(_config.threads);
+    for (Worker &worker : workers) {
+        worker.prng.seed(_prng());
+    }
+    while (root().childCount > 0) {
+        _isPoolFull.store(false);
+        vector<std::thread> threads{};
+        for (Short k = 1; k < _config.threads; ++k) {
+            threads.emplace_back(&Mcts::_work, this, std::cref(pos),
+                                 std::ref(workers[k]));
+        }
+        _work(pos, workers[0]);
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+        if (!_isPoolFull.load() || _isDone(_iterations.load())) {
+            break;
+        }
+        _isPruningDone = _prune() == 0;
+    }
+    for (const Worker &worker : workers) {
+        _stats.playoutPlies += worker.playoutPlies;
+    }
+    _stats.iterations = _iterations.load();
+    _stats.threads = _config.threads;
+    _stats.elapsed = std::chrono::duration_cast<Millis>(SteadyClock::now()
+                                                        - startTime);
+    _stats.nodes = _pool.used();
+    _stats.memoryBytes = std::size_t{_pool.capacity()} * sizeof(MctsNode);
+    return root().childCount > 0 ? children(root()).front()->move
+                                 : FastMove{};
+}
+
+void Mcts::advance(const FastMove &move) {
+    if (!_hasTree) {
+        return;
+    }
+    PositionUndo undo;
+    _rootPos.makeMove(move, undo);
+    const MctsNode &node = root();
+    if (node.state == NodeState::Expanded) {
+        for (NodeIndex index = node.firstChild;
+             index < node.firstChild + node.childCount; ++index)
+        {
+            if (_pool[index].move == move) {
+                _reroot(index);
+                return;
+            }
+        }
+    }
+    _hasTree = false; // Not in the tree
+}
+
+// ---------- Private static method
+OptMove Mcts::_toMove(const FastMove &fastMove,
+                      const Pos2Moves &validPlayerMoves)
+{
+    auto found = validPlayerMoves.find(Pos(fastMove.from()));
+    if (fastMove.isNull() || found == validPlayerMoves.end()) {
+        return std::nullopt;
+    }
+    for (const Move &move : found->second) {
+        if (move.to().index() == fastMove.to()) {
+            Move result{move};
+            if (fastMove.isPromotion()) {
+                result.setPromotionType(fastMove.promotionType());
+            }
+            return result;
+        }
+    }
+    return std::nullopt;
+}
+
+// ---------- Private read methods
+bool Mcts::_isDone(long long iteration) const {
+    if (_timeManager.isLimited()) {
+        return _timeManager.elapsed() >= _timeManager.softLimit();
+    }
+    return iteration >= _config.maxIterations;
+}
+
+// UCT: Mean result plus an exploration bonus that shrinks with visits.
+// Unvisited children are tried first.
+NodeIndex Mcts::_select(NodeIndex parent) const {
+    const MctsNode &node = _pool[parent];
+    double logVisits = std::log(static_cast<double>(node.visits.load(
+        std::memory_order_relaxed)));
+    NodeIndex best = node.firstChild;
+    double bestValue = -1.0;
+    for (NodeIndex index = node.firstChild;
+         index < node.firstChild + node.childCount; ++index)
+    {
+        const MctsNode &child = _pool[index];
+        std::uint32_t visits = child.visits.load(std::memory_order_relaxed);
+        if (visits == 0) {
+            return index;
+        }
+        double value = child.halfPoints.load(std::memory_order_relaxed)
+            / (2.0 * visits)
+            + _config.exploration * std::sqrt(logVisits / visits);
+        if (value > bestValue) {
+            bestValue = value;
+            best = index;
+        }
+    }
+    return best;
+}
+
+// ---------- Private write methods
+// Move the blocks of children reachable from the root down to the bottom of
+// the pool, keeping their order, and release the nodes above them. A block
+// always lies above its parent (it was allocated after the parent, and
+// compaction keeps the order), so the parent has moved already when its
+// children do. Called while no worker runs.
+void Mcts::_compact() {
+    vector<std::pair<NodeIndex, NodeIndex>> blocks{}; // (first, parent)
+    vector<NodeIndex> stack{0};
+    while (!stack.empty()) {
+        NodeIndex index = stack.back();
+        stack.pop_back();
+        const MctsNode &node = _pool[index];
+        if (node.childCount > 0) {
+            blocks.emplace_back(node.firstChild, index);
+        }
+        for (NodeIndex k = 0; k < node.childCount; ++k) {
+            stack.push_back(node.firstChild + k);
+        }
+    }
+    std::sort(blocks.begin(), blocks.end());
+
+    vector<NodeIndex> newFirsts(blocks.size());
+    NodeIndex top = 1;
+    for (std::size_t b = 0; b < blocks.size(); ++b) {
+        auto [first, parent] = blocks[b];
+        // The block that held the parent, unless the parent is the root
+        auto above = std::upper_bound(
+            blocks.begin(), blocks.begin() + b, parent,
+            [](NodeIndex index, const std::pair<NodeIndex, NodeIndex> &block) {
+                return index < block.first;
+            });
+        if (above != blocks.begin()) {
+            std::size_t j = above - blocks.begin() - 1;
+            parent = newFirsts[j] + (parent - blocks[j].first);
+        }
+        MctsNode &parentNode = _pool[parent];
+        if (top != first) {
+            for (NodeIndex k = 0; k < parentNode.childCount; ++k) {
+                _pool[top + k].assign(_pool[first + k]);
+            }
+        }
+        parentNode.firstChild = top;
+        newFirsts[b] = top;
+        top += parentNode.childCount;
+    }
+    _pool.truncate(top);
+}
+
+// The caller owns the node (see NodeState::Expanding). Returns false, leaving
+// a Leaf, if the pool is full.
+bool Mcts::_expand(NodeIndex index, const Position &pos) {
+    MctsNode &node = _pool[index];
+    FastMoves moves{};
+    bool isDraw = pos.halfmoveClock() >= PLAYOUT_DRAW_PLIES
+        || pos.hasInsufficientMaterial();
+    if (!isDraw) {
+        pos.legalMoves(moves);
+    }
+    NodeIndex count = moves.size();
+    std::optional<NodeIndex> first{0};
+    if (count > 0) {
+        first = _pool.allocate(count);
+    }
+    if (!first) {
+        node.state.store(NodeState::Leaf, std::memory_order_release);
+        if (!_isPruningDone) {
+            _isPoolFull.store(true);
+        }
+        return false;
+    }
+    for (NodeIndex k = 0; k < count; ++k) {
+        _pool[*first + k].reset(moves[k]);
+    }
+    node.firstChild = *first;
+    node.childCount = count;
+    node.state.store(NodeState::Expanded, std::memory_order_release);
+    return true;
+}
+
+// Collapse the least visited nodes whose children are all leaves, until a
+// share of the pool is released, and compact the tree. Called while no
+// worker runs.
+NodeIndex Mcts::_prune() {
+    NodeIndex target = _pool.capacity() / PRUNE_SHARE_DIVISOR;
+    NodeIndex released = 0;
+    for (Short pass = 0; pass < MAX_PRUNE_PASSES && released < target; ++pass)
+    {
+        vector<std::pair<std::uint32_t, NodeIndex>> candidates{};
+        vector<NodeIndex> stack{0};
+        while (!stack.empty()) {
+            NodeIndex index = stack.back();
+            stack.pop_back();
+            const MctsNode &node = _pool[index];
+            bool hasOnlyLeaves = true;
+            for (NodeIndex k = 0; k < node.childCount; ++k) {
+                NodeIndex childIndex = node.firstChild + k;
+                if (_pool[childIndex].childCount > 0) {
+                    hasOnlyLeaves = false;
+                    stack.push_back(childIndex);
+                }
+            }
+            if (hasOnlyLeaves && node.childCount > 0 && index != 0) {
+                candidates.emplace_back(node.visits, index);
+            }
+        }
+        if (candidates.empty()) {
+            break;
+        }
+        std::sort(candidates.begin(), candidates.end());
+        for (const auto &[visits, index] : candidates) {
+            if (released >= target) {
+                break;
+            }
+            MctsNode &node = _pool[index];
+            released += node.childCount;
+            node.childCount = 0;
+            node.firstChild = 0;
+            node.state.store(NodeState::Leaf);
+        }
+    }
+    _compact();
+    _stats.prunedNodes += released;
+    return released;
+}
+
+// The node becomes the root, and the nodes outside its subtree are
+// released. Called while no worker runs.
+void Mcts::_reroot(NodeIndex index) {
+    _pool[0].assign(_pool[index]);
+    _compact();
+}
+
+void Mcts::_iterate(const Position &rootPos, Worker &worker) {
+    Position pos{rootPos};
+    PositionUndo undo;
+
+    // Selection, with a virtual loss on each node of the path
+    worker.path.clear();
+    worker.path.push_back(0);
+    _pool[0].visits.fetch_add(VIRTUAL_LOSS, std::memory_order_relaxed);
+    NodeIndex index = 0;
+    while (_pool[index].state.load(std::memory_order_acquire)
+               == NodeState::Expanded
+           && _pool[index].childCount > 0)
+    {
+        index = _select(index);
+        _pool[index].visits.fetch_add(VIRTUAL_LOSS, std::memory_order_relaxed);
+        pos.makeMove(_pool[index].move, undo);
+        worker.path.push_back(index);
+    }
+
+    // Expansion: A leaf gets children on its second visit, which keeps
+    // single-visit leaves cheap.
+    MctsNode &leaf = _pool[index];
+    NodeState expected = NodeState::Leaf;
+    if (leaf.visits.load(std::memory_order_relaxed) > VIRTUAL_LOSS
+        && leaf.state.compare_exchange_strong(expected, NodeState::Expanding)
+        && _expand(index, pos) && leaf.childCount > 0)
+    {
+        index = _select(index);
+        _pool[index].visits.fetch_add(VIRTUAL_LOSS, std::memory_order_relaxed);
+        pos.makeMove(_pool[index].move, undo);
+        worker.path.push_back(index);
+    }
+
+    // Simulation (returns at once if the game is over), and backpropagation,
+    // which replaces the virtual losses with one visit. The node at depth k
+    // was reached by a move of the root's side to move iff k is odd.
+    std::uint32_t whiteHalfPoints = _playout(pos, worker);
+    Color rootColor = rootPos.sideToMove();
+    for (std::size_t k = 0; k < worker.path.size(); ++k) {
+        MctsNode &node = _pool[worker.path[k]];
+        Color mover = k % 2 == 1 ? rootColor : opponent(rootColor);
+        node.halfPoints.fetch_add(mover == Color::White ? whiteHalfPoints
+                                                        : 2 - whiteHalfPoints,
+                                  std::memory_order_relaxed);
+        node.visits.fetch_sub(VIRTUAL_LOSS - 1, std::memory_order_relaxed);
+    }
+}
+
+// The policy of Move::strategyRandomCapture: A random capture if there is
+// one, else a random move. Pawns promote to Queens.
+std::uint32_t Mcts::_playout(Position &pos, Worker &worker) const {
+    auto isPolicyMove = [](const FastMove &move) {
+        return !move.isPromotion() || move.promotionType() == PieceType::Queen;
+    };
+    FastMoves moves{};
+    PositionUndo undo;
+    for (Short ply = 0; ply < _config.maxPlayoutPlies; ++ply) {
+        if (pos.halfmoveClock() >= PLAYOUT_DRAW_PLIES
+            || pos.hasInsufficientMaterial())
+        {
+            return 1;
+        }
+        pos.legalMoves(moves);
+        if (moves.empty()) {
+            if (!pos.isInCheck()) {
+                return 1; // Stalemate
+            }
+            return pos.sideToMove() == Color::White ? 0 : 2;
+        }
+
+        Short moveCount = 0;
+        Short captureCount = 0;
+        for (const FastMove &move : moves) {
+            if (isPolicyMove(move)) {
+                ++moveCount;
+                captureCount += pos.isCapture(move);
+            }
+        }
+        bool isCaptureOnly = captureCount > 0;
+        std::uniform_int_distribution<Short> randIntGen{
+            0, (isCaptureOnly ? captureCount : moveCount) - 1};
+        Short choice = randIntGen(worker.prng);
+        for (const FastMove &move : moves) {
+            if (isPolicyMove(move) && (!isCaptureOnly || pos.isCapture(move))
+                && choice-- == 0)
+            {
+                pos.makeMove(move, undo);
+                break;
+            }
+        }
+        ++worker.playoutPlies;
+    }
+    return 1;
+}
+
+// Each worker claims iterations from the shared count.
+void Mcts::_work(const Position &rootPos, Worker &worker) {
+    while (true) {
+        long long iteration = _iterations.fetch_add(1);
+        if (_isDone(iteration) || _isPoolFull.load()) {
+            _iterations.fetch_sub(1);
+            return;
+        }
+        _iterate(rootPos, worker);
+    }
+}
@@ -0,0 +1,201 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "board.h"
+#include "clock.h"
+#include "move.h"
+#include "position.h"
+#include "time_manager.h"
+#include "util.h"
+
+using NodeIndex = std::uint32_t;
+
+// ========================================
+// MctsConfig / MctsStats / MctsNode
+
+struct MctsConfig {
+    long long maxIterations = 20'000; // Per move, unless the clock is running
+    double exploration = 1.4;         // UCT exploration constant
+    Short maxPlayoutPlies = 200;      // Longer playouts are scored as Draws
+    Short threads = 1;                // Workers sharing the tree
+    NodeIndex maxNodes = 1 << 21;     // Node pool capacity
+};
+
+struct MctsStats {
+    long long iterations = 0;
+    long long playoutPlies = 0;
+    std::size_t nodes = 0;       // Tree size (pool nodes in use)
+    std::size_t memoryBytes = 0; // Allocated for the node pool
+    Short threads = 1;
+    long long reusedVisits = 0;  // Root visits kept from earlier searches
+    long long prunedNodes = 0;   // Released because the pool was full
+    Millis elapsed{0};
+
+    double iterationsPerSec() const;
+    void clear() { *this = MctsStats{}; }
+};
+
+std::ostream &operator<<(std::ostream &os, const MctsStats &stats);
+
+enum class NodeState : std::uint8_t { Leaf, Expanding, Expanded };
+
+// A Position reached in the tree. The children of a node are contiguous in
+// the pool, so it only records the index of the first.
+// Worker threads update the statistics without locks. A node's children are
+// published by setting its state to Expanded, after they are initialized.
+struct MctsNode {
+    FastMove move;                // The move leading to this node
+    std::uint16_t childCount = 0;
+    NodeIndex firstChild = 0;
+    std::atomic<NodeState> state{NodeState::Leaf}; // Expanded without
+                                                  // children: Game over
+    std::atomic<std::uint32_t> visits{0}; // Incl. virtual losses in progress
+    std::atomic<std::uint32_t> halfPoints{0}; // For the side that moved
+
+    void reset(const FastMove &m);
+    void assign(const MctsNode &other); // The atomics are not copyable
+    double score() const; // Mean result, from 0 (loss) to 1 (win)
+};
+
+// ========================================
+// MctsNodePool
+
+// Fixed-capacity storage for MctsNodes, addressed by index. Node 0 is the
+// root. Blocks of children are taken from the top of the pool without
+// locking. Nodes are not released block by block: Mcts moves the nodes
+// still in the tree down to the bottom (see Mcts::_compact) and lowers the
+// top, so the free nodes are always contiguous.
+class MctsNodePool {
+  public:
+    MctsNodePool();
+
+    // ---------- Public read methods
+    NodeIndex capacity() const { return _capacity; }
+    NodeIndex used() const { return _top.load(); }
+    const MctsNode &operator[](NodeIndex index) const { return _nodes[index]; }
+
+    // ---------- Public write methods
+    MctsNode &operator[](NodeIndex index) { return _nodes[index]; }
+    // Release all nodes but the root. The capacity must exceed
+    // MAX_POSITION_MOVES.
+    void reset(NodeIndex capacity);
+    std::optional<NodeIndex> allocate(NodeIndex count); // Thread-safe
+    // Release the nodes from top on. Not thread-safe.
+    void truncate(NodeIndex top) { _top.store(top); }
+
+  private:
+    std::unique_ptr<MctsNode[]> _nodes;
+    NodeIndex _capacity;
+    std::atomic<NodeIndex> _top; // Nodes from here on are free
+};
+
+// ========================================
+// Mcts
+
+// Monte Carlo tree search with UCT selection. Each iteration selects a path
+// down the tree, expands its leaf (once the leaf has been visited), plays a
+// random game from there, and backs the result up the path.
+// Playouts follow the policy of Move::strategyRandomCapture, on a Position.
+// With several threads, the workers share one tree (tree parallelism). A
+// node on a worker's path carries a virtual loss until the result is backed
+// up, which steers the other workers towards different paths. A leaf is
+// expanded by the worker that claims it; the others play out from it.
+// The tree is kept between moves: After each move played (see advance), the
+// subtree below it becomes the tree, and the rest of the pool is released.
+// When the pool fills up, the least visited nodes whose children are all
+// leaves lose their children, the tree is compacted, and the search goes on.
+class Mcts {
+  public:
+    // ---------- Static methods
+    static Mcts &forColor(Color c); // Each computer Player has its own
+    // The Game clock used to budget the time of strategyMcts, or nullptr.
+    static void setClock(const ChessClock *clockP) { _clockP = clockP; }
+    static ExtMove strategyMcts(const Board &b, Color c,
+                                const Pos2Moves &validPlayerMoves);
+
+    // ---------- Constructor
+    Mcts(const MctsConfig &config = MctsConfig{});
+
+    // ---------- Public read methods
+    const MctsConfig &config() const { return _config; }
+    const MctsStats &stats() const { return _stats; }
+    const MctsNode &root() const { return _pool[0]; }
+    // Children of a node, most visited first.
+    std::vector<const MctsNode *> children(const MctsNode &node) const;
+
+    // ---------- Public write methods
+    MctsConfig &config() { return _config; }
+    TimeManager &timeManager() { return _timeManager; }
+    // Set a MctsConfig field by name (e.g., "iterations", "20000"). Returns
+    // false if the name or value is not recognized.
+    bool setOption(const std::string &name, const std::string &value);
+    // The most visited root move, or a null move if the game is over. The
+    // tree of an earlier search is reused if pos is its root.
+    FastMove search(const Position &pos);
+    // A move was played from the root Position: Keep its subtree.
+    void advance(const FastMove &move);
+    void clear() { _hasTree = false; } // Forget the tree, e.g., between games
+
+  private:
+    // State private to a worker thread, on its own cache lines
+    struct alignas(64) Worker {
+        std::mt19937 prng;
+        std::vector<NodeIndex> path; // Selected in the current iteration
+        long long playoutPlies = 0;
+    };
+
+    static const ChessClock *_clockP;
+
+    // ---------- Private static method
+    static OptMove _toMove(const FastMove &fastMove,
+                           const Pos2Moves &validPlayerMoves);
+
+    // ---------- Private read methods
+    bool _isDone(long long iteration) const;
+    NodeIndex _select(NodeIndex parent) const;
+
+    // ---------- Private write methods
+    void _compact();
+    bool _expand(NodeIndex index, const Position &pos);
+    NodeIndex _prune(); // Returns the number of nodes released
+    void _reroot(NodeIndex index);
+    void _iterate(const Position &rootPos, Worker &worker);
+    // Result for White: 2 (win), 1 (draw) or 0 half points
+    std::uint32_t _playout(Position &pos, Worker &worker) const;
+    void _work(const Position &rootPos, Worker &worker); // Until _isDone
+
+    MctsConfig _config;
+    MctsStats _stats;
+    TimeManager _timeManager;
+    MctsNodePool _pool;
+    Position _rootPos;
+    bool _hasTree;
+    std::atomic<long long> _iterations;
+    std::atomic<bool> _isPoolFull; // Workers stop, so that it can be pruned
+    bool _isPruningDone; // Nothing left to prune: Search without expanding
+    std::mt19937 _prng; // Seeds the Workers
+};
@@ -17,11 +17,14 @@
 #include <regex>
 #include <string>
 
+#include "bitboard.h"
 #include "board.h"
 #include "geometry.h"
+#include "mcts.h"
 #include "move.h"
 #include "piece.h"
 #include "player.h"
+#include "search.h"
 #include "util.h"
 
 #include "logger.h"
@@ -29,6 +32,9 @@
 using std::cin, std::cout, std::ostringstream;
 using std::pair, std::map, std::vector;
 using std::string, std::ostream, std::to_string;
+
+// Search depth used to rank moves for the interactive 'moves' command
+constexpr Short MOVES_RANKING_DEPTH = 2;
 // using GetPlayerMove = std::function<ExtMove(const Board&, Color, const
 // Pos2Moves&)>;
 
@@ -50,7 +56,7 @@ ostream &operator<<(ostream &os, MoveType moveType) {
 PieceType2IsAttackingRule Move::_pieceType2IsAttackingRule =
     Move::_createIsAttackingRules();
 PieceType2MoveRule Move::_pieceType2MoveRule = Move::_createMoveRules();
-Moves Move::_moveHistory = Move::_createHistory();
+thread_local Moves Move::_moveHistory = Move::_createHistory();
 
 // ---------- Public static methods
 const IsAttackingRule &Move::getIsAttackingRule(PieceType pt) {
@@ -120,17 +126,13 @@ bool Move::isAttacking(const Board &b, const Piece &attacker, const Pos &tgtPos,
     return false;
 }
 
+// With the attack tables of bitboard.h, which move generation on Position
+// and the mobility terms of the evaluation also use.
 bool Move::isInCheck(const Board &b, Color c) noexcept {
     const Piece &king = b.king(c);
     assert(king.pieceType() == PieceType::King);
-    for (const PieceP &attackerP : b.color2PiecePs.at(opponent(c))) {
-        IsAttackingRule isAttackingRule =
-            Move::getIsAttackingRule(attackerP->pieceType());
-        if (isAttackingRule(b, *attackerP, king.pos())) {
-            return true;
-        }
-    }
-    return false;
+    return isSquareAttacked(b.pieceBitboards(), king.pos().index(),
+                            opponent(c));
 }
 
 bool Move::pawnIsAttackingRule(const Board &b, const Piece &attacker,
@@ -237,6 +239,12 @@ ExtMove Move::getPlayerMove(PlayerType playerType, const Board &b, Color c,
     case PlayerType::Computer_RandomCapture:
         result = Move::strategyRandomCapture(b, c, validPlayerMoves);
         break;
+    case PlayerType::Computer_AlphaBeta:
+        result = Search::strategyAlphaBeta(b, c, validPlayerMoves);
+        break;
+    case PlayerType::Computer_MCTS:
+        result = Mcts::strategyMcts(b, c, validPlayerMoves);
+        break;
     }
     return result;
 }
@@ -262,10 +270,13 @@ Moves Move::getValidPieceMoves(
         Pos dest{pos};
         for (Short stepCount = 1; stepCount <= maxSteps; ++stepCount) {
             dest = dest + dir; // Step in direction dir
-            ostringstream moveDesc_oss;
-            moveDesc_oss << c << pt << "_@_" << pos << "-->" << dest
-                         << " (dir=" << dir << ')';
-            string moveDesc = moveDesc_oss.str();
+            string moveDesc;
+            if (Logger::isEnabled(LogTrace)) {
+                ostringstream moveDesc_oss;
+                moveDesc_oss << c << pt << "_@_" << pos << "-->" << dest
+                             << " (dir=" << dir << ')';
+                moveDesc = moveDesc_oss.str();
+            }
             Logger::trace("    getValidPieceMoves: Checking move: ", moveDesc);
             if (!dest.isOnBoard()) {
                 break; // Done stepping in this direction
@@ -408,7 +419,7 @@ ExtMove Move::queryPlayerMove(
         "  * history: Show move history in a compact, but easily-readable "
         "format.\n"
         "  *   pgn: Show move history in a verbose PGN input format.\n"
-        "  * moves:   Show legal moves.\n"
+        "  * moves:   Show legal moves, ranked by a shallow search.\n"
         "  * pieces:  List the pieces on the board.\n"
         "\n"
         "  * log_level: Display the current log reporting level.\n"
@@ -427,8 +438,6 @@ ExtMove Move::queryPlayerMove(
                    )
                << " (or '?' for more options): ";
 
-    PosMovesComparator pmComparator{b};
-
     cout << "========================================\n";
     cout << (c == Color::Black ? "Black" : "White") << " ("
          << Player::playerName(c) << ") to play.\n";
@@ -548,16 +557,25 @@ ExtMove Move::queryPlayerMove(
             }
 
             if (cmd == "moves") {
-                cout << "List of valid moves:\n";
-                vector<pair<Pos, Moves>> playerMoves =
-                    mapToVector(validPlayerMoves);
-                std::sort(playerMoves.begin(), playerMoves.end(), pmComparator);
-                for (const auto &[from, moves] : playerMoves) {
-                    PieceType pt = b.pieceAt(from).get()->pieceType();
-                    cout << "  Moves of " << pt << " @ " << from.algNotation()
-                         << " (" << moves.size() << "): ";
-                    for (const Move &move : moves) {
-                        cout << move.to().algNotation() << ' ';
+                // Rank all legal moves with a shallow multi-PV search.
+                static Search analysis{SearchConfig{MOVES_RANKING_DEPTH}};
+                Short moveCount = concatMap(validPlayerMoves).size();
+                vector<SearchResult> results = analysis.searchMultiPv(
+                    const_cast<Board &>(b), c, moveCount); // Temp changes
+                cout << "List of valid moves, best first (score in "
+                     << "centipawns, search depth "
+                     << MOVES_RANKING_DEPTH << "):\n";
+                for (Short k = 0; k < Short(results.size()); ++k) {
+                    const SearchResult &result = results[k];
+                    if (!result.bestMove) {
+                        continue;
+                    }
+                    cout << std::setw(4) << std::right << k + 1 << ". "
+                         << std::setw(7) << std::left
+                         << result.bestMove->to_pgn() << std::setw(8)
+                         << std::right << result.score << "  pv:";
+                    for (const Move &move : result.pv) {
+                        cout << ' ' << move.to_pgn();
                     }
                     cout << "\n";
                 }
@@ -692,6 +710,10 @@ Move::Move(Color color, PieceType pt, const Pos from, const Pos to,
 
 // ---------- Public read methods
 
+Pos Move::capturedPos() const {
+    return _isEnPassant ? _to + Player::backward(_color) : _to;
+}
+
 bool Move::isCastling() const {
     return _pieceType == PieceType::King && abs(_to.xdiff(_from)) == 2;
 }
@@ -759,14 +781,15 @@ void Move::apply(Board &b) const {
 
     // Capture, including en passant
     if (_capturedP) {
-        b.removePieceAt(_capturedP.get()->pos());
-        assert(!b.pieceAt(_capturedP.get()->pos()));
+        const Pos &capturePos = capturedPos();
+        b.removePieceAt(capturePos);
+        assert(!b.pieceAt(capturePos));
     }
 
     // Move & promote
     b.movePiece(_from, _to);
     if (isPromotion()) {
-        b.pieceAt(_to).get()->setPieceType(*_oPromotedTo);
+        b.setPieceTypeAt(_to, *_oPromotedTo);
     }
 
     // Move secondary pieces
@@ -839,23 +862,17 @@ void Move::applyUndo(Board &b) const {
     }
 
     // Restore Piece type (un-promote)
-    Piece &movedPiece = *(b.pieceAt(_to).get());
     if (moveType == MoveType::PawnPromotion) {
-        movedPiece.setPieceType(PieceType::Pawn);
+        b.setPieceTypeAt(_to, PieceType::Pawn);
     }
 
     // Restore Piece location (un-move)
     b.movePiece(_to, _from);
 
-    // Restore captured piece
-    if (moveType == MoveType::EnPassant) {
-        // Restore captured Pawn
-        Short restorePos = (_to + Player::backward(movedPiece.color())).index();
-        b.addPieceTo(opponent(movedPiece.color()), PieceType::Pawn, restorePos);
-    } else if (_capturedP) {
-        // Restore captured piece
-        b.addPieceTo(opponent(movedPiece.color()),
-                     _capturedP.get()->pieceType(), _to.index());
+    // Restore captured piece, including en passant. Re-adding the same Piece
+    // preserves its MoveIndex history.
+    if (_capturedP) {
+        b.addPiecePTo(_capturedP, capturedPos());
     }
 
     Logger::trace("Move::applyUndo: Exiting. move=", *this);
@@ -33,6 +33,7 @@ class Move;
 class PosMovesComparator;
 
 using OptMove = std::optional<Move>;
+using MoveCode = Short; // Compact (from, to) key: from.index() * 64 + to.index()
 using Pos2Moves = std::map<Pos, Moves>;
 
 enum class CaptureAbility { CanCapture, MustCapture, MustNotCapture };
@@ -58,6 +59,8 @@ class Move {
     static Move &prevMove() { return _moveHistory.back(); }
 
     static void reset() { _moveHistory.clear(); }
+    // Each thread has its own history. A background search starts from a copy.
+    static void setMoveHistory(const Moves &moves) { _moveHistory = moves; }
 
     // ---------- Public static methods (attacking / moving rules)
     // The attack methods help determine whethera King is in check, and whether
@@ -120,6 +123,10 @@ class Move {
     bool isPawnMoveOrCapture() const { return _isPawnMove || _capturedP; }
     bool isPromotion() const { return _oPromotedTo != std::nullopt; }
     const PieceP capturedP() const { return _capturedP; }
+    Pos capturedPos() const; // Differs from to() for en passant
+    MoveCode code() const {
+        return _from.index() * BOARD_SPACES + _to.index();
+    }
     PieceType promotionType() const { return *_oPromotedTo; }
     const std::string to_pgn() const;
 
@@ -133,6 +140,7 @@ class Move {
     // ---------- Public write method
     void setCheck(bool isCheck) { _isCheck = isCheck; }
     void setCheckmate(bool isCheckmate) { _isCheckmate = isCheckmate; }
+    void setPromotionType(PieceType pt) { _oPromotedTo = pt; }
 
     // ---------- Operators
     bool operator==(const Move &other) const;
@@ -148,7 +156,7 @@ class Move {
 
     static PieceType2IsAttackingRule _pieceType2IsAttackingRule;
     static PieceType2MoveRule _pieceType2MoveRule;
-    static Moves _moveHistory;
+    static thread_local Moves _moveHistory;
 
     Color _color;
     PieceType _pieceType;
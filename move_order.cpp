@@ -0,0 +1,200 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <iomanip>
+
+#include "move.h"
+#include "move_order.h"
+#include "piece.h"
+#include "util.h"
+
+using std::ostream;
+
+// ========================================
+// MoveOrderStats
+
+ostream &operator<<(ostream &os, const MoveOrderStats &stats) {
+    os << "cutoffs=" << stats.cutoffs << " (first move: " << std::fixed
+       << std::setprecision(1) << 100.0 * stats.firstMoveCutoffRate()
+       << "%, tt=" << stats.ttMoveCutoffs << ", killer=" << stats.killerCutoffs
+       << ", counter=" << stats.counterCutoffs << ')' << std::defaultfloat;
+    return os;
+}
+
+// ========================================
+// MoveOrderTables
+
+// ---------- Read methods
+MoveCode MoveOrderTables::counterMove(const Move &prevMove) const {
+    return _counterMoves[_colorIndex(prevMove.color())]
+                        [static_cast<int>(prevMove.pieceType())]
+                        [prevMove.to().index()];
+}
+
+bool MoveOrderTables::isKiller(Short ply, MoveCode code) const {
+    for (MoveCode killer : _killers[ply]) {
+        if (killer == code) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ---------- Write methods
+void MoveOrderTables::addKiller(Short ply, MoveCode code) {
+    std::array<MoveCode, KILLERS_PER_PLY> &killers = _killers[ply];
+    if (killers[0] == code) {
+        return;
+    }
+    for (Short slot = KILLERS_PER_PLY - 1; slot > 0; --slot) {
+        killers[slot] = killers[slot - 1];
+    }
+    killers[0] = code;
+}
+
+void MoveOrderTables::setCounterMove(const Move &prevMove, MoveCode code) {
+    _counterMoves[_colorIndex(prevMove.color())]
+                 [static_cast<int>(prevMove.pieceType())]
+                 [prevMove.to().index()] = code;
+}
+
+// Reward the quiet move that caused a cutoff; penalize quiet moves tried
+// before it. The "gravity" term keeps entries within +/-ORDER_HISTORY_MAX.
+void MoveOrderTables::updateHistory(Color c, MoveCode code, Short depth,
+                                    bool isGood)
+{
+    MoveScore bonus = std::min(depth * depth, 400);
+    if (!isGood) {
+        bonus = -bonus;
+    }
+    MoveScore &entry = _history[_colorIndex(c)][code];
+    entry += 32 * bonus - entry * std::abs(bonus) / 512;
+    entry = std::clamp(entry, -ORDER_HISTORY_MAX + 1, ORDER_HISTORY_MAX - 1);
+}
+
+void MoveOrderTables::age() {
+    for (auto &killers : _killers) {
+        killers.fill(NO_MOVE_CODE);
+    }
+    for (auto &colorHistory : _history) {
+        for (MoveScore &entry : colorHistory) {
+            entry /= 2;
+        }
+    }
+}
+
+void MoveOrderTables::clear() {
+    for (auto &killers : _killers) {
+        killers.fill(NO_MOVE_CODE);
+    }
+    for (auto &colorHistory : _history) {
+        colorHistory.fill(0);
+    }
+    for (auto &colorCounterMoves : _counterMoves) {
+        for (auto &ptCounterMoves : colorCounterMoves) {
+            ptCounterMoves.fill(NO_MOVE_CODE);
+        }
+    }
+}
+
+// ========================================
+// MovePicker
+
+// Most Valuable Victim, then Least Valuable Attacker.
+MoveScore MovePicker::mvvLva(const Move &move) {
+    MoveScore victim = 0;
+    if (move.isCapture()) {
+        PieceType victimType = move.capturedP()->pieceType();
+        victim = MoveScore(100 * Piece::pieceValue(victimType));
+    }
+    if (move.isPromotion()) {
+        victim += MoveScore(100 * Piece::pieceValue(move.promotionType()));
+    }
+    MoveScore attacker =
+        move.pieceType() == PieceType::King
+            ? 0 // A legal King capture cannot be recaptured.
+            : MoveScore(100 * Piece::pieceValue(move.pieceType()));
+    return 10 * victim - attacker / 10;
+}
+
+MovePicker::MovePicker(Moves moves, MoveCode ttCode,
+                       const MoveOrderTables &tables, Short ply,
+                       MoveCode counterCode, /* =NO_MOVE_CODE */
+                       bool isOrdered /* =true */)
+    : _moves{std::move(moves)}, _scores(_moves.size(), 0), _current{0},
+      _lastScore{0}
+{
+    if (isOrdered) {
+        for (Short k = 0; k < Short(_moves.size()); ++k) {
+            _scores[k] = _score(_moves[k], ttCode, tables, ply, counterCode);
+        }
+    }
+}
+
+const Move *MovePicker::next() {
+    Short count = _moves.size();
+    if (_current >= count) {
+        return nullptr;
+    }
+    Short best = _current;
+    for (Short k = _current + 1; k < count; ++k) {
+        if (_scores[k] > _scores[best]) {
+            best = k;
+        }
+    }
+    if (best != _current) {
+        std::swap(_moves[best], _moves[_current]);
+        std::swap(_scores[best], _scores[_current]);
+    }
+    _lastScore = _scores[_current];
+    return &_moves[_current++];
+}
+
+MoveScore MovePicker::_score(const Move &move, MoveCode ttCode,
+                             const MoveOrderTables &tables, Short ply,
+                             MoveCode counterCode) const
+{
+    MoveCode code = move.code();
+    if (code == ttCode
+        && (!move.isPromotion() || move.promotionType() == PieceType::Queen))
+    {
+        return ORDER_TT_MOVE;
+    }
+    if (move.isPromotion()) {
+        return (move.promotionType() == PieceType::Queen
+                    ? ORDER_QUEEN_PROMOTION
+                    : ORDER_UNDER_PROMOTION)
+               + mvvLva(move);
+    }
+    if (move.isCapture()) {
+        PieceType attacker = move.pieceType();
+        PieceType victim = move.capturedP()->pieceType();
+        bool isWinning = attacker == PieceType::King
+            || Piece::pieceValue(victim) >= Piece::pieceValue(attacker);
+        return (isWinning ? ORDER_WINNING_CAPTURE : ORDER_LOSING_CAPTURE)
+               + mvvLva(move);
+    }
+    for (Short slot = 0; slot < KILLERS_PER_PLY; ++slot) {
+        if (tables.killer(ply, slot) == code) {
+            return ORDER_KILLER + KILLERS_PER_PLY - slot;
+        }
+    }
+    if (code == counterCode) {
+        return ORDER_COUNTER_MOVE;
+    }
+    return tables.history(move.color(), code);
+}
@@ -0,0 +1,143 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <array>
+#include <iostream>
+#include <vector>
+
+#include "geometry.h"
+#include "move.h"
+#include "piece.h"
+#include "util.h"
+
+constexpr Short MAX_PLY = 64;          // Deepest ply tracked by search tables
+constexpr Short KILLERS_PER_PLY = 2;
+constexpr MoveCode NO_MOVE_CODE = -1;
+
+using MoveScore = int;
+
+// Score bands used to order moves. Within a band, moves are ordered by the
+// band-specific key (MVV-LVA for captures, history for quiet moves).
+constexpr MoveScore ORDER_TT_MOVE = 10'000'000;
+constexpr MoveScore ORDER_QUEEN_PROMOTION = 9'000'000;
+constexpr MoveScore ORDER_WINNING_CAPTURE = 8'000'000;
+constexpr MoveScore ORDER_KILLER = 7'000'000;
+constexpr MoveScore ORDER_COUNTER_MOVE = 6'900'000;
+constexpr MoveScore ORDER_HISTORY_MAX = 1'000'000; // Quiet moves: +/- this
+constexpr MoveScore ORDER_LOSING_CAPTURE = -8'000'000;
+constexpr MoveScore ORDER_UNDER_PROMOTION = -9'000'000;
+
+// ========================================
+// MoveOrderStats
+
+// Counters that quantify how well moves are ordered: with perfect ordering,
+// every beta cutoff is produced by the first move searched.
+struct MoveOrderStats {
+    long long cutoffs = 0;          // Beta cutoffs
+    long long firstMoveCutoffs = 0; // ... produced by the first move tried
+    long long ttMoveCutoffs = 0;    // ... produced by the TT move
+    long long killerCutoffs = 0;    // ... produced by a killer move
+    long long counterCutoffs = 0;   // ... produced by a countermove
+
+    double firstMoveCutoffRate() const {
+        return cutoffs == 0 ? 0.0 : double(firstMoveCutoffs) / cutoffs;
+    }
+    void clear() { *this = MoveOrderStats{}; }
+};
+
+std::ostream &operator<<(std::ostream &os, const MoveOrderStats &stats);
+
+// ========================================
+// MoveOrderTables
+
+// Search-wide memory of which quiet moves caused cutoffs:
+//   * Killers:      Per ply, the last quiet moves that caused a beta cutoff.
+//   * History:      Butterfly table ([color][from][to]) of cutoff credit.
+//   * Countermoves: The quiet move that refuted a given previous move,
+//                   indexed by the previous move's [color][piece type][to].
+class MoveOrderTables {
+  public:
+    MoveOrderTables() { clear(); }
+
+    // ---------- Read methods
+    MoveCode counterMove(const Move &prevMove) const;
+    MoveScore history(Color c, MoveCode code) const {
+        return _history[_colorIndex(c)][code];
+    }
+    bool isKiller(Short ply, MoveCode code) const;
+    MoveCode killer(Short ply, Short slot) const { return _killers[ply][slot]; }
+
+    // ---------- Write methods
+    void addKiller(Short ply, MoveCode code);
+    void setCounterMove(const Move &prevMove, MoveCode code);
+    void updateHistory(Color c, MoveCode code, Short depth, bool isGood);
+
+    void age();   // Between searches: Decay history; keep counters
+    void clear(); // Between games: Forget everything
+
+  private:
+    static Short _colorIndex(Color c) { return c == Color::White ? 1 : 0; }
+
+    std::array<std::array<MoveCode, KILLERS_PER_PLY>, MAX_PLY> _killers;
+    std::array<std::array<MoveScore, BOARD_SPACES * BOARD_SPACES>,
+               COLORS_COUNT> _history;
+    std::array<std::array<std::array<MoveCode, BOARD_SPACES>,
+                          PIECE_TYPES_COUNT>, COLORS_COUNT> _counterMoves;
+};
+
+// ========================================
+// MovePicker
+
+// Scores a node's moves once, then hands them out lazily in score order
+// (one selection-sort step per call), so that after a cutoff the remaining
+// moves are never sorted. Order: TT move, Queen promotions, winning or equal
+// captures (MVV-LVA), killers, countermove, quiet moves by history, losing
+// captures, underpromotions.
+class MovePicker {
+  public:
+    static MoveScore mvvLva(const Move &move);
+
+    // With isOrdered=false, moves are returned in generation order.
+    MovePicker(Moves moves, MoveCode ttCode, const MoveOrderTables &tables,
+               Short ply, MoveCode counterCode = NO_MOVE_CODE,
+               bool isOrdered = true);
+
+    // Returns nullptr when all moves have been picked.
+    const Move *next();
+
+    // Band of the most recently picked move, for cutoff statistics.
+    bool lastWasTtMove() const { return _lastScore >= ORDER_TT_MOVE; }
+    bool lastWasKiller() const {
+        return _lastScore >= ORDER_KILLER
+            && _lastScore < ORDER_WINNING_CAPTURE;
+    }
+    bool lastWasCounterMove() const {
+        return _lastScore >= ORDER_COUNTER_MOVE && _lastScore < ORDER_KILLER;
+    }
+    Short pickedCount() const { return _current; }
+
+  private:
+    MoveScore _score(const Move &move, MoveCode ttCode,
+                     const MoveOrderTables &tables, Short ply,
+                     MoveCode counterCode) const;
+
+    Moves _moves;
+    std::vector<MoveScore> _scores;
+    Short _current;
+    MoveScore _lastScore;
+};
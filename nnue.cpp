@@ -0,0 +1,455 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NNUE_X86
+#endif
+
+#include "nnue.h"
+#include "position.h"
+
+using std::string;
+
+namespace {
+
+constexpr char NNUE_MAGIC[4] = {'N', 'N', 'U', 'E'};
+constexpr std::uint32_t NNUE_VERSION = 1;
+
+// ========================================
+// Kernels
+//
+// Accumulator rows have NNUE_L1 int16 values; hidden-layer rows have
+// 2 * NNUE_L1 int8 weights. Each instruction set has its own kernels,
+// compiled with a target attribute and chosen at run time, so one binary
+// runs on any x86-64 CPU.
+
+struct NnueKernels {
+    void (*add)(std::int16_t *acc, const std::int16_t *col);
+    void (*sub)(std::int16_t *acc, const std::int16_t *col);
+    // acc += add - sub
+    void (*addSub)(std::int16_t *acc, const std::int16_t *add,
+                   const std::int16_t *sub);
+    // out = clamp(acc, 0, 127)
+    void (*clippedRelu)(const std::int16_t *acc, std::uint8_t *out);
+    std::int32_t (*dot)(const std::uint8_t *in, const std::int8_t *weights);
+};
+
+// ---------- Scalar
+
+void addScalar(std::int16_t *acc, const std::int16_t *col) {
+    for (int i = 0; i < NNUE_L1; ++i) {
+        acc[i] += col[i];
+    }
+}
+
+void subScalar(std::int16_t *acc, const std::int16_t *col) {
+    for (int i = 0; i < NNUE_L1; ++i) {
+        acc[i] -= col[i];
+    }
+}
+
+void addSubScalar(std::int16_t *acc, const std::int16_t *add,
+                  const std::int16_t *sub)
+{
+    for (int i = 0; i < NNUE_L1; ++i) {
+        acc[i] += add[i] - sub[i];
+    }
+}
+
+void clippedReluScalar(const std::int16_t *acc, std::uint8_t *out) {
+    for (int i = 0; i < NNUE_L1; ++i) {
+        out[i] = std::clamp<int>(acc[i], 0, NNUE_ACTIVATION_MAX);
+    }
+}
+
+std::int32_t dotScalar(const std::uint8_t *in, const std::int8_t *weights) {
+    std::int32_t sum = 0;
+    for (int i = 0; i < 2 * NNUE_L1; ++i) {
+        sum += in[i] * weights[i];
+    }
+    return sum;
+}
+
+constexpr NnueKernels SCALAR_KERNELS{addScalar, subScalar, addSubScalar,
+                                     clippedReluScalar, dotScalar};
+
+#ifdef NNUE_X86
+
+// ---------- SSE4.1
+
+__attribute__((target("sse4.1")))
+void addSse41(std::int16_t *acc, const std::int16_t *col) {
+    for (int i = 0; i < NNUE_L1; i += 8) {
+        __m128i *a = reinterpret_cast<__m128i *>(acc + i);
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(col + i));
+        _mm_storeu_si128(a, _mm_add_epi16(_mm_loadu_si128(a), c));
+    }
+}
+
+__attribute__((target("sse4.1")))
+void subSse41(std::int16_t *acc, const std::int16_t *col) {
+    for (int i = 0; i < NNUE_L1; i += 8) {
+        __m128i *a = reinterpret_cast<__m128i *>(acc + i);
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(col + i));
+        _mm_storeu_si128(a, _mm_sub_epi16(_mm_loadu_si128(a), c));
+    }
+}
+
+__attribute__((target("sse4.1")))
+void addSubSse41(std::int16_t *acc, const std::int16_t *add,
+                 const std::int16_t *sub)
+{
+    for (int i = 0; i < NNUE_L1; i += 8) {
+        __m128i *a = reinterpret_cast<__m128i *>(acc + i);
+        __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(add + i));
+        __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sub + i));
+        _mm_storeu_si128(a, _mm_add_epi16(_mm_loadu_si128(a),
+                                          _mm_sub_epi16(p, m)));
+    }
+}
+
+__attribute__((target("sse4.1")))
+void clippedReluSse41(const std::int16_t *acc, std::uint8_t *out) {
+    const __m128i zero = _mm_setzero_si128();
+    for (int i = 0; i < NNUE_L1; i += 16) {
+        const __m128i *a = reinterpret_cast<const __m128i *>(acc + i);
+        // Saturate to int8, then drop the negative values.
+        __m128i packed =
+            _mm_packs_epi16(_mm_loadu_si128(a), _mm_loadu_si128(a + 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),
+                         _mm_max_epi8(packed, zero));
+    }
+}
+
+__attribute__((target("sse4.1")))
+std::int32_t dotSse41(const std::uint8_t *in, const std::int8_t *weights) {
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i sum = _mm_setzero_si128();
+    for (int i = 0; i < 2 * NNUE_L1; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        __m128i w =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(weights + i));
+        // u8 x i8 pairs summed to int16 (at most 2 * 127 * 128: No
+        // saturation), then pairs of those to int32.
+        __m128i products = _mm_madd_epi16(_mm_maddubs_epi16(x, w), ones);
+        sum = _mm_add_epi32(sum, products);
+    }
+    sum = _mm_hadd_epi32(sum, sum);
+    sum = _mm_hadd_epi32(sum, sum);
+    return _mm_cvtsi128_si32(sum);
+}
+
+constexpr NnueKernels SSE41_KERNELS{addSse41, subSse41, addSubSse41,
+                                    clippedReluSse41, dotSse41};
+
+// ---------- AVX2
+
+__attribute__((target("avx2")))
+void addAvx2(std::int16_t *acc, const std::int16_t *col) {
+    for (int i = 0; i < NNUE_L1; i += 16) {
+        __m256i *a = reinterpret_cast<__m256i *>(acc + i);
+        __m256i c =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(col + i));
+        _mm256_storeu_si256(a, _mm256_add_epi16(_mm256_loadu_si256(a), c));
+    }
+}
+
+__attribute__((target("avx2")))
+void subAvx2(std::int16_t *acc, const std::int16_t *col) {
+    for (int i = 0; i < NNUE_L1; i += 16) {
+        __m256i *a = reinterpret_cast<__m256i *>(acc + i);
+        __m256i c =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(col + i));
+        _mm256_storeu_si256(a, _mm256_sub_epi16(_mm256_loadu_si256(a), c));
+    }
+}
+
+__attribute__((target("avx2")))
+void addSubAvx2(std::int16_t *acc, const std::int16_t *add,
+                const std::int16_t *sub)
+{
+    for (int i = 0; i < NNUE_L1; i += 16) {
+        __m256i *a = reinterpret_cast<__m256i *>(acc + i);
+        __m256i p =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(add + i));
+        __m256i m =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(sub + i));
+        _mm256_storeu_si256(a, _mm256_add_epi16(_mm256_loadu_si256(a),
+                                                _mm256_sub_epi16(p, m)));
+    }
+}
+
+__attribute__((target("avx2")))
+void clippedReluAvx2(const std::int16_t *acc, std::uint8_t *out) {
+    const __m256i zero = _mm256_setzero_si256();
+    for (int i = 0; i < NNUE_L1; i += 32) {
+        const __m256i *a = reinterpret_cast<const __m256i *>(acc + i);
+        __m256i packed = _mm256_packs_epi16(_mm256_loadu_si256(a),
+                                            _mm256_loadu_si256(a + 1));
+        // packs works within 128-bit lanes: Restore the element order.
+        packed = _mm256_permute4x64_epi64(_mm256_max_epi8(packed, zero),
+                                          0b11011000);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), packed);
+    }
+}
+
+__attribute__((target("avx2")))
+std::int32_t dotAvx2(const std::uint8_t *in, const std::int8_t *weights) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i sum = _mm256_setzero_si256();
+    for (int i = 0; i < 2 * NNUE_L1; i += 32) {
+        __m256i x =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+        __m256i w =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(weights + i));
+        __m256i products =
+            _mm256_madd_epi16(_mm256_maddubs_epi16(x, w), ones);
+        sum = _mm256_add_epi32(sum, products);
+    }
+    __m128i sum128 = _mm_add_epi32(_mm256_castsi256_si128(sum),
+                                   _mm256_extracti128_si256(sum, 1));
+    sum128 = _mm_hadd_epi32(sum128, sum128);
+    sum128 = _mm_hadd_epi32(sum128, sum128);
+    return _mm_cvtsi128_si32(sum128);
+}
+
+constexpr NnueKernels AVX2_KERNELS{addAvx2, subAvx2, addSubAvx2,
+                                   clippedReluAvx2, dotAvx2};
+
+#endif // NNUE_X86
+
+// ---------- Dispatch
+
+bool isSupported(NnueSimd simd) {
+#ifdef NNUE_X86
+    switch (simd) {
+    case NnueSimd::Avx2:  return __builtin_cpu_supports("avx2");
+    case NnueSimd::Sse41: return __builtin_cpu_supports("sse4.1");
+    default:              return true;
+    }
+#else
+    return simd == NnueSimd::Scalar;
+#endif
+}
+
+const NnueKernels &kernelsFor(NnueSimd simd) {
+#ifdef NNUE_X86
+    if (simd == NnueSimd::Avx2) {
+        return AVX2_KERNELS;
+    }
+    if (simd == NnueSimd::Sse41) {
+        return SSE41_KERNELS;
+    }
+#endif
+    return SCALAR_KERNELS;
+}
+
+NnueSimd bestSimd() {
+    for (NnueSimd simd : {NnueSimd::Avx2, NnueSimd::Sse41}) {
+        if (isSupported(simd)) {
+            return simd;
+        }
+    }
+    return NnueSimd::Scalar;
+}
+
+NnueSimd currentSimd = bestSimd();
+const NnueKernels *kernelsP = &kernelsFor(currentSimd);
+
+// ---------- File I/O helpers
+
+template <typename T>
+bool readArray(std::istream &is, std::vector<T> &values) {
+    is.read(reinterpret_cast<char *>(values.data()),
+            values.size() * sizeof(T));
+    return bool(is);
+}
+
+template <typename T>
+void writeArray(std::ostream &os, const std::vector<T> &values) {
+    os.write(reinterpret_cast<const char *>(values.data()),
+             values.size() * sizeof(T));
+}
+
+} // namespace
+
+std::string to_string(NnueSimd simd) {
+    switch (simd) {
+    case NnueSimd::Avx2:  return "avx2";
+    case NnueSimd::Sse41: return "sse4.1";
+    default:              return "scalar";
+    }
+}
+
+// ========================================
+// Features
+
+int nnueFeatures(const Position &pos, Color perspective, int *features) {
+    Square kingSq = pos.kingSquare(perspective);
+    int count = 0;
+    for (Color c : {Color::Black, Color::White}) {
+        for (PieceType pt : {PieceType::Queen, PieceType::Rook,
+                             PieceType::Bishop, PieceType::Knight,
+                             PieceType::Pawn}) {
+            for (Bitboard bb = pos.pieces(c, pt); bb;) {
+                features[count++] =
+                    nnueFeature(perspective, kingSq, c, pt, popLsb(bb));
+            }
+        }
+    }
+    return count;
+}
+
+// ========================================
+// NnueWeights
+
+NnueWeights::NnueWeights()
+    : inputBiases(NNUE_L1), inputWeights(std::size_t(NNUE_INPUTS) * NNUE_L1),
+      hiddenBiases(NNUE_L2), hiddenWeights(NNUE_L2 * 2 * NNUE_L1),
+      outputBias{0}, outputWeights(NNUE_L2)
+{}
+
+// ========================================
+// Nnue
+
+// ---------- Initialization of static data
+std::unique_ptr<Nnue> Nnue::_activeP{};
+unsigned Nnue::_generation = 0;
+
+// ---------- Static methods
+
+// File format: "NNUE", then uint32 version, inputs, L1 and L2 sizes, then
+// the arrays of NnueWeights in declaration order, little-endian.
+bool Nnue::load(const string &path) {
+    std::ifstream is{path, std::ios::binary};
+    if (!is) {
+        return false;
+    }
+    char magic[4];
+    std::uint32_t header[4];
+    is.read(magic, sizeof magic);
+    is.read(reinterpret_cast<char *>(header), sizeof header);
+    if (!is || std::memcmp(magic, NNUE_MAGIC, sizeof magic) != 0
+        || header[0] != NNUE_VERSION || header[1] != NNUE_INPUTS
+        || header[2] != NNUE_L1 || header[3] != NNUE_L2)
+    {
+        return false; // Not a network file, or another architecture
+    }
+    NnueWeights w;
+    bool isOk = readArray(is, w.inputBiases) && readArray(is, w.inputWeights)
+             && readArray(is, w.hiddenBiases) && readArray(is, w.hiddenWeights);
+    is.read(reinterpret_cast<char *>(&w.outputBias), sizeof w.outputBias);
+    isOk = isOk && is && readArray(is, w.outputWeights);
+    if (!isOk) {
+        return false; // Truncated
+    }
+    setActive(std::make_unique<Nnue>(std::move(w)));
+    return true;
+}
+
+// Boards notice the change by its generation, and refresh their
+// accumulators.
+void Nnue::setActive(std::unique_ptr<Nnue> nnueP) {
+    _activeP = std::move(nnueP);
+    ++_generation;
+}
+
+NnueSimd Nnue::simd() { return currentSimd; }
+
+bool Nnue::setSimd(NnueSimd simd) {
+    if (!isSupported(simd)) {
+        return false;
+    }
+    currentSimd = simd;
+    kernelsP = &kernelsFor(simd);
+    return true;
+}
+
+// ---------- Constructor
+Nnue::Nnue(NnueWeights weights) : _weights{std::move(weights)} {}
+
+// ---------- Read methods
+bool Nnue::save(const string &path) const {
+    std::ofstream os{path, std::ios::binary};
+    std::uint32_t header[4] = {NNUE_VERSION, NNUE_INPUTS, NNUE_L1, NNUE_L2};
+    os.write(NNUE_MAGIC, sizeof NNUE_MAGIC);
+    os.write(reinterpret_cast<const char *>(header), sizeof header);
+    writeArray(os, _weights.inputBiases);
+    writeArray(os, _weights.inputWeights);
+    writeArray(os, _weights.hiddenBiases);
+    writeArray(os, _weights.hiddenWeights);
+    os.write(reinterpret_cast<const char *>(&_weights.outputBias),
+             sizeof _weights.outputBias);
+    writeArray(os, _weights.outputWeights);
+    return bool(os);
+}
+
+int Nnue::evaluate(const NnueAccumulator &acc, Color sideToMove) const {
+    alignas(32) std::uint8_t input[2 * NNUE_L1];
+    kernelsP->clippedRelu(acc.values[colorIndex(sideToMove)].data(), input);
+    kernelsP->clippedRelu(acc.values[colorIndex(opponent(sideToMove))].data(),
+                          input + NNUE_L1);
+    long long output = _weights.outputBias;
+    for (int j = 0; j < NNUE_L2; ++j) {
+        const std::int8_t *row = &_weights.hiddenWeights[j * 2 * NNUE_L1];
+        std::int32_t sum = _weights.hiddenBiases[j] + kernelsP->dot(input, row);
+        int hidden =
+            std::clamp(sum / NNUE_WEIGHT_SCALE, 0, NNUE_ACTIVATION_MAX);
+        output += hidden * _weights.outputWeights[j];
+    }
+    return int(output * NNUE_EVAL_SCALE
+               / (NNUE_ACTIVATION_MAX * NNUE_WEIGHT_SCALE));
+}
+
+// ---------- Accumulator updates
+void Nnue::refresh(NnueAccumulator &acc, Color perspective,
+                   const int *features, int count) const
+{
+    std::int16_t *values = acc.values[colorIndex(perspective)].data();
+    std::copy(_weights.inputBiases.begin(), _weights.inputBiases.end(),
+              values);
+    for (int k = 0; k < count; ++k) {
+        kernelsP->add(values, _column(features[k]));
+    }
+    acc.isValid[colorIndex(perspective)] = true;
+}
+
+void Nnue::addFeature(NnueAccumulator &acc, Color perspective,
+                      int feature) const
+{
+    kernelsP->add(acc.values[colorIndex(perspective)].data(),
+                  _column(feature));
+}
+
+void Nnue::removeFeature(NnueAccumulator &acc, Color perspective,
+                         int feature) const
+{
+    kernelsP->sub(acc.values[colorIndex(perspective)].data(),
+                  _column(feature));
+}
+
+void Nnue::moveFeature(NnueAccumulator &acc, Color perspective, int from,
+                       int to) const
+{
+    kernelsP->addSub(acc.values[colorIndex(perspective)].data(), _column(to),
+                     _column(from));
+}
@@ -0,0 +1,144 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bitboard.h"
+#include "piece.h"
+#include "util.h"
+
+// ========================================
+// NNUE: Efficiently updatable neural network evaluation
+//
+// Input layer (HalfKP): For each perspective (Color), one binary feature per
+// (own King square, non-King Piece type and Color, Piece square), with
+// squares seen from that side (rows flipped for Black). A position has at
+// most 30 active features per perspective, and a move changes only a few,
+// so the first layer's output (the accumulator) is updated incrementally as
+// Pieces are added, removed and moved (see Board), unless a King moves.
+//
+// Layers, with quantized weights:
+//   2 x NNUE_L1   int16 accumulators (side to move first), clipped to 0..127
+//   NNUE_L2       int8 weights, int32 biases, clipped to 0..127
+//   1             int8 weights, int32 bias: The evaluation
+// An activation of 127 stands for 1.0, and an int8 weight of
+// NNUE_WEIGHT_SCALE for 1.0. The output 1.0 is NNUE_EVAL_SCALE centipawns.
+
+constexpr int NNUE_PIECE_KINDS = 10; // Queen..Pawn, own then opponent's
+constexpr int NNUE_INPUTS = BOARD_SPACES * NNUE_PIECE_KINDS * BOARD_SPACES;
+constexpr int NNUE_L1 = 128;
+constexpr int NNUE_L2 = 32;
+constexpr int NNUE_ACTIVATION_MAX = 127;
+constexpr int NNUE_WEIGHT_SCALE = 64;
+constexpr int NNUE_EVAL_SCALE = 400;
+constexpr int NNUE_MAX_FEATURES = 32; // Per perspective
+
+// The input feature for a non-King Piece, from the point of view of
+// perspective, whose King is on kingSq.
+inline int nnueFeature(Color perspective, Square kingSq, Color c,
+                       PieceType pt, Square sq)
+{
+    Square flip = perspective == Color::White ? 0 : 56;
+    int kind = static_cast<int>(pt) - 1 + (c == perspective ? 0 : 5);
+    return ((kingSq ^ flip) * NNUE_PIECE_KINDS + kind) * BOARD_SPACES
+         + (sq ^ flip);
+}
+
+class Position;
+
+// The active input features of a Position, for one perspective (see
+// nnueFeature). Returns their count.
+int nnueFeatures(const Position &pos, Color perspective, int *features);
+
+// ---------- NnueAccumulator
+// First-layer outputs, per perspective. Owned by a Board.
+
+struct NnueAccumulator {
+    std::array<std::array<std::int16_t, NNUE_L1>, COLORS_COUNT> values{};
+    std::array<bool, COLORS_COUNT> isValid{}; // Else refresh before use
+    unsigned generation = 0; // Of the network the values were computed by
+};
+
+// ---------- NnueWeights
+// Quantized parameters, as stored in a network file.
+
+struct NnueWeights {
+    std::vector<std::int16_t> inputBiases;  // NNUE_L1
+    std::vector<std::int16_t> inputWeights; // NNUE_INPUTS x NNUE_L1
+    std::vector<std::int32_t> hiddenBiases; // NNUE_L2
+    std::vector<std::int8_t> hiddenWeights; // NNUE_L2 x 2*NNUE_L1
+    std::int32_t outputBias = 0;
+    std::vector<std::int8_t> outputWeights; // NNUE_L2
+
+    NnueWeights(); // All zero
+};
+
+// ---------- Nnue
+
+enum class NnueSimd { Scalar, Sse41, Avx2 };
+
+std::string to_string(NnueSimd simd);
+
+class Nnue {
+  public:
+    // ---------- Static methods
+    // The network used by Boards, or nullptr if none has been loaded.
+    static const Nnue *active() { return _activeP.get(); }
+    static unsigned generation() { return _generation; }
+    // Load a network file, and make it active. Returns false if the file
+    // cannot be read or has the wrong format.
+    static bool load(const std::string &path);
+    static void setActive(std::unique_ptr<Nnue> nnueP);
+    // Kernels: The best one supported by the CPU, unless set otherwise.
+    static NnueSimd simd();
+    static bool setSimd(NnueSimd simd); // false: Not supported by the CPU
+
+    // ---------- Constructor
+    Nnue(NnueWeights weights);
+
+    // ---------- Read methods
+    const NnueWeights &weights() const { return _weights; }
+    bool save(const std::string &path) const;
+    // Evaluation in centipawns, from the point of view of sideToMove.
+    int evaluate(const NnueAccumulator &acc, Color sideToMove) const;
+
+    // ---------- Accumulator updates
+    void refresh(NnueAccumulator &acc, Color perspective,
+                 const int *features, int count) const;
+    void addFeature(NnueAccumulator &acc, Color perspective,
+                    int feature) const;
+    void removeFeature(NnueAccumulator &acc, Color perspective,
+                       int feature) const;
+    void moveFeature(NnueAccumulator &acc, Color perspective, int from,
+                     int to) const;
+
+  private:
+    static std::unique_ptr<Nnue> _activeP;
+    static unsigned _generation;
+
+    const std::int16_t *_column(int feature) const {
+        return &_weights.inputWeights[std::size_t(feature) * NNUE_L1];
+    }
+
+    NnueWeights _weights;
+};
@@ -0,0 +1,373 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+#include "nnue_trainer.h"
+
+using std::vector;
+
+namespace {
+
+// ---------- Dense parameter layout
+constexpr std::size_t B1 = 0;
+constexpr std::size_t W2 = B1 + NNUE_L1;
+constexpr std::size_t B2 = W2 + NNUE_L2 * 2 * NNUE_L1;
+constexpr std::size_t W3 = B2 + NNUE_L2;
+constexpr std::size_t B3 = W3 + NNUE_L2;
+constexpr std::size_t DENSE_SIZE = B3 + 1;
+
+// ---------- Adam
+constexpr float BETA1 = 0.9f;
+constexpr float BETA2 = 0.999f;
+constexpr float EPSILON = 1e-8f;
+
+// int8 weights must stay within what they can represent.
+constexpr float INT8_WEIGHT_MAX = 127.0f / NNUE_WEIGHT_SCALE;
+
+// ---------- Vector kernels
+// GCC vector extension: 8 floats, i.e., one AVX register, or two SSE ones.
+// These helpers are internal and inlined, so their (AVX) calling convention
+// does not matter.
+#pragma GCC diagnostic ignored "-Wpsabi"
+using FloatVec = float __attribute__((vector_size(32)));
+constexpr int LANES = 8;
+static_assert(NNUE_L1 % LANES == 0 && NNUE_L2 % LANES == 0);
+
+inline FloatVec loadVec(const float *p) {
+    FloatVec v;
+    std::memcpy(&v, p, sizeof v);
+    return v;
+}
+
+inline void storeVec(float *p, FloatVec v) { std::memcpy(p, &v, sizeof v); }
+
+float dot(const float *a, const float *b, int n) {
+    FloatVec sum{};
+    for (int k = 0; k < n; k += LANES) {
+        sum += loadVec(a + k) * loadVec(b + k);
+    }
+    float result = 0.0f;
+    for (int l = 0; l < LANES; ++l) {
+        result += sum[l];
+    }
+    return result;
+}
+
+// y += a * x
+void axpy(float *y, float a, const float *x, int n) {
+    FloatVec av = a - FloatVec{}; // Broadcast
+    for (int k = 0; k < n; k += LANES) {
+        storeVec(y + k, loadVec(y + k) + av * loadVec(x + k));
+    }
+}
+
+// One Adam step for n parameters, with gradients scaled by gradScale.
+void adam(float *w, float *m, float *v, const float *g, int n,
+          float gradScale, float stepSize)
+{
+    FloatVec scale = gradScale - FloatVec{};
+    FloatVec step = stepSize - FloatVec{};
+    for (int k = 0; k + LANES <= n; k += LANES) {
+        FloatVec gk = loadVec(g + k) * scale;
+        FloatVec mk = BETA1 * loadVec(m + k) + (1 - BETA1) * gk;
+        FloatVec vk = BETA2 * loadVec(v + k) + (1 - BETA2) * gk * gk;
+        storeVec(m + k, mk);
+        storeVec(v + k, vk);
+        FloatVec denom;
+        for (int l = 0; l < LANES; ++l) {
+            denom[l] = std::sqrt(vk[l]) + EPSILON;
+        }
+        storeVec(w + k, loadVec(w + k) - step * mk / denom);
+    }
+    for (int k = n - n % LANES; k < n; ++k) {
+        float gk = g[k] * gradScale;
+        m[k] = BETA1 * m[k] + (1 - BETA1) * gk;
+        v[k] = BETA2 * v[k] + (1 - BETA2) * gk * gk;
+        w[k] -= stepSize * m[k] / (std::sqrt(v[k]) + EPSILON);
+    }
+}
+
+inline float clip01(float x) { return std::clamp(x, 0.0f, 1.0f); }
+
+std::int16_t toInt16(float x, float scale) {
+    return std::int16_t(std::clamp(std::lround(x * scale), -32767L, 32767L));
+}
+
+std::int8_t toInt8(float x, float scale) {
+    return std::int8_t(std::clamp(std::lround(x * scale), -127L, 127L));
+}
+
+} // namespace
+
+// ========================================
+// NnueTrainer
+
+// ---------- Constructor
+NnueTrainer::NnueTrainer(ThreadPool &pool,
+                         const NnueTrainerConfig &config /* ={} */)
+    : _poolP{&pool}, _config{config}, _step{0},
+      _w1(std::size_t(NNUE_INPUTS) * NNUE_L1),
+      _w1M(_w1.size()), _w1V(_w1.size()), _w1Grad(_w1.size()),
+      _isRowTouched(NNUE_INPUTS), _dense(DENSE_SIZE), _denseM(DENSE_SIZE),
+      _denseV(DENSE_SIZE), _workerGrads(pool.size(), vector<float>(DENSE_SIZE)),
+      _batchFeatures{}, _batchInputGrads{}
+{
+    // About 30 active inputs and 256 hidden inputs: Start in the middle of
+    // the clipped range, where gradients flow.
+    std::mt19937 gen{config.seed};
+    auto uniform = [&gen](float limit) {
+        return std::uniform_real_distribution<float>{-limit, limit}(gen);
+    };
+    for (float &w : _w1) {
+        w = uniform(0.15f);
+    }
+    std::fill(&_dense[B1], &_dense[W2], 0.5f);
+    for (std::size_t k = W2; k < B2; ++k) {
+        _dense[k] = uniform(1.0f / 16);
+    }
+    for (std::size_t k = W3; k < B3; ++k) {
+        _dense[k] = uniform(1.0f / 4);
+    }
+}
+
+// ---------- Read methods
+float NnueTrainer::evaluate(const Position &pos) const {
+    Activations act;
+    _forward(pos, act);
+    return act.out * NNUE_EVAL_SCALE;
+}
+
+double NnueTrainer::loss(const vector<LabeledPosition> &batch) const {
+    vector<double> workerLoss(_poolP->size());
+    _poolP->parallelFor(batch.size(), [&](std::size_t s, Short worker) {
+        Activations act;
+        _forward(batch[s].pos, act);
+        bool isWhite = batch[s].pos.sideToMove() == Color::White;
+        float target = isWhite ? batch[s].result : 1 - batch[s].result;
+        float error = expectedResult(act.out, 1.0f) - target;
+        workerLoss[worker] += error * error;
+    }, 64);
+    double sum = 0.0;
+    for (double l : workerLoss) {
+        sum += l;
+    }
+    return batch.empty() ? 0.0 : sum / batch.size();
+}
+
+std::unique_ptr<Nnue> NnueTrainer::quantize() const {
+    constexpr float ACT = NNUE_ACTIVATION_MAX;
+    constexpr float WEIGHT = NNUE_WEIGHT_SCALE;
+    NnueWeights w;
+    for (int i = 0; i < NNUE_L1; ++i) {
+        w.inputBiases[i] = toInt16(_dense[B1 + i], ACT);
+    }
+    for (std::size_t k = 0; k < _w1.size(); ++k) {
+        w.inputWeights[k] = toInt16(_w1[k], ACT);
+    }
+    for (int j = 0; j < NNUE_L2; ++j) {
+        w.hiddenBiases[j] = std::lround(_dense[B2 + j] * ACT * WEIGHT);
+        w.outputWeights[j] = toInt8(_dense[W3 + j], WEIGHT);
+    }
+    for (std::size_t k = 0; k < w.hiddenWeights.size(); ++k) {
+        w.hiddenWeights[k] = toInt8(_dense[W2 + k], WEIGHT);
+    }
+    w.outputBias = std::lround(_dense[B3] * ACT * WEIGHT);
+    return std::make_unique<Nnue>(std::move(w));
+}
+
+// ---------- Write methods
+void NnueTrainer::load(const Nnue &nnue) {
+    constexpr float ACT = NNUE_ACTIVATION_MAX;
+    constexpr float WEIGHT = NNUE_WEIGHT_SCALE;
+    const NnueWeights &w = nnue.weights();
+    for (int i = 0; i < NNUE_L1; ++i) {
+        _dense[B1 + i] = w.inputBiases[i] / ACT;
+    }
+    for (std::size_t k = 0; k < _w1.size(); ++k) {
+        _w1[k] = w.inputWeights[k] / ACT;
+    }
+    for (int j = 0; j < NNUE_L2; ++j) {
+        _dense[B2 + j] = w.hiddenBiases[j] / (ACT * WEIGHT);
+        _dense[W3 + j] = w.outputWeights[j] / WEIGHT;
+    }
+    for (std::size_t k = 0; k < w.hiddenWeights.size(); ++k) {
+        _dense[W2 + k] = w.hiddenWeights[k] / WEIGHT;
+    }
+    _dense[B3] = w.outputBias / (ACT * WEIGHT);
+}
+
+// Forward and backward passes in parallel, then the updates: Dense layers
+// from the summed worker gradients, and the input rows seen in the batch.
+double NnueTrainer::trainBatch(const vector<LabeledPosition> &batch) {
+    std::size_t n = batch.size();
+    if (n == 0) {
+        return 0.0;
+    }
+    _batchFeatures.resize(n);
+    _batchInputGrads.resize(n * 2 * NNUE_L1);
+    vector<double> workerLoss(_poolP->size());
+    _poolP->run([&](Short worker) {
+        std::fill(_workerGrads[worker].begin(), _workerGrads[worker].end(),
+                  0.0f);
+    });
+    _poolP->parallelFor(n, [&](std::size_t s, Short worker) {
+        Activations act;
+        _forward(batch[s].pos, act);
+        bool isWhite = batch[s].pos.sideToMove() == Color::White;
+        float target = isWhite ? batch[s].result : 1 - batch[s].result;
+        workerLoss[worker] +=
+            _backward(act, target, _workerGrads[worker].data(),
+                      &_batchInputGrads[s * 2 * NNUE_L1]);
+        _batchFeatures[s] = act.features;
+    }, 64);
+
+    ++_step;
+    _updateDense();
+    _poolP->run([&](Short worker) { _updateInputRows(n, worker); });
+
+    double sum = 0.0;
+    for (double l : workerLoss) {
+        sum += l;
+    }
+    return sum / n;
+}
+
+// ---------- Private read methods
+void NnueTrainer::_forward(const Position &pos, Activations &act) const {
+    Color perspectives[COLORS_COUNT] = {pos.sideToMove(),
+                                        opponent(pos.sideToMove())};
+    for (int p = 0; p < COLORS_COUNT; ++p) {
+        float *acc = act.acc + p * NNUE_L1;
+        std::copy(&_dense[B1], &_dense[B1] + NNUE_L1, acc);
+        int count = nnueFeatures(pos, perspectives[p],
+                                 act.features.indexes[p]);
+        act.features.counts[p] = count;
+        for (int k = 0; k < count; ++k) {
+            const float *row =
+                &_w1[std::size_t(act.features.indexes[p][k]) * NNUE_L1];
+            axpy(acc, 1.0f, row, NNUE_L1);
+        }
+    }
+    for (int i = 0; i < 2 * NNUE_L1; ++i) {
+        act.a1[i] = clip01(act.acc[i]);
+    }
+    for (int j = 0; j < NNUE_L2; ++j) {
+        act.z2[j] = _dense[B2 + j]
+                  + dot(&_dense[W2 + j * 2 * NNUE_L1], act.a1, 2 * NNUE_L1);
+        act.h[j] = clip01(act.z2[j]);
+    }
+    act.out = _dense[B3] + dot(&_dense[W3], act.h, NNUE_L2);
+}
+
+float NnueTrainer::_backward(const Activations &act, float target,
+                             float *grads, float *inputGrads) const
+{
+    // d(loss)/d(out), through the logistic curve
+    float predicted = expectedResult(act.out, 1.0f);
+    float error = predicted - target;
+    float gOut = 2 * error * predicted * (1 - predicted);
+
+    grads[B3] += gOut;
+    axpy(&grads[W3], gOut, act.h, NNUE_L2);
+    std::fill(inputGrads, inputGrads + 2 * NNUE_L1, 0.0f);
+    for (int j = 0; j < NNUE_L2; ++j) {
+        if (act.z2[j] <= 0.0f || act.z2[j] >= 1.0f) {
+            continue; // Clipped: No gradient
+        }
+        float gZ2 = gOut * _dense[W3 + j];
+        grads[B2 + j] += gZ2;
+        axpy(&grads[W2 + j * 2 * NNUE_L1], gZ2, act.a1, 2 * NNUE_L1);
+        axpy(inputGrads, gZ2, &_dense[W2 + j * 2 * NNUE_L1], 2 * NNUE_L1);
+    }
+    for (int i = 0; i < 2 * NNUE_L1; ++i) {
+        if (act.acc[i] <= 0.0f || act.acc[i] >= 1.0f) {
+            inputGrads[i] = 0.0f;
+        }
+    }
+    // Both perspectives share the input biases.
+    axpy(&grads[B1], 1.0f, inputGrads, NNUE_L1);
+    axpy(&grads[B1], 1.0f, inputGrads + NNUE_L1, NNUE_L1);
+    return error * error;
+}
+
+// Adam's step size, with the bias corrections of its moments.
+float NnueTrainer::_adamStepSize() const {
+    return _config.learningRate * std::sqrt(1 - std::pow(BETA2, _step))
+         / (1 - std::pow(BETA1, _step));
+}
+
+// ---------- Private write methods
+void NnueTrainer::_updateDense() {
+    vector<float> &grads = _workerGrads[0];
+    for (Short worker = 1; worker < _poolP->size(); ++worker) {
+        axpy(grads.data(), 1.0f, _workerGrads[worker].data(),
+             DENSE_SIZE - DENSE_SIZE % LANES);
+        for (std::size_t k = DENSE_SIZE - DENSE_SIZE % LANES; k < DENSE_SIZE;
+             ++k) {
+            grads[k] += _workerGrads[worker][k];
+        }
+    }
+    std::size_t batchSize = _batchFeatures.size();
+    float stepSize = _adamStepSize();
+    adam(_dense.data(), _denseM.data(), _denseV.data(), grads.data(),
+         DENSE_SIZE, 1.0f / batchSize, stepSize);
+    for (std::size_t k = W2; k < B2; ++k) {
+        _dense[k] = std::clamp(_dense[k], -INT8_WEIGHT_MAX, INT8_WEIGHT_MAX);
+    }
+    for (std::size_t k = W3; k < B3; ++k) {
+        _dense[k] = std::clamp(_dense[k], -INT8_WEIGHT_MAX, INT8_WEIGHT_MAX);
+    }
+}
+
+// Each worker owns a range of input rows: It sums the gradients of the
+// batch positions for its rows, then updates the rows it saw (lazy Adam:
+// The moments of other rows stay as they are).
+void NnueTrainer::_updateInputRows(std::size_t batchSize, Short worker) {
+    int rowBegin = int(long(NNUE_INPUTS) * worker / _poolP->size());
+    int rowEnd = int(long(NNUE_INPUTS) * (worker + 1) / _poolP->size());
+    vector<int> touched{};
+    for (std::size_t s = 0; s < batchSize; ++s) {
+        const Features &features = _batchFeatures[s];
+        for (int p = 0; p < COLORS_COUNT; ++p) {
+            const float *grad = &_batchInputGrads[(2 * s + p) * NNUE_L1];
+            for (int k = 0; k < features.counts[p]; ++k) {
+                int row = features.indexes[p][k];
+                if (row < rowBegin || row >= rowEnd) {
+                    continue;
+                }
+                if (!_isRowTouched[row]) {
+                    _isRowTouched[row] = 1;
+                    touched.push_back(row);
+                }
+                axpy(&_w1Grad[std::size_t(row) * NNUE_L1], 1.0f, grad,
+                     NNUE_L1);
+            }
+        }
+    }
+    float stepSize = _adamStepSize();
+    for (int row : touched) {
+        std::size_t offset = std::size_t(row) * NNUE_L1;
+        adam(&_w1[offset], &_w1M[offset], &_w1V[offset], &_w1Grad[offset],
+             NNUE_L1, 1.0f / batchSize, stepSize);
+        std::fill(&_w1Grad[offset], &_w1Grad[offset] + NNUE_L1, 0.0f);
+        _isRowTouched[row] = 0;
+    }
+}
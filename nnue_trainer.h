@@ -0,0 +1,117 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "nnue.h"
+#include "position.h"
+#include "thread_pool.h"
+#include "training_data.h"
+#include "util.h"
+
+struct NnueTrainerConfig {
+    float learningRate = 1e-3f; // Adam step size
+    unsigned seed = 1;          // For the initial weights
+};
+
+// ========================================
+// NnueTrainer
+//
+// Trains the network of nnue.h in floating point, on the CPU: Mini-batch
+// gradient descent with Adam. The loss is the squared difference between a
+// label and the expected result predicted by the network (a logistic curve
+// of its evaluation, see expectedResult).
+//
+// Each batch is split across the workers of a ThreadPool, which sum the
+// gradients of the dense layers in their own buffers. The input layer is
+// sparse: A position activates about 30 of its rows, so only the rows seen
+// in a batch get gradients and (lazy) Adam updates, by row range per worker.
+// The inner loops use 8-lane vector types, which the compiler maps to the
+// widest instructions allowed by the build flags.
+class NnueTrainer {
+  public:
+    // ---------- Constructor
+    NnueTrainer(ThreadPool &pool,
+                const NnueTrainerConfig &config = NnueTrainerConfig{});
+
+    // ---------- Read methods
+    float evaluate(const Position &pos) const; // Centipawns, side to move
+    double loss(const std::vector<LabeledPosition> &batch) const; // Mean
+    // Round the weights to the integer scales of nnue.h.
+    std::unique_ptr<Nnue> quantize() const;
+    long long steps() const { return _step; }
+
+    // ---------- Write methods
+    void load(const Nnue &nnue); // Continue from a quantized network
+    // One Adam step over the batch. Returns the mean loss before the step.
+    double trainBatch(const std::vector<LabeledPosition> &batch);
+
+  private:
+    struct Features {
+        int indexes[COLORS_COUNT][NNUE_MAX_FEATURES]; // Side to move first
+        int counts[COLORS_COUNT];
+    };
+    // Per position: The inputs and outputs of each layer.
+    struct Activations {
+        Features features;
+        float acc[2 * NNUE_L1]; // Input layer, before clipping
+        float a1[2 * NNUE_L1];
+        float z2[NNUE_L2]; // Hidden layer, before clipping
+        float h[NNUE_L2];
+        float out; // Evaluation, in units of NNUE_EVAL_SCALE centipawns
+    };
+
+    // ---------- Private read methods
+    void _forward(const Position &pos, Activations &act) const;
+    // Loss of one position, and its gradients: Dense ones added to grads,
+    // and the input layer's (2 * NNUE_L1) stored in inputGrads.
+    float _backward(const Activations &act, float target, float *grads,
+                    float *inputGrads) const;
+    float _adamStepSize() const;
+
+    // ---------- Private write methods
+    void _updateDense();
+    void _updateInputRows(std::size_t batchSize, Short worker);
+
+    ThreadPool *_poolP;
+    NnueTrainerConfig _config;
+    long long _step;
+
+    // Input weights: NNUE_INPUTS rows of NNUE_L1, with Adam moments, and
+    // gradients for the rows touched by the current batch.
+    std::vector<float> _w1;
+    std::vector<float> _w1M;
+    std::vector<float> _w1V;
+    std::vector<float> _w1Grad;
+    std::vector<std::uint8_t> _isRowTouched;
+
+    // Dense parameters, in one array (see the offsets in nnue_trainer.cpp),
+    // with Adam moments, and gradients per worker.
+    std::vector<float> _dense;
+    std::vector<float> _denseM;
+    std::vector<float> _denseV;
+    std::vector<std::vector<float>> _workerGrads;
+
+    // Per position of the current batch
+    std::vector<Features> _batchFeatures;
+    std::vector<float> _batchInputGrads;
+};
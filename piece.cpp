@@ -69,17 +69,14 @@ Piece::Piece(Color color, PieceType pt, Short index,
     : _color{color}, _pieceType{pt}, _pos{index}, _moveIndexHistory{}
 {
     _moveIndexHistory.reserve(lastMoveIndex + VECTOR_CAPACITY_INCR);
-    assert(_moveIndexHistory.capacity() - 1 >= (unsigned long)lastMoveIndex);
-    if (lastMoveIndex == 0) {
-        _moveIndexHistory.push_back(true);
-    } else {
-        _moveIndexHistory[lastMoveIndex] = true;
-    }
+    _moveIndexHistory.resize(lastMoveIndex + 1, false);
+    _moveIndexHistory[0] = true; // Reverse sentinel
+    _moveIndexHistory[lastMoveIndex] = true;
 }
 
 // ---------- Public read methods
 MoveIndex Piece::lastMoveIndex() const {
-    for (int k = _moveIndexHistory.size(); k >= 0; --k) {
+    for (int k = _moveIndexHistory.size() - 1; k >= 0; --k) {
         if (_moveIndexHistory[k]) {
             return k;
         }
@@ -88,17 +85,20 @@ MoveIndex Piece::lastMoveIndex() const {
 }
 
 // ---------- Public write methods
+// Forget moves made at MoveIndex mi or later.
 void Piece::rollBackLastMoveIndex(MoveIndex mi) {
-    const MoveIndexHistory::iterator &beg = _moveIndexHistory.begin() + mi;
-    const MoveIndexHistory::iterator &end = _moveIndexHistory.end();
-    _moveIndexHistory.erase(beg, end);
+    if (_moveIndexHistory.size() > (unsigned long)mi) {
+        _moveIndexHistory.resize(mi);
+    }
 }
 
 void Piece::updateMoveIndexHistory(MoveIndex mi) {
     if ((_moveIndexHistory.capacity()) <= (unsigned long)mi + 1) {
         _moveIndexHistory.reserve(mi + VECTOR_CAPACITY_INCR);
     }
-    assert(_moveIndexHistory.capacity() - 1 >= (unsigned long)mi);
+    if (_moveIndexHistory.size() <= (unsigned long)mi) {
+        _moveIndexHistory.resize(mi + 1, false);
+    }
     _moveIndexHistory[mi] = true;
 }
 
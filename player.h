@@ -25,7 +25,13 @@
 using Color2Dir = std::map<Color, Dir>;
 using Color2Name = std::map<Color, std::string>;
 
-enum class PlayerType { Human, Computer_Random, Computer_RandomCapture };
+enum class PlayerType {
+    Human,
+    Computer_Random,
+    Computer_RandomCapture,
+    Computer_AlphaBeta,
+    Computer_MCTS
+};
 
 using Color2PlayerType = std::map<Color, PlayerType>;
 
@@ -0,0 +1,109 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <chrono>
+
+#include "board.h"
+#include "move.h"
+#include "ponder.h"
+#include "search.h"
+#include "util.h"
+
+// ========================================
+// Ponderer
+
+// ---------- Constructor / Destructor
+Ponderer::Ponderer()
+    : _searchP{nullptr}, _board{false}, _humanColor{Color::White},
+      _predictedMove{std::nullopt}, _moveHistory{},
+      _result{std::nullopt, 0, 0, Moves{}}, _thread{}, _isDone{true},
+      _hits{0}, _misses{0}
+{}
+
+Ponderer::~Ponderer() {
+    stop(std::nullopt);
+}
+
+// ---------- Public write methods
+void Ponderer::start(Search &search, const Board &b, Color humanColor) {
+    stop(std::nullopt);
+    _searchP = &search;
+    _board = b.clone();
+    _humanColor = humanColor;
+    _moveHistory = Move::getMoveHistory();
+    _predictedMove = search.predictedReply();
+    _result = SearchResult{std::nullopt, 0, 0, Moves{}};
+    _searchP->timeManager().startUnlimited();
+    _isDone.store(false);
+    _thread = std::thread{&Ponderer::_run, this};
+}
+
+void Ponderer::stop(const OptMove &humanMove) {
+    if (!_thread.joinable()) {
+        return;
+    }
+    // The search resets its stop flag when it starts, so keep asking.
+    while (!_isDone.load()) {
+        _searchP->stop();
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+    _thread.join();
+    if (!humanMove) {
+        return;
+    }
+    bool isHit = _predictedMove && _predictedMove->code() == humanMove->code()
+        && _predictedMove->isPromotion() == humanMove->isPromotion()
+        && (!humanMove->isPromotion()
+            || _predictedMove->promotionType() == humanMove->promotionType());
+    if (isHit && _result.bestMove) {
+        ++_hits;
+        _searchP->setPonderResult(_board.hash(), _result);
+    } else {
+        ++_misses;
+    }
+}
+
+// ---------- Private write methods
+void Ponderer::_run() {
+    Move::setMoveHistory(_moveHistory);
+    Color botColor = opponent(_humanColor);
+    if (_predictedMove) {
+        // Play the predicted reply on the clone, where its Pieces live.
+        OptMove reply = std::nullopt;
+        for (const Move &move : concatMap(
+                 Move::getValidPlayerMoves(_board, _humanColor)))
+        {
+            if (move.code() == _predictedMove->code()) {
+                reply = move;
+                if (_predictedMove->isPromotion()) {
+                    reply->setPromotionType(_predictedMove->promotionType());
+                }
+                break;
+            }
+        }
+        if (reply) {
+            reply->apply(_board);
+            _result = _searchP->search(_board, botColor);
+            // Including the last iteration, if it was interrupted.
+            _result.elapsed = _searchP->timeManager().elapsed();
+        } else {
+            _predictedMove = std::nullopt;
+        }
+    } else {
+        _searchP->search(_board, _humanColor); // Warm tables for all replies
+    }
+    _isDone.store(true);
+}
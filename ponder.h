@@ -0,0 +1,74 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+#include "board.h"
+#include "move.h"
+#include "search.h"
+#include "util.h"
+
+// ========================================
+// Ponderer
+
+// Searches on the opponent's time. While a human enters a move, the bot's
+// Search keeps working in a background thread, on a private clone of the
+// Board (and a private copy of the move history):
+//   * If the bot's last PV predicts the human's reply, the position after
+//     that reply is searched, as the bot would search it on its turn.
+//   * Otherwise, the human's position is searched, which warms the
+//     transposition table for all replies.
+// On a hit, the result is handed to the bot's Search, which plays it at
+// once if it is as deep as the bot would search now, or (under a clock) if
+// pondering took the bot's time budget for the move. On a miss, only the
+// warmed tables remain.
+class Ponderer {
+  public:
+    Ponderer();
+    ~Ponderer(); // Stops any search in progress
+    Ponderer(const Ponderer &) = delete;
+    Ponderer &operator=(const Ponderer &) = delete;
+
+    // ---------- Public read methods
+    bool isPondering() const { return _thread.joinable(); }
+    // The search finished on its own, e.g., at SearchConfig::maxDepth.
+    bool isDone() const { return _isDone.load(); }
+    long long hits() const { return _hits; }
+    long long misses() const { return _misses; }
+
+    // ---------- Public write methods
+    void start(Search &search, const Board &b, Color humanColor);
+    // Stop pondering. The human's move, if any, decides between hit and miss.
+    void stop(const OptMove &humanMove);
+
+  private:
+    void _run(); // Body of the background thread
+
+    Search *_searchP;
+    Board _board;
+    Color _humanColor;
+    OptMove _predictedMove;
+    Moves _moveHistory;
+    SearchResult _result;
+    std::thread _thread;
+    std::atomic<bool> _isDone;
+
+    long long _hits;
+    long long _misses;
+};
@@ -0,0 +1,751 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cctype>
+#include <cstdlib>
+#include <sstream>
+#include <vector>
+
+#include "position.h"
+
+using std::string;
+
+// ========================================
+// Zobrist keys (built at compile time)
+
+struct PositionZobrist {
+    std::array<std::array<Hash, BOARD_SPACES>,
+               COLORS_COUNT * PIECE_TYPES_COUNT> pieces{};
+    std::array<Hash, 16> castlingRights{};
+    std::array<Hash, BOARD_COLS> enPassantCol{};
+    Hash blackToMove = 0;
+};
+
+constexpr Hash splitMix64(std::uint64_t &state) {
+    std::uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+constexpr PositionZobrist makePositionZobrist() {
+    PositionZobrist zobrist{};
+    std::uint64_t state = 0x5eed;
+    for (auto &squareKeys : zobrist.pieces) {
+        for (Hash &key : squareKeys) {
+            key = splitMix64(state);
+        }
+    }
+    for (Short rights = 1; rights < 16; ++rights) {
+        zobrist.castlingRights[rights] = splitMix64(state);
+    }
+    for (Hash &key : zobrist.enPassantCol) {
+        key = splitMix64(state);
+    }
+    zobrist.blackToMove = splitMix64(state);
+    return zobrist;
+}
+
+constexpr PositionZobrist POSITION_ZOBRIST = makePositionZobrist();
+
+// Castling rights kept when a piece moves from or to a square.
+constexpr Short castlingMask(Square sq) {
+    switch (sq) {
+    case 0:  return ~CASTLE_WHITE_Q;                  // a1
+    case 4:  return ~(CASTLE_WHITE_K | CASTLE_WHITE_Q); // e1
+    case 7:  return ~CASTLE_WHITE_K;                  // h1
+    case 56: return ~CASTLE_BLACK_Q;                  // a8
+    case 60: return ~(CASTLE_BLACK_K | CASTLE_BLACK_Q); // e8
+    case 63: return ~CASTLE_BLACK_K;                  // h8
+    default: return ~0;
+    }
+}
+
+const string PIECE_LETTERS = "kqrbnp"; // In PieceType order
+
+// ========================================
+// FastMove
+
+FastMove::FastMove(Square from, Square to,
+                   OptPieceType promotedType /* =std::nullopt */)
+    : _data{static_cast<std::uint16_t>(
+          from | (to << 6)
+          | (promotedType ? (static_cast<Short>(*promotedType) + 1) << 12 : 0))}
+{}
+
+FastMove FastMove::fromMove(const Move &move) {
+    OptPieceType promotedType = move.isPromotion()
+        ? OptPieceType{move.promotionType()} : std::nullopt;
+    return FastMove{move.from().index(), move.to().index(), promotedType};
+}
+
+const string FastMove::algNotation() const {
+    string result = Pos(from()).algNotation() + ' ' + Pos(to()).algNotation();
+    if (isPromotion()) {
+        result += '=';
+        result += char(std::toupper(
+            PIECE_LETTERS[static_cast<Short>(promotionType())]));
+    }
+    return result;
+}
+
+std::ostream &operator<<(std::ostream &os, const FastMove &move) {
+    os << move.algNotation();
+    return os;
+}
+
+// ========================================
+// Position
+
+// ---------- Static methods
+Position Position::fromBoard(const Board &b, Color sideToMove) {
+    Position result{};
+    for (Color c : allColors) {
+        for (const PieceP &pieceP : b.piecesWithColor(c)) {
+            result.addPiece(c, pieceP->pieceType(), pieceP->pos().index());
+        }
+    }
+
+    Short rights = 0;
+    for (Color c : allColors) {
+        const Piece &king = b.king(c);
+        if (king.hasMoved() || !(king.pos() == Board::kInitPos(c))) {
+            continue;
+        }
+        auto isUnmovedRook = [&](const Pos &pos) {
+            PieceP pieceP = b.pieceAt(pos);
+            return pieceP && pieceP->color() == c
+                && pieceP->pieceType() == PieceType::Rook
+                && !pieceP->hasMoved();
+        };
+        bool isWhite = c == Color::White;
+        if (isUnmovedRook(Board::kRookInitPos(c))) {
+            rights |= isWhite ? CASTLE_WHITE_K : CASTLE_BLACK_K;
+        }
+        if (isUnmovedRook(Board::qRookInitPos(c))) {
+            rights |= isWhite ? CASTLE_WHITE_Q : CASTLE_BLACK_Q;
+        }
+    }
+    result._setCastlingRights(rights);
+
+    if (!Move::getMoveHistory().empty()) {
+        const Move &prevMove = Move::prevMove();
+        if (prevMove.pieceType() == PieceType::Pawn
+            && prevMove.color() != sideToMove
+            && std::abs(prevMove.to().ydiff(prevMove.from())) == 2)
+        {
+            result._setEnPassantSquare(
+                (prevMove.from().index() + prevMove.to().index()) / 2);
+        }
+    }
+
+    if (sideToMove == Color::Black) {
+        result._sideToMove = Color::Black;
+        result._key ^= POSITION_ZOBRIST.blackToMove;
+    }
+    result._halfmoveClock = b.movesSinceLastPmoc();
+    result._fullmoveNumber = b.currentMoveIndex() / 2 + 1;
+    return result;
+}
+
+std::optional<Position> Position::fromFen(const string &fen) {
+    std::istringstream iss{fen};
+    std::vector<string> fields{};
+    for (string field; iss >> field;) {
+        fields.push_back(field);
+    }
+    if (fields.size() < 2 || fields.size() > 6) {
+        return std::nullopt;
+    }
+
+    Position result{};
+    Row y = BOARD_ROWS - 1;
+    Col x = 0;
+    for (char ch : fields[0]) {
+        if (ch == '/') {
+            if (x != BOARD_COLS || --y < 0) {
+                return std::nullopt;
+            }
+            x = 0;
+        } else if (ch >= '1' && ch <= '8') {
+            x += ch - '0';
+        } else {
+            string::size_type ptIndex =
+                PIECE_LETTERS.find(char(std::tolower(ch)));
+            if (ptIndex == string::npos || x >= BOARD_COLS) {
+                return std::nullopt;
+            }
+            Color c = std::isupper(ch) ? Color::White : Color::Black;
+            result.addPiece(c, PieceType(ptIndex), toSquare(x++, y));
+        }
+        if (x > BOARD_COLS) {
+            return std::nullopt;
+        }
+    }
+    if (y != 0 || x != BOARD_COLS
+        || popCount(result.pieces(Color::White, PieceType::King)) != 1
+        || popCount(result.pieces(Color::Black, PieceType::King)) != 1)
+    {
+        return std::nullopt;
+    }
+
+    if (fields[1] == "b") {
+        result._sideToMove = Color::Black;
+        result._key ^= POSITION_ZOBRIST.blackToMove;
+    } else if (fields[1] != "w") {
+        return std::nullopt;
+    }
+
+    Short rights = 0;
+    if (fields.size() > 2 && fields[2] != "-") {
+        for (char ch : fields[2]) {
+            string::size_type index = string{"KQkq"}.find(ch);
+            if (index == string::npos) {
+                return std::nullopt;
+            }
+            rights |= 1 << index;
+        }
+    }
+    result._setCastlingRights(rights);
+
+    if (fields.size() > 3 && fields[3] != "-") {
+        const string &ep = fields[3];
+        if (ep.size() != 2 || ep[0] < 'a' || ep[0] > 'h'
+            || (ep[1] != '3' && ep[1] != '6'))
+        {
+            return std::nullopt;
+        }
+        result._setEnPassantSquare(toSquare(ep[0] - 'a', ep[1] - '1'));
+    }
+
+    try {
+        if (fields.size() > 4) {
+            result._halfmoveClock = std::stoi(fields[4]);
+        }
+        if (fields.size() > 5) {
+            result._fullmoveNumber = std::stoi(fields[5]);
+        }
+    } catch (const std::exception &) {
+        return std::nullopt;
+    }
+    return result;
+}
+
+// ---------- Constructor
+Position::Position()
+    : _colorBBs{}, _typeBBs{}, _squares{},
+      _sideToMove{Color::White}, _castlingRights{0},
+      _enPassantSquare{NO_SQUARE}, _halfmoveClock{0}, _fullmoveNumber{1},
+      _key{0}
+{
+    _squares.fill(-1);
+}
+
+// ---------- Public read methods (state)
+const string Position::fen() const {
+    std::ostringstream oss;
+    for (Row y = BOARD_ROWS - 1; y >= 0; --y) {
+        Short emptyCount = 0;
+        for (Col x = 0; x < BOARD_COLS; ++x) {
+            Square sq = toSquare(x, y);
+            if (isEmpty(sq)) {
+                ++emptyCount;
+                continue;
+            }
+            if (emptyCount > 0) {
+                oss << emptyCount;
+                emptyCount = 0;
+            }
+            char letter = PIECE_LETTERS[static_cast<Short>(pieceTypeAt(sq))];
+            oss << (colorAt(sq) == Color::White ? char(std::toupper(letter))
+                                                : letter);
+        }
+        if (emptyCount > 0) {
+            oss << emptyCount;
+        }
+        if (y > 0) {
+            oss << '/';
+        }
+    }
+    oss << (_sideToMove == Color::White ? " w " : " b ");
+    if (_castlingRights == 0) {
+        oss << '-';
+    }
+    for (Short index = 0; index < 4; ++index) {
+        if (_castlingRights & (1 << index)) {
+            oss << "KQkq"[index];
+        }
+    }
+    oss << ' '
+        << (_enPassantSquare == NO_SQUARE ? string{"-"}
+                                          : Pos(_enPassantSquare).algNotation())
+        << ' ' << _halfmoveClock << ' ' << _fullmoveNumber;
+    return oss.str();
+}
+
+// A King or Rook without castling rights is marked as moved.
+Board Position::toBoard() const {
+    Board result{false};
+    for (Square sq = 0; sq < BOARD_SPACES; ++sq) {
+        if (isEmpty(sq)) {
+            continue;
+        }
+        Color c = colorAt(sq);
+        PieceType pt = pieceTypeAt(sq);
+        bool isWhite = c == Color::White;
+        Short kRight = isWhite ? CASTLE_WHITE_K : CASTLE_BLACK_K;
+        Short qRight = isWhite ? CASTLE_WHITE_Q : CASTLE_BLACK_Q;
+        Short rights = 0;
+        if (pt == PieceType::King && sq == Board::kInitPos(c).index()) {
+            rights = kRight | qRight;
+        } else if (pt == PieceType::Rook) {
+            rights = sq == Board::kRookInitPos(c).index()   ? kRight
+                     : sq == Board::qRookInitPos(c).index() ? qRight
+                                                            : 0;
+        }
+        bool hasMoved = (pt == PieceType::King || pt == PieceType::Rook)
+            && !(_castlingRights & rights);
+        result.addPieceTo(c, pt, sq, hasMoved ? 1 : 0);
+    }
+    return result;
+}
+
+// ---------- Public read methods (rules)
+Bitboard Position::attackersTo(Square sq, Bitboard occupied) const {
+    Bitboard queens = pieces(PieceType::Queen);
+    return (pawnAttacks(Color::Black, sq)
+            & pieces(Color::White, PieceType::Pawn))
+        | (pawnAttacks(Color::White, sq)
+           & pieces(Color::Black, PieceType::Pawn))
+        | (knightAttacks(sq) & pieces(PieceType::Knight))
+        | (kingAttacks(sq) & pieces(PieceType::King))
+        | (bishopAttacks(sq, occupied) & (pieces(PieceType::Bishop) | queens))
+        | (rookAttacks(sq, occupied) & (pieces(PieceType::Rook) | queens));
+}
+
+bool Position::isAttacked(Square sq, Color byColor) const {
+    return attackersTo(sq, occupied()) & pieces(byColor);
+}
+
+bool Position::isCapture(const FastMove &move) const {
+    return !isEmpty(move.to())
+        || (move.to() == _enPassantSquare
+            && pieceTypeAt(move.from()) == PieceType::Pawn);
+}
+
+bool Position::hasInsufficientMaterial() const {
+    Bitboard majorsPawns = pieces(PieceType::Queen) | pieces(PieceType::Rook)
+        | pieces(PieceType::Pawn);
+    Bitboard minors = pieces(PieceType::Bishop) | pieces(PieceType::Knight);
+    return !majorsPawns && popCount(minors) <= 1;
+}
+
+void Position::legalMoves(FastMoves &moves) const {
+    _generateMoves(moves, ~Bitboard{0});
+}
+
+// Only King moves, captures of the checking piece, and interpositions can
+// answer a single check; only King moves can answer a double check.
+void Position::checkEvasions(FastMoves &moves) const {
+    Color us = _sideToMove;
+    Square king = kingSquare(us);
+    Bitboard checkers = attackersTo(king, occupied()) & pieces(opponent(us));
+    Bitboard targets = 0;
+    if (popCount(checkers) == 1) {
+        Square checker = lsbSquare(checkers);
+        targets = checkers | betweenBB(king, checker);
+        // A Pawn that just moved two squares can be captured en passant.
+        if (_enPassantSquare != NO_SQUARE
+            && checker == _enPassantSquare + (us == Color::White
+                                                  ? -BOARD_COLS
+                                                  : BOARD_COLS))
+        {
+            targets |= squareBB(_enPassantSquare);
+        }
+    }
+    _generateMoves(moves, targets);
+}
+
+void Position::checkingMoves(FastMoves &moves) const {
+    FastMoves legal{};
+    _generateMoves(legal, ~Bitboard{0});
+    moves.clear();
+    for (const FastMove &move : legal) {
+        if (givesCheck(move)) {
+            moves.push_back(move);
+        }
+    }
+}
+
+// Direct checks are found from the attacks of the moved (or promoted) piece
+// on its new square, and discovered checks from the sliders behind it.
+// Castling and en passant, which move two pieces, are made on a copy.
+bool Position::givesCheck(const FastMove &move) const {
+    Square from = move.from();
+    Square to = move.to();
+    PieceType pt = pieceTypeAt(from);
+    bool isCastling = pt == PieceType::King
+        && std::abs(squareCol(to) - squareCol(from)) == 2;
+    bool isEnPassant = pt == PieceType::Pawn && to == _enPassantSquare;
+    if (isCastling || isEnPassant) {
+        Position next{*this};
+        PositionUndo undo;
+        next.makeMove(move, undo);
+        return next.isInCheck();
+    }
+    Color us = _sideToMove;
+    Bitboard king = pieces(opponent(us), PieceType::King);
+    Square kingSq = lsbSquare(king);
+    Bitboard occ = (occupied() ^ squareBB(from)) | squareBB(to);
+    if (move.isPromotion()) {
+        pt = move.promotionType();
+    }
+    if (pieceAttacks(pt, us, to, occ) & king) {
+        return true;
+    }
+    Bitboard others = pieces(us) ^ squareBB(from);
+    Bitboard queens = pieces(PieceType::Queen);
+    return (bishopAttacks(kingSq, occ) & (pieces(PieceType::Bishop) | queens)
+            & others)
+        || (rookAttacks(kingSq, occ) & (pieces(PieceType::Rook) | queens)
+            & others);
+}
+
+// ---------- Public write methods
+void Position::addPiece(Color c, PieceType pt, Square sq) {
+    Short ptIndex = static_cast<Short>(pt);
+    Short code = colorIndex(c) * PIECE_TYPES_COUNT + ptIndex;
+    _colorBBs[colorIndex(c)] |= squareBB(sq);
+    _typeBBs[ptIndex] |= squareBB(sq);
+    _squares[sq] = code;
+    _key ^= POSITION_ZOBRIST.pieces[code][sq];
+}
+
+void Position::setSideToMove(Color c) {
+    if (c != _sideToMove) {
+        _sideToMove = c;
+        _key ^= POSITION_ZOBRIST.blackToMove;
+    }
+}
+
+void Position::makeMove(const FastMove &move, PositionUndo &undo) {
+    undo = PositionUndo{_key, -1, static_cast<std::int8_t>(_castlingRights),
+                        static_cast<std::int8_t>(_enPassantSquare),
+                        _halfmoveClock};
+    Color us = _sideToMove;
+    Square from = move.from();
+    Square to = move.to();
+    PieceType pt = pieceTypeAt(from);
+
+    Square capturedSq = to;
+    if (pt == PieceType::Pawn && to == _enPassantSquare) {
+        capturedSq = to + (us == Color::White ? -BOARD_COLS : BOARD_COLS);
+    }
+    if (!isEmpty(capturedSq)) {
+        undo.capturedCode = _squares[capturedSq];
+        _removePiece(capturedSq);
+    }
+    _movePiece(from, to);
+    if (move.isPromotion()) {
+        _removePiece(to);
+        addPiece(us, move.promotionType(), to);
+    } else if (pt == PieceType::King && std::abs(to - from) == 2) {
+        bool isKingside = to > from;
+        _movePiece(isKingside ? to + 1 : to - 2, isKingside ? to - 1 : to + 1);
+    }
+
+    _setCastlingRights(_castlingRights & castlingMask(from) & castlingMask(to));
+    bool isDoublePush = pt == PieceType::Pawn
+        && std::abs(to - from) == 2 * BOARD_COLS;
+    _setEnPassantSquare(isDoublePush ? (from + to) / 2 : NO_SQUARE);
+    bool isPmoc = pt == PieceType::Pawn || undo.capturedCode >= 0;
+    _halfmoveClock = isPmoc ? 0 : _halfmoveClock + 1;
+    if (us == Color::Black) {
+        ++_fullmoveNumber;
+    }
+    _sideToMove = opponent(us);
+    _key ^= POSITION_ZOBRIST.blackToMove;
+}
+
+void Position::unmakeMove(const FastMove &move, const PositionUndo &undo) {
+    Color us = opponent(_sideToMove);
+    Square from = move.from();
+    Square to = move.to();
+    if (move.isPromotion()) {
+        _removePiece(to);
+        addPiece(us, PieceType::Pawn, to);
+    } else if (pieceTypeAt(to) == PieceType::King && std::abs(to - from) == 2) {
+        bool isKingside = to > from;
+        _movePiece(isKingside ? to - 1 : to + 1, isKingside ? to + 1 : to - 2);
+    }
+    _movePiece(to, from);
+    if (undo.capturedCode >= 0) {
+        Square capturedSq = to;
+        if (pieceTypeAt(from) == PieceType::Pawn
+            && to == undo.enPassantSquare)
+        {
+            capturedSq = to + (us == Color::White ? -BOARD_COLS : BOARD_COLS);
+        }
+        addPiece(Color(undo.capturedCode / PIECE_TYPES_COUNT),
+                 PieceType(undo.capturedCode % PIECE_TYPES_COUNT), capturedSq);
+    }
+
+    if (us == Color::Black) {
+        --_fullmoveNumber;
+    }
+    _sideToMove = us;
+    _castlingRights = undo.castlingRights;
+    _enPassantSquare = undo.enPassantSquare;
+    _halfmoveClock = undo.halfmoveClock;
+    _key = undo.key;
+}
+
+long long Position::perft(Short depth) {
+    FastMoves moves{};
+    legalMoves(moves);
+    if (depth <= 1) {
+        return depth == 1 ? moves.size() : 1;
+    }
+    long long count = 0;
+    PositionUndo undo;
+    for (const FastMove &move : moves) {
+        makeMove(move, undo);
+        count += perft(depth - 1);
+        unmakeMove(move, undo);
+    }
+    return count;
+}
+
+// ---------- Private read methods
+// Pseudo-legal moves are generated per piece, and kept if they do not leave
+// the King in check. Unless in check, only King moves, en passant, and moves
+// of pinned pieces need that test. Moves of pieces other than the King must
+// end on one of the targets (for en passant, the en passant square).
+void Position::_generateMoves(FastMoves &moves, Bitboard targets) const {
+    moves.clear();
+    Color us = _sideToMove;
+    Bitboard own = pieces(us);
+    Bitboard occ = occupied();
+    Bitboard enemy = occ & ~own;
+    Bitboard unsafe = isInCheck() ? ~Bitboard{0}
+                                  : _pinned(us) | pieces(us, PieceType::King);
+    auto addIfLegal = [&](const FastMove &move) {
+        if (!(unsafe & squareBB(move.from())) || _isLegal(move)) {
+            moves.push_back(move);
+        }
+    };
+
+    // Pawns
+    bool isWhite = us == Color::White;
+    Short forward = isWhite ? BOARD_COLS : -BOARD_COLS;
+    Row startRow = isWhite ? 1 : BOARD_ROWS - 2;
+    Bitboard captureTargets = enemy;
+    if (_enPassantSquare != NO_SQUARE) {
+        captureTargets |= squareBB(_enPassantSquare);
+    }
+    Bitboard pawns = pieces(us, PieceType::Pawn);
+    while (pawns) {
+        Square from = popLsb(pawns);
+        Square to = from + forward;
+        bool isSafe = !(unsafe & squareBB(from));
+        if (isEmpty(to)) {
+            if (targets & squareBB(to)) {
+                _addPawnMoves(moves, from, to, isSafe);
+            }
+            if (squareRow(from) == startRow && isEmpty(to + forward)
+                && (targets & squareBB(to + forward)))
+            {
+                _addPawnMoves(moves, from, to + forward, isSafe);
+            }
+        }
+        Bitboard captures = pawnAttacks(us, from) & captureTargets & targets;
+        while (captures) {
+            Square target = popLsb(captures);
+            _addPawnMoves(moves, from, target,
+                          isSafe && target != _enPassantSquare);
+        }
+    }
+
+    // Pieces
+    for (PieceType pt : {PieceType::Knight, PieceType::Bishop, PieceType::Rook,
+                         PieceType::Queen, PieceType::King})
+    {
+        Bitboard bb = pieces(us, pt);
+        Bitboard ptTargets = pt == PieceType::King ? ~own : targets & ~own;
+        while (bb) {
+            Square from = popLsb(bb);
+            Bitboard tos = pieceAttacks(pt, us, from, occ) & ptTargets;
+            while (tos) {
+                addIfLegal(FastMove{from, popLsb(tos)});
+            }
+        }
+    }
+
+    // Castling: Not out of, through, or into check
+    Short kRight = isWhite ? CASTLE_WHITE_K : CASTLE_BLACK_K;
+    Short qRight = isWhite ? CASTLE_WHITE_Q : CASTLE_BLACK_Q;
+    if (!(_castlingRights & (kRight | qRight)) || isInCheck()) {
+        return;
+    }
+    Square king = kingSquare(us);
+    Color them = opponent(us);
+    if ((_castlingRights & kRight) && isEmpty(king + 1) && isEmpty(king + 2)
+        && !isAttacked(king + 1, them) && !isAttacked(king + 2, them))
+    {
+        moves.push_back(FastMove{king, king + 2});
+    }
+    if ((_castlingRights & qRight) && isEmpty(king - 1) && isEmpty(king - 2)
+        && isEmpty(king - 3) && !isAttacked(king - 1, them)
+        && !isAttacked(king - 2, them))
+    {
+        moves.push_back(FastMove{king, king - 2});
+    }
+}
+
+void Position::_addPawnMoves(FastMoves &moves, Square from, Square to,
+                             bool isSafe) const
+{
+    FastMove move{from, to};
+    if (!isSafe && !_isLegal(move)) {
+        return;
+    }
+    Row toRow = squareRow(to);
+    if (toRow != 0 && toRow != BOARD_ROWS - 1) {
+        moves.push_back(move);
+        return;
+    }
+    for (PieceType pt : {PieceType::Queen, PieceType::Knight, PieceType::Rook,
+                         PieceType::Bishop})
+    {
+        moves.push_back(FastMove{from, to, pt});
+    }
+}
+
+// Pieces of color c that shield their King from an enemy slider.
+Bitboard Position::_pinned(Color c) const {
+    Square king = kingSquare(c);
+    Bitboard enemy = pieces(opponent(c));
+    Bitboard queens = pieces(PieceType::Queen);
+    Bitboard rookSnipers = rookAttacks(king, enemy)
+        & (pieces(PieceType::Rook) | queens) & enemy;
+    Bitboard bishopSnipers = bishopAttacks(king, enemy)
+        & (pieces(PieceType::Bishop) | queens) & enemy;
+    Bitboard occ = occupied();
+    Bitboard result = 0;
+    while (rookSnipers) {
+        Square sniper = popLsb(rookSnipers);
+        Bitboard between = rookAttacks(king, squareBB(sniper))
+            & rookAttacks(sniper, squareBB(king)) & occ;
+        if (popCount(between) == 1) {
+            result |= between & pieces(c);
+        }
+    }
+    while (bishopSnipers) {
+        Square sniper = popLsb(bishopSnipers);
+        Bitboard between = bishopAttacks(king, squareBB(sniper))
+            & bishopAttacks(sniper, squareBB(king)) & occ;
+        if (popCount(between) == 1) {
+            result |= between & pieces(c);
+        }
+    }
+    return result;
+}
+
+// Whether the King of the side to move is safe after the move. Only the
+// occupancy changes are applied; castling is checked by legalMoves.
+bool Position::_isLegal(const FastMove &move) const {
+    Color us = _sideToMove;
+    Square from = move.from();
+    Square to = move.to();
+    Square king = kingSquare(us);
+    if (from == king) {
+        king = to;
+    }
+    Bitboard occ = (occupied() ^ squareBB(from)) | squareBB(to);
+    Bitboard enemy = pieces(opponent(us)) & ~squareBB(to);
+    if (to == _enPassantSquare && pieceTypeAt(from) == PieceType::Pawn) {
+        Square capturedSq =
+            to + (us == Color::White ? -BOARD_COLS : BOARD_COLS);
+        occ ^= squareBB(capturedSq);
+        enemy ^= squareBB(capturedSq);
+    }
+    return !(attackersTo(king, occ) & enemy);
+}
+
+// ---------- Private write methods
+void Position::_movePiece(Square from, Square to) {
+    Short code = _squares[from];
+    Bitboard fromTo = squareBB(from) | squareBB(to);
+    _colorBBs[code / PIECE_TYPES_COUNT] ^= fromTo;
+    _typeBBs[code % PIECE_TYPES_COUNT] ^= fromTo;
+    _squares[to] = code;
+    _squares[from] = -1;
+    _key ^= POSITION_ZOBRIST.pieces[code][from]
+        ^ POSITION_ZOBRIST.pieces[code][to];
+}
+
+void Position::_removePiece(Square sq) {
+    Short code = _squares[sq];
+    _colorBBs[code / PIECE_TYPES_COUNT] ^= squareBB(sq);
+    _typeBBs[code % PIECE_TYPES_COUNT] ^= squareBB(sq);
+    _squares[sq] = -1;
+    _key ^= POSITION_ZOBRIST.pieces[code][sq];
+}
+
+void Position::_setCastlingRights(Short rights) {
+    _key ^= POSITION_ZOBRIST.castlingRights[_castlingRights]
+        ^ POSITION_ZOBRIST.castlingRights[rights];
+    _castlingRights = rights;
+}
+
+void Position::_setEnPassantSquare(Square sq) {
+    if (_enPassantSquare != NO_SQUARE) {
+        _key ^= POSITION_ZOBRIST.enPassantCol[squareCol(_enPassantSquare)];
+    }
+    if (sq != NO_SQUARE) {
+        _key ^= POSITION_ZOBRIST.enPassantCol[squareCol(sq)];
+    }
+    _enPassantSquare = sq;
+}
+
+// ---------- Operators
+bool operator==(const Position &lhs, const Position &rhs) {
+    return lhs._colorBBs == rhs._colorBBs && lhs._typeBBs == rhs._typeBBs
+        && lhs._squares == rhs._squares && lhs._sideToMove == rhs._sideToMove
+        && lhs._castlingRights == rhs._castlingRights
+        && lhs._enPassantSquare == rhs._enPassantSquare
+        && lhs._halfmoveClock == rhs._halfmoveClock && lhs._key == rhs._key;
+}
+
+std::ostream &operator<<(std::ostream &os, const Position &pos) {
+    for (Row y = BOARD_ROWS - 1; y >= 0; --y) {
+        os << y + 1 << ' ';
+        for (Col x = 0; x < BOARD_COLS; ++x) {
+            Square sq = toSquare(x, y);
+            char letter = '.';
+            if (!pos.isEmpty(sq)) {
+                letter = PIECE_LETTERS[static_cast<Short>(pos.pieceTypeAt(sq))];
+                if (pos.colorAt(sq) == Color::White) {
+                    letter = char(std::toupper(letter));
+                }
+            }
+            os << ' ' << letter;
+        }
+        os << '\n';
+    }
+    os << "   a b c d e f g h\n" << pos.fen() << '\n';
+    return os;
+}
@@ -0,0 +1,205 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <string>
+
+#include "bitboard.h"
+#include "board.h"
+#include "move.h"
+#include "piece.h"
+#include "util.h"
+
+constexpr Short MAX_POSITION_MOVES = 256; // More than any position has
+
+// Castling rights, as bits
+constexpr Short CASTLE_WHITE_K = 1;
+constexpr Short CASTLE_WHITE_Q = 2;
+constexpr Short CASTLE_BLACK_K = 4;
+constexpr Short CASTLE_BLACK_Q = 8;
+
+const std::string START_FEN =
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// ========================================
+// FastMove
+
+// A move on a Position, packed into 16 bits: from (6 bits), to (6 bits) and
+// promotion type (3 bits). Castling is a King move of two columns, and en
+// passant is a Pawn capture on the Position's en passant square.
+class FastMove {
+  public:
+    FastMove() : _data{0} {} // Null move
+    FastMove(Square from, Square to, OptPieceType promotedType = std::nullopt);
+    static FastMove fromMove(const Move &move); // Same squares and promotion
+
+    Square from() const { return _data & 0x3f; }
+    Square to() const { return (_data >> 6) & 0x3f; }
+    bool isNull() const { return _data == 0; }
+    bool isPromotion() const { return (_data >> 12) != 0; }
+    PieceType promotionType() const { return PieceType((_data >> 12) - 1); }
+    MoveCode code() const { return from() * BOARD_SPACES + to(); } // As Move
+    std::uint16_t data() const { return _data; }
+    const std::string algNotation() const; // E.g., "e7 e8=Q"
+
+    bool operator==(const FastMove &other) const {
+        return _data == other._data;
+    }
+    bool operator!=(const FastMove &other) const {
+        return _data != other._data;
+    }
+
+  private:
+    std::uint16_t _data;
+};
+
+std::ostream &operator<<(std::ostream &os, const FastMove &move);
+
+// Fixed-capacity list, so that move generation does not allocate.
+class FastMoves {
+  public:
+    void push_back(const FastMove &move) { _moves[_size++] = move; }
+    void clear() { _size = 0; }
+
+    Short size() const { return _size; }
+    bool empty() const { return _size == 0; }
+    const FastMove &operator[](Short i) const { return _moves[i]; }
+    const FastMove *begin() const { return _moves.data(); }
+    const FastMove *end() const { return _moves.data() + _size; }
+
+  private:
+    std::array<FastMove, MAX_POSITION_MOVES> _moves;
+    Short _size = 0;
+};
+
+// What makeMove needs to restore in unmakeMove.
+struct PositionUndo {
+    Hash key;
+    std::int8_t capturedCode; // See Position::_squares
+    std::int8_t castlingRights;
+    std::int8_t enPassantSquare;
+    Short halfmoveClock;
+};
+
+// ========================================
+// Position
+
+// Compact bitboard representation of a chess position, for searches that
+// visit many positions per second (e.g., Monte Carlo playouts).
+// Unlike Board, a Position is a value type that is cheap to copy, and makes
+// and unmakes moves without allocating. It keeps no history, so repetitions
+// are not detected.
+class Position {
+  public:
+    // ---------- Static methods
+    // En passant rights are taken from the Move history.
+    static Position fromBoard(const Board &b, Color sideToMove);
+    static std::optional<Position> fromFen(const std::string &fen);
+
+    // ---------- Constructor
+    Position(); // Empty board, White to move
+
+    // ---------- Public read methods (pieces)
+    Bitboard pieces(Color c) const { return _colorBBs[colorIndex(c)]; }
+    Bitboard pieces(PieceType pt) const {
+        return _typeBBs[static_cast<Short>(pt)];
+    }
+    Bitboard pieces(Color c, PieceType pt) const {
+        return pieces(c) & pieces(pt);
+    }
+    Bitboard occupied() const {
+        return pieces(Color::White) | pieces(Color::Black);
+    }
+    bool isEmpty(Square sq) const { return _squares[sq] < 0; }
+    // For non-empty squares
+    Color colorAt(Square sq) const {
+        return Color(_squares[sq] / PIECE_TYPES_COUNT);
+    }
+    PieceType pieceTypeAt(Square sq) const {
+        return PieceType(_squares[sq] % PIECE_TYPES_COUNT);
+    }
+    Square kingSquare(Color c) const {
+        return lsbSquare(pieces(c, PieceType::King));
+    }
+
+    // ---------- Public read methods (state)
+    Color sideToMove() const { return _sideToMove; }
+    Short castlingRights() const { return _castlingRights; }
+    Square enPassantSquare() const { return _enPassantSquare; }
+    Short halfmoveClock() const { return _halfmoveClock; }
+    Hash key() const { return _key; } // Zobrist hash, incl. side to move
+    const std::string fen() const;
+    // A Board with the same pieces and castling rights. En passant rights
+    // are not kept, since Board takes them from the Move history.
+    Board toBoard() const;
+
+    // ---------- Public read methods (rules)
+    Bitboard attackersTo(Square sq, Bitboard occupied) const; // Both colors
+    bool isAttacked(Square sq, Color byColor) const;
+    bool isInCheck() const { // Side to move
+        return isAttacked(kingSquare(_sideToMove), opponent(_sideToMove));
+    }
+    bool isCapture(const FastMove &move) const;
+    bool hasInsufficientMaterial() const; // Neither side can mate
+    void legalMoves(FastMoves &moves) const;
+    void checkEvasions(FastMoves &moves) const; // Legal, when in check
+    void checkingMoves(FastMoves &moves) const; // Legal moves that check
+    bool givesCheck(const FastMove &move) const; // For legal moves
+
+    // ---------- Public write methods
+    void addPiece(Color c, PieceType pt, Square sq);
+    void setSideToMove(Color c); // E.g., for positions built with addPiece
+    void makeMove(const FastMove &move, PositionUndo &undo);
+    void unmakeMove(const FastMove &move, const PositionUndo &undo);
+    long long perft(Short depth); // Leaf count, for testing move generation
+
+  private:
+    // ---------- Private read methods
+    void _generateMoves(FastMoves &moves, Bitboard targets) const;
+    // isSafe: The move cannot leave the King in check.
+    void _addPawnMoves(FastMoves &moves, Square from, Square to,
+                       bool isSafe) const;
+    bool _isLegal(const FastMove &move) const;
+    Bitboard _pinned(Color c) const;
+
+    // ---------- Private write methods
+    void _movePiece(Square from, Square to);
+    void _removePiece(Square sq);
+    void _setCastlingRights(Short rights);
+    void _setEnPassantSquare(Square sq);
+
+    std::array<Bitboard, COLORS_COUNT> _colorBBs;
+    std::array<Bitboard, PIECE_TYPES_COUNT> _typeBBs;
+    // Per square: -1 if empty, else colorIndex * PIECE_TYPES_COUNT + type
+    std::array<std::int8_t, BOARD_SPACES> _squares;
+
+    Color _sideToMove;
+    Short _castlingRights;
+    Square _enPassantSquare;
+    Short _halfmoveClock; // Plies since the last Pawn move or capture
+    Short _fullmoveNumber;
+    Hash _key;
+
+    friend bool operator==(const Position &lhs, const Position &rhs);
+    friend std::ostream &operator<<(std::ostream &os, const Position &pos);
+};
+
+bool operator==(const Position &lhs, const Position &rhs);
@@ -0,0 +1,105 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <libgen.h>
+
+#include "position.h"
+#include "tablebase.h"
+#include "util.h"
+
+using std::cerr, std::cin, std::cout;
+using std::string, std::vector;
+
+namespace {
+
+// Prints the result of a position, then that of each legal move (for the
+// side playing it), best first. Returns false if a table is missing.
+bool probe(const Tablebases &tables, const string &fen) {
+    std::optional<Position> oPos = Position::fromFen(fen);
+    if (!oPos) {
+        cout << fen << ": Bad FEN\n";
+        return false;
+    }
+    Position &pos = *oPos;
+    std::optional<TbValue> oValue = tables.probe(pos);
+    if (!oValue) {
+        cout << fen << ": No table\n";
+        return false;
+    }
+    cout << fen << ": " << toTbResult(*oValue) << "\n";
+
+    FastMoves moves{};
+    pos.legalMoves(moves);
+    vector<std::pair<FastMove, TbValue>> moveValues{};
+    PositionUndo undo;
+    for (const FastMove &move : moves) {
+        pos.makeMove(move, undo);
+        std::optional<TbValue> oChild = tables.probe(pos);
+        pos.unmakeMove(move, undo);
+        if (oChild) {
+            moveValues.emplace_back(move, tbParent(*oChild));
+        }
+    }
+    std::stable_sort(moveValues.begin(), moveValues.end(),
+                     [](const auto &mv1, const auto &mv2) {
+                         return tbRank(mv1.second) > tbRank(mv2.second);
+                     });
+    for (const auto &[move, value] : moveValues) {
+        cout << "    " << move << ": " << toTbResult(value) << "\n";
+    }
+    return true;
+}
+
+} // namespace
+
+// Looks up positions in the endgame tablebases of a directory (see gen_tb).
+// The FENs are read from the command line, or else one per line from stdin.
+int main(int argc, char **argv) {
+    string progname{basename(argv[0])};
+    vector<string> args(argv + 1, argv + argc);
+    if (args.empty()) {
+        cerr << progname << ": Usage: " << progname << " <dir> [<FEN>...]\n";
+        exit(1);
+    }
+    Tablebases tables{args[0]};
+    if (tables.size() == 0) {
+        cerr << progname << ": No tablebases in: " << args[0] << "\n";
+        exit(1);
+    }
+
+    vector<string> fens(args.begin() + 1, args.end());
+    if (fens.empty()) {
+        for (string line; std::getline(cin, line);) {
+            if (!line.empty()) {
+                fens.push_back(line);
+            }
+        }
+    }
+    bool isFound = true;
+    for (const string &fen : fens) {
+        isFound = probe(tables, fen) && isFound;
+    }
+    if (!isFound) {
+        exit(2);
+    }
+}
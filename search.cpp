@@ -0,0 +1,1135 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <array>
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "board.h"
+#include "move.h"
+#include "move_order.h"
+#include "piece.h"
+#include "position.h"
+#include "search.h"
+#include "tablebase.h"
+#include "transposition.h"
+#include "util.h"
+
+#include "logger.h"
+
+using std::cout, std::ostream;
+using std::map, std::vector;
+
+// Distinguishes positions with the same Piece placement but different side
+// to move.
+constexpr Hash SIDE_TO_MOVE_KEY = 0x9E37'79B9'7F4A'7C15;
+
+// Selective search parameters
+constexpr Short NULL_MOVE_MIN_DEPTH = 3;
+constexpr Short NULL_MOVE_REDUCTION = 2; // Plus depth / 4
+constexpr Short LMR_MIN_DEPTH = 3;
+constexpr Short LMR_MIN_MOVES = 3;       // Never reduce the first few moves
+constexpr Short RFP_MAX_DEPTH = 3;
+constexpr Score RFP_MARGIN = 120;        // Per ply of remaining depth
+constexpr Short LMP_MAX_DEPTH = 3;
+constexpr Short LMP_BASE_MOVES = 3;      // Plus depth^2 quiet moves
+
+// Aspiration windows
+constexpr Short ASPIRATION_MIN_DEPTH = 3;
+constexpr Score ASPIRATION_WINDOW = 50;  // Initial half-width, in centipawns
+
+// MTD(f)
+constexpr Score MTDF_STEP_GROWTH = 4; // Per pass failing the same way
+
+// Singular extensions
+constexpr Short SINGULAR_MIN_DEPTH = 4;
+constexpr Short SINGULAR_TT_DEPTH_SLACK = 3; // TT entry may be this shallower
+constexpr Score SINGULAR_MARGIN = 25;        // Per ply of remaining depth
+
+// Lazy evaluation. Per EvalStage: How far the remaining classical stages
+// may move the score. Measured on positions from self-play: The Pawn and
+// mobility terms together exceed 300 in under 0.1% of them, and mobility
+// alone exceeds 130 in under 0.1%.
+constexpr std::array<Score, EVAL_STAGES> LAZY_MARGINS{300, 130, 0, 0};
+// Added when a network has the last word. Check with verifyLazyEval.
+constexpr Score LAZY_NNUE_MARGIN = 400;
+
+// Nodes (including quiescence nodes) between checks of the time limit
+constexpr long long STOP_POLL_NODES = 64;
+
+// ========================================
+// Extension / SearchStats / SearchResult
+
+std::string to_string(Extension ext) {
+    static const map<Extension, std::string> ext2name{
+        {Extension::Singular, "singular"},
+        {Extension::Check, "check"},
+        {Extension::Recapture, "recapture"},
+        {Extension::PawnPush, "pawnPush"}
+    };
+    return ext2name.at(ext);
+}
+
+std::string to_string(EvalStage stage) {
+    static const map<EvalStage, std::string> stage2name{
+        {EvalStage::Material, "material"},
+        {EvalStage::Pawns, "pawns"},
+        {EvalStage::Mobility, "mobility"},
+        {EvalStage::Nnue, "nnue"}
+    };
+    return stage2name.at(stage);
+}
+
+ostream &operator<<(ostream &os, const SearchStats &stats) {
+    os << "nodes=" << stats.nodes << ", qnodes=" << stats.qnodes << ", "
+       << stats.ordering << ", null=" << stats.nullMoveCutoffs << '/'
+       << stats.nullMoveTries << ", lmr=" << stats.lmrReductions << " (re="
+       << stats.lmrResearches << "), rfp=" << stats.rfpCutoffs
+       << ", lmp=" << stats.lmpPrunes << ", pvs_re=" << stats.pvsResearches
+       << ", asp_re=" << stats.aspirationResearches;
+    if (stats.mtdfPasses > 0) {
+        os << ", mtdf=" << stats.mtdfPasses;
+    }
+    if (stats.pawnProbes > 0) {
+        os << ", pawn_hash=" << 100 * stats.pawnHits / stats.pawnProbes
+           << '%';
+    }
+    if (stats.evalCacheProbes > 0) {
+        os << ", eval_cache="
+           << 100 * stats.evalCacheHits / stats.evalCacheProbes << '%';
+    }
+    if (stats.tbHits > 0) {
+        os << ", tb=" << stats.tbHits;
+    }
+    os << ", lazy=";
+    for (Short k = 0; k < EVAL_STAGES - 1; ++k) {
+        os << (k == 0 ? "" : ", ") << to_string(EvalStage(k)) << ':'
+           << stats.lazyExits[k];
+        if (stats.lazyMisses[k] > 0) {
+            os << " (miss=" << stats.lazyMisses[k] << ')';
+        }
+    }
+    os << ", ext=";
+    for (Short k = 0; k < EXTENSION_KINDS; ++k) {
+        os << (k == 0 ? "" : ", ") << to_string(Extension(k)) << ':'
+           << stats.extensions[k] << " (" << stats.extensionNodes[k]
+           << " nodes)";
+    }
+    return os;
+}
+
+ostream &operator<<(ostream &os, const SearchResult &result) {
+    os << "depth=" << result.depth << ", score=" << result.score
+       << ", time=" << result.elapsed.count() << "ms";
+    if (result.bestMove) {
+        os << ", best=" << result.bestMove->to_pgn();
+    }
+    if (!result.pv.empty()) {
+        os << ", pv=";
+        for (Short k = 0; k < Short(result.pv.size()); ++k) {
+            os << (k == 0 ? "" : " ") << result.pv[k].to_pgn();
+        }
+    }
+    return os;
+}
+
+// ========================================
+// Search
+
+// ---------- Initialization of static data
+const ChessClock *Search::_clockP = nullptr;
+
+// ---------- Static methods
+Search &Search::forColor(Color c) {
+    static map<Color, Search> c2s;
+    return c2s[c];
+}
+
+ExtMove Search::strategyAlphaBeta(
+    const Board &b, Color c,
+    [[maybe_unused]] const Pos2Moves &validPlayerMoves
+    )
+{
+    Search &search = Search::forColor(c);
+    TimeManager &timeManager = search.timeManager();
+    if (_clockP && _clockP->isEnabled()) {
+        timeManager.start(_clockP->remaining(c),
+                          _clockP->timeControl().increment);
+    } else {
+        timeManager.startUnlimited();
+    }
+    std::optional<std::pair<Hash, SearchResult>> ponderResult{};
+    std::swap(ponderResult, search._ponderResult);
+    if (ponderResult && ponderResult->first == b.hash()
+        && ponderResult->second.depth > 0 && search.config().multiPv == 1)
+    {
+        // Ponder hit. Play it if it searched as deeply as the bot would
+        // search now, or for at least the soft limit of its time budget
+        // (after which the bot would start no new iteration either).
+        const SearchResult &result = ponderResult->second;
+        if (result.depth >= search.config().maxDepth
+            || (timeManager.isLimited()
+                && result.elapsed >= timeManager.softLimit()))
+        {
+            cout << "Search (" << to_string(c) << "): ponder hit: " << result
+                 << "\n";
+            search._lastPv = result.pv;
+            return ExtMove(result.bestMove, false, GameEnd::InPlay);
+        }
+    }
+    vector<SearchResult> results = search.searchMultiPv(
+        const_cast<Board &>(b), c, search.config().multiPv); // Temp changes
+    const SearchResult &result = results.front();
+    search._lastPv = result.pv;
+    cout << "Search (" << to_string(c) << "): " << result << "; "
+         << search.stats() << "\n";
+    for (Short k = 1; k < Short(results.size()); ++k) {
+        cout << "  #" << k + 1 << ": " << results[k] << "\n";
+    }
+    if (!result.bestMove) {
+        cout << "Search (" << to_string(c)
+             << "): No move found. Playing a random move.\n";
+        return Move::strategyRandom(b, c, validPlayerMoves);
+    }
+    return ExtMove(result.bestMove, false, GameEnd::InPlay);
+}
+
+// ---------- Constructor
+Search::Search(const SearchConfig &config /* =SearchConfig{} */)
+    : _config{config}, _stats{}, _timeManager{}, _isStopped{false},
+      _tt{config.ttSizeLog2}, _pawnTable{config.pawnHashSizeLog2},
+      _evalCache{config.evalCacheSizeLog2},
+      _orderTables{},
+      _pvTable{}, _lineExtensions{}, _excludedMoves{}, _lastPv{},
+      _ponderResult{std::nullopt}, _rootMoves{}, _isRootRestricted{false},
+      _rootBestMove{std::nullopt}
+{
+    _excludedMoves.fill(NO_MOVE_CODE);
+}
+
+// ---------- Public read methods
+OptMove Search::predictedReply() const {
+    return _lastPv.size() >= 2 ? OptMove{_lastPv[1]} : std::nullopt;
+}
+
+// ---------- Public write methods
+void Search::clear() {
+    _tt.clear();
+    _pawnTable.clear();
+    _evalCache.clear();
+    _orderTables.clear();
+    _lastPv.clear();
+    _ponderResult = std::nullopt;
+}
+
+void Search::setPonderResult(Hash boardHash, const SearchResult &result) {
+    _ponderResult = std::make_pair(boardHash, result);
+}
+
+bool Search::setOption(const std::string &name, const std::string &value) {
+    static const map<std::string, bool SearchConfig::*> name2flag{
+        {"ordering", &SearchConfig::useMoveOrdering},
+        {"nullMove", &SearchConfig::useNullMove},
+        {"lmr", &SearchConfig::useLmr},
+        {"rfp", &SearchConfig::useRfp},
+        {"lmp", &SearchConfig::useLmp},
+        {"pvs", &SearchConfig::usePvs},
+        {"aspiration", &SearchConfig::useAspiration},
+        {"checkExt", &SearchConfig::useCheckExt},
+        {"recaptureExt", &SearchConfig::useRecaptureExt},
+        {"pawnExt", &SearchConfig::usePawnExt},
+        {"singularExt", &SearchConfig::useSingularExt},
+        {"ponder", &SearchConfig::usePonder},
+        {"mtdf", &SearchConfig::useMtdf},
+        {"nnue", &SearchConfig::useNnue},
+        {"lazyEval", &SearchConfig::useLazyEval},
+        {"verifyLazyEval", &SearchConfig::verifyLazyEval},
+        {"tablebases", &SearchConfig::useTablebases}
+    };
+    static const map<std::string, Short SearchConfig::*> name2num{
+        {"depth", &SearchConfig::maxDepth},
+        {"multiPv", &SearchConfig::multiPv},
+        {"extBudget", &SearchConfig::extensionBudget},
+        {"evalCache", &SearchConfig::evalCacheSizeLog2}
+    };
+    if (name2num.find(name) != name2num.end()) {
+        try {
+            Short num = std::stoi(value);
+            bool isValid = name == "extBudget"   ? num >= 0
+                           : name == "evalCache" ? num >= 0 && num <= 30
+                                                 : num > 0;
+            if (!isValid) {
+                return false; // Leave _config unchanged
+            }
+            _config.*name2num.at(name) = num;
+            if (name == "evalCache") {
+                _evalCache = EvalCache{num}; // Resize
+            }
+            return true;
+        } catch (std::invalid_argument &ex) {
+            return false;
+        } catch (std::out_of_range &ex) {
+            return false;
+        }
+    }
+    if (name2flag.find(name) == name2flag.end()) {
+        return false;
+    }
+    if (value != "on" && value != "off") {
+        return false;
+    }
+    _config.*name2flag.at(name) = value == "on";
+    return true;
+}
+
+// Iterative deepening: Each iteration seeds the next with its best move
+// (via the transposition table), with killer and history entries, and with
+// its score (as the center of the aspiration window).
+// The caller starts the TimeManager. The result of an iteration interrupted
+// by stop() or by the hard time limit is discarded, unless no iteration has
+// been completed yet.
+SearchResult Search::search(Board &b, Color c) {
+    _startSearch();
+    _rootMoves = _legalMoves(b, c);
+    _isRootRestricted = false;
+    vector<SearchResult> tbResults = _tablebaseResults(b, c, _rootMoves, 1);
+    if (!tbResults.empty()) {
+        return tbResults.front();
+    }
+    return _iterativeDeepening(b, c);
+}
+
+// Multi-PV: Each pass is a full iterative-deepening search of the root moves
+// not yet reported. The transposition table and the move ordering tables
+// carry over from pass to pass, so later passes are much cheaper.
+vector<SearchResult> Search::searchMultiPv(Board &b, Color c, Short k) {
+    _startSearch();
+    Moves legalMoves = _legalMoves(b, c);
+    vector<SearchResult> results = _tablebaseResults(b, c, legalMoves, k);
+    if (!results.empty()) {
+        return results;
+    }
+    Moves reported{};
+    while (Short(results.size()) < std::min(k, Short(legalMoves.size()))) {
+        _rootMoves.clear();
+        std::copy_if(legalMoves.begin(), legalMoves.end(),
+                     std::back_inserter(_rootMoves), [&](const Move &m) {
+                         return std::find(reported.begin(), reported.end(), m)
+                             == reported.end();
+                     });
+        _isRootRestricted = !reported.empty();
+        SearchResult result = _iterativeDeepening(b, c);
+        if (isStopped() && result.depth == 0 && !results.empty()) {
+            break; // Out of time before this pass completed an iteration
+        }
+        results.push_back(result);
+        if (!result.bestMove || isStopped()) {
+            break; // No move to exclude from the next pass
+        }
+        reported.push_back(*result.bestMove);
+    }
+    if (legalMoves.empty()) {
+        _rootMoves.clear();
+        results.push_back(_iterativeDeepening(b, c)); // Mate or stalemate
+    }
+    return results;
+}
+
+vector<vector<SearchResult>>
+Search::analyze(const vector<std::pair<Board, Color>> &positions, Short k) {
+    vector<vector<SearchResult>> results{};
+    results.reserve(positions.size());
+    for (const auto &[b, c] : positions) {
+        // Temp board changes, undone
+        results.push_back(searchMultiPv(const_cast<Board &>(b), c, k));
+    }
+    return results;
+}
+
+// ---------- Private static methods
+Hash Search::_key(const Board &b, Color c) {
+    return c == Color::White ? b.hash() ^ SIDE_TO_MOVE_KEY : b.hash();
+}
+
+// Move rules leave the promotion type open. Search each choice separately.
+Moves Search::_expandPromotions(const Moves &moves) {
+    Moves result{};
+    result.reserve(moves.size() + VECTOR_CAPACITY_INCR);
+    for (const Move &move : moves) {
+        if (move.pieceType() == PieceType::Pawn && !move.isPromotion()
+            && move.to().isPawnPromotionRow(move.color()))
+        {
+            for (PieceType pt : {PieceType::Queen, PieceType::Knight,
+                                 PieceType::Rook, PieceType::Bishop})
+            {
+                Move promotion{move};
+                promotion.setPromotionType(pt);
+                result.push_back(promotion);
+            }
+        } else {
+            result.push_back(move);
+        }
+    }
+    return result;
+}
+
+// Logarithmic late-move reduction, in plies.
+Short Search::_lmrReduction(Short depth, Short moveNumber) {
+    static const auto table{[]() {
+        std::array<std::array<Short, MAX_PLY>, MAX_PLY> result{};
+        for (Short d = 1; d < MAX_PLY; ++d) {
+            for (Short m = 1; m < MAX_PLY; ++m) {
+                result[d][m] = Short(0.75 + std::log(d) * std::log(m) / 2.25);
+            }
+        }
+        return result;
+    }()};
+    return table[std::min(depth, Short(MAX_PLY - 1))]
+                [std::min(moveNumber, Short(MAX_PLY - 1))];
+}
+
+// ---------- Private read methods
+
+Moves Search::_legalMoves(const Board &b, Color c) const {
+    return _expandPromotions(concatMap(Move::getValidPlayerMoves(b, c)));
+}
+
+const Tablebases *Search::_tablebasesFor(const Board &b) const {
+    const Tablebases *tablesP =
+        _config.useTablebases ? Tablebases::active() : nullptr;
+    return tablesP && b.pieceCount() <= tablesP->maxPieces() ? tablesP
+                                                             : nullptr;
+}
+
+// Moves that obey the Move rules but might leave the King in check. Legality
+// is checked only for the moves actually searched.
+Moves Search::_pseudoLegalMoves(const Board &b, Color c,
+                                bool capturesOnly) const
+{
+    // Board keeps Pieces ordered by address: Sort them by square, so that
+    // the search does not depend on the heap layout.
+    const PiecePs &pieceSet = b.piecesWithColor(c);
+    std::vector<PieceP> pieces{pieceSet.begin(), pieceSet.end()};
+    std::sort(pieces.begin(), pieces.end(),
+              [](const PieceP &p1, const PieceP &p2) {
+                  return p1->pos().index() < p2->pos().index();
+              });
+    Moves result{};
+    for (const PieceP &pieceP : pieces) {
+        const MoveRule &moveRule = Move::getMoveRule(pieceP->pieceType());
+        for (const Move &move : moveRule(b, c, pieceP->pos())) {
+            bool isPromotion = move.pieceType() == PieceType::Pawn
+                && move.to().isPawnPromotionRow(c);
+            if (!capturesOnly || move.isCapture() || isPromotion) {
+                result.push_back(move);
+            }
+        }
+    }
+    result = _expandPromotions(result);
+    if (capturesOnly) {
+        // Underpromotions are not worth searching in the quiescence search.
+        result.erase(std::remove_if(result.begin(), result.end(),
+                                    [](const Move &m) {
+                                        return m.isPromotion()
+                                            && m.promotionType()
+                                                   != PieceType::Queen;
+                                    }),
+                     result.end());
+    }
+    return result;
+}
+
+// ---------- Private write methods
+
+// Tapered material, piece-square, Pawn structure and mobility balance (see
+// eval.h), in centipawns, from the viewpoint of Color c. Or, if a network is
+// loaded, its evaluation (see Nnue). With useLazyEval, the cheaper stages
+// come first, and a score that stays far outside (alpha, beta) is returned
+// early, as a fail-soft bound. Only full evaluations are cached.
+Score Search::_evaluate(const Board &b, Color c,
+                        Score alpha /* =-SCORE_INFINITE */,
+                        Score beta /* =SCORE_INFINITE */)
+{
+    bool isNnue = _config.useNnue && Nnue::active();
+    // 1 for the classical evaluation, and per network after that
+    Evaluator evaluator = isNnue ? Nnue::generation() + 2 : 1;
+    Hash key = _key(b, c);
+    ++_stats.evalCacheProbes;
+    if (std::optional<EvalValue> oValue = _evalCache.probe(key, evaluator)) {
+        ++_stats.evalCacheHits;
+        return Score(*oValue);
+    }
+
+    EvalValue value = 0;
+    // Whether to stop after the given stage
+    auto isLazyExit = [&](EvalStage stage) {
+        Short k = static_cast<Short>(stage);
+        Score margin = LAZY_MARGINS[k] + (isNnue ? LAZY_NNUE_MARGIN : 0);
+        if (value + margin > alpha && value - margin < beta) {
+            return false;
+        }
+        ++_stats.lazyExits[k];
+        if (_config.verifyLazyEval) {
+            Score full = _evaluate(b, c);
+            _stats.lazyMisses[k] += full > alpha && full < beta ? 1 : 0;
+        }
+        return true;
+    };
+    bool isStaged = _config.useLazyEval
+        && (alpha > -SCORE_INFINITE || beta < SCORE_INFINITE);
+    if (!isNnue || isStaged) {
+        Short phase = b.evalAccumulator().phase;
+        value = b.evaluate(c);
+        if (isStaged && isLazyExit(EvalStage::Material)) {
+            return Score(value);
+        }
+
+        ++_stats.pawnProbes;
+        const PawnEntry *entry = _pawnTable.probe(b.pawnHash());
+        if (entry) {
+            ++_stats.pawnHits;
+        } else {
+            entry = &_pawnTable.store(evaluatePawns(b.pawnHash(), b.pawns()));
+        }
+        value += entry->value(c, b.king(Color::Black).pos().index(),
+                              b.king(Color::White).pos().index(), phase);
+        if (isStaged && isLazyExit(EvalStage::Pawns)) {
+            return Score(value);
+        }
+
+        value += evaluateMobility(c, b.pieceBitboards(), phase);
+        if (isNnue && isLazyExit(EvalStage::Mobility)) {
+            return Score(value);
+        }
+    }
+    if (isNnue) {
+        value = b.nnueEvaluate(c);
+    }
+    _evalCache.store(key, evaluator, value);
+    return Score(value);
+}
+
+void Search::_startSearch() {
+    _isStopped.store(false);
+    if (!_timeManager.isLimited()) {
+        _timeManager.startUnlimited(); // Just times the search
+    }
+    _stats.clear();
+    _orderTables.age();
+}
+
+SearchResult Search::_iterativeDeepening(Board &b, Color c) {
+    for (Moves &pv : _pvTable) {
+        pv.clear();
+    }
+    _rootBestMove = std::nullopt;
+
+    SearchResult result{std::nullopt, 0, 0, Moves{}};
+    if (_rootMoves.empty()) {
+        result.score = Move::isInCheck(b, c) ? -SCORE_MATE : 0;
+        return result;
+    }
+    for (Short depth = 1; depth <= _config.maxDepth; ++depth) {
+        if (depth > 1 && !_timeManager.shouldStartIteration()) {
+            break;
+        }
+        OptMove prevBestMove = result.bestMove;
+        Score score = _config.useMtdf
+            ? _mtdf(b, c, depth, result.score)
+            : _aspirationSearch(b, c, depth, result.score);
+        if (isStopped()) {
+            if (!result.bestMove) {
+                // Nothing completed. Use the best root move seen so far.
+                result.bestMove = _rootBestMove ? _rootBestMove
+                                                : OptMove{_rootMoves.front()};
+            }
+            break;
+        }
+        result = SearchResult{_rootBestMove, score, depth, _pvTable[0]};
+        result.elapsed = _timeManager.elapsed();
+        _timeManager.onIterationDone(!(result.bestMove == prevBestMove));
+        Logger::info("Search::search: ", result, "; ", _stats);
+        if (std::abs(score) >= SCORE_MATE_BOUND) {
+            break; // Forced mate found; deeper search cannot improve on it.
+        }
+    }
+    return result;
+}
+
+// Every STOP_POLL_NODES nodes, check the hard time limit.
+bool Search::_pollStop() {
+    if ((_stats.nodes + _stats.qnodes) % STOP_POLL_NODES == 0
+        && _timeManager.isHardLimitReached())
+    {
+        _isStopped.store(true);
+    }
+    return isStopped();
+}
+
+Score Search::_alphaBeta(Board &b, Color c, Short depth, Short ply,
+                         Score alpha, Score beta,
+                         bool isNullMoveAllowed /* =true */)
+{
+    _pvTable[ply].clear();
+    if (depth <= 0) {
+        return _quiesce(b, c, ply, alpha, beta);
+    }
+    ++_stats.nodes;
+    if (_pollStop()) {
+        return 0; // Discarded by callers
+    }
+    if (ply >= MAX_PLY - 1) {
+        return _evaluate(b, c);
+    }
+
+    // Only PV nodes have an open window. Elsewhere, a null window only asks
+    // whether the score is above alpha.
+    bool isPvNode = beta - alpha > 1;
+
+    // A singular extension search skips one move. Its results must not be
+    // mixed with those of the full node in the transposition table.
+    MoveCode excludedCode = _excludedMoves[ply];
+    bool isExcludedSearch = excludedCode != NO_MOVE_CODE;
+
+    // Transposition table. PV nodes search on, to keep the PV intact.
+    Hash key = _key(b, c);
+    MoveCode ttCode = NO_MOVE_CODE;
+    std::optional<TTEntry> ttEntry = std::nullopt;
+    if (const TTEntry *entry = _tt.probe(key); entry && !isExcludedSearch) {
+        ttCode = entry->moveCode;
+        ttEntry = *entry;
+        if (!isPvNode && entry->depth >= depth) {
+            Score ttScore = TranspositionTable::scoreFromTT(entry->score, ply);
+            if (entry->bound == Bound::Exact
+                || (entry->bound == Bound::Lower && ttScore >= beta)
+                || (entry->bound == Bound::Upper && ttScore <= alpha))
+            {
+                return ttScore;
+            }
+        }
+    }
+
+    // Tablebases: An ending that they cover needs no search.
+    if (!isExcludedSearch) {
+        if (std::optional<Score> oTbScore = _probeTablebases(b, c, ply)) {
+            _tt.store(key, *oTbScore, MAX_PLY, Bound::Exact, NO_MOVE_CODE,
+                      ply);
+            return *oTbScore;
+        }
+    }
+
+    bool isInCheck = Move::isInCheck(b, c);
+    Score staticEval = isInCheck ? -SCORE_INFINITE : _evaluate(b, c);
+    bool isBetaDecisive = std::abs(beta) >= SCORE_TB_WIN_BOUND; // Mate or TB
+
+    // Reverse futility pruning: Near the horizon, assume that a position far
+    // above beta will stay above beta.
+    if (_config.useRfp && !isPvNode && !isExcludedSearch && !isInCheck
+        && !isBetaDecisive && depth <= RFP_MAX_DEPTH
+        && staticEval - RFP_MARGIN * depth >= beta)
+    {
+        ++_stats.rfpCutoffs;
+        return staticEval;
+    }
+
+    // Null-move pruning: If passing still fails high, a real move would too.
+    // Passing is only a lower bound when having the move is an advantage, so
+    // skip it when the side to move has only King and Pawns (zugzwang risk).
+    if (_config.useNullMove && !isPvNode && !isExcludedSearch
+        && isNullMoveAllowed && !isInCheck && !isBetaDecisive
+        && depth >= NULL_MOVE_MIN_DEPTH && staticEval >= beta
+        && b.nonPawnMaterial(c) > 0)
+    {
+        ++_stats.nullMoveTries;
+        Short r = NULL_MOVE_REDUCTION + depth / 4;
+        _lineExtensions[ply + 1] = _lineExtensions[ply];
+        Score score = -_alphaBeta(b, opponent(c), depth - 1 - r, ply + 1,
+                                  -beta, -beta + 1, false);
+        if (isStopped()) {
+            return 0;
+        }
+        if (score >= beta) {
+            ++_stats.nullMoveCutoffs;
+            return score >= SCORE_TB_WIN_BOUND ? beta : score;
+        }
+    }
+
+    // Singular extension: If every other move fails low against a bound
+    // somewhat below the TT score, the TT move is the only good move.
+    bool isTtMoveSingular = false;
+    if (_config.useSingularExt && ttEntry && !isExcludedSearch
+        && depth >= SINGULAR_MIN_DEPTH && ttCode != NO_MOVE_CODE
+        && ttEntry->bound != Bound::Upper
+        && ttEntry->depth >= depth - SINGULAR_TT_DEPTH_SLACK
+        && std::abs(ttEntry->score) < SCORE_TB_WIN_BOUND
+        && _lineExtensions[ply] < _config.extensionBudget)
+    {
+        Score singularBeta = ttEntry->score - SINGULAR_MARGIN * depth;
+        _excludedMoves[ply] = ttCode;
+        Score score = _alphaBeta(b, c, (depth - 1) / 2, ply, singularBeta - 1,
+                                 singularBeta, false);
+        _excludedMoves[ply] = NO_MOVE_CODE;
+        if (isStopped()) {
+            return 0;
+        }
+        isTtMoveSingular = score < singularBeta;
+    }
+
+    const Moves &history = Move::getMoveHistory();
+    OptMove prevMove = history.empty() ? std::nullopt
+                                       : OptMove{history.back()};
+    MoveCode counterCode = prevMove ? _orderTables.counterMove(*prevMove)
+                                    : NO_MOVE_CODE;
+    MovePicker picker{_pseudoLegalMoves(b, c, false), ttCode, _orderTables,
+                      ply, counterCode, _config.useMoveOrdering};
+
+    Score alphaOrig = alpha;
+    Score bestScore = -SCORE_INFINITE;
+    MoveCode bestCode = NO_MOVE_CODE;
+    Short legalCount = 0;
+    vector<MoveCode> quietsTried{};
+    while (const Move *moveP = picker.next()) {
+        const Move &move = *moveP;
+        bool isQuiet = !move.isCapture() && !move.isPromotion();
+        bool isQueenOrNoPromotion = !move.isPromotion()
+            || move.promotionType() == PieceType::Queen;
+        bool isTtMove = move.code() == ttCode && isQueenOrNoPromotion;
+        if (isExcludedSearch && move.code() == excludedCode
+            && isQueenOrNoPromotion)
+        {
+            continue;
+        }
+
+        // Late-move pruning: Near the horizon, quiet moves ordered late
+        // rarely matter.
+        if (_config.useLmp && !isInCheck && isQuiet && depth <= LMP_MAX_DEPTH
+            && legalCount > 0 && bestScore > -SCORE_TB_WIN_BOUND
+            && Short(quietsTried.size()) >= LMP_BASE_MOVES + depth * depth)
+        {
+            ++_stats.lmpPrunes;
+            continue;
+        }
+
+        move.apply(b);
+        if (Move::isInCheck(b, c)) {
+            move.applyUndo(b);
+            continue; // Illegal: Leaves own King in check
+        }
+        ++legalCount;
+        bool givesCheck = Move::isInCheck(b, opponent(c));
+        OptExtension ext = _extension(move, prevMove, givesCheck, ply,
+                                      isTtMoveSingular && isTtMove);
+
+        // Late-move reductions: Search late quiet moves less deeply, and
+        // search again at full depth only if they turn out to beat alpha.
+        Short reduction = 0;
+        if (_config.useLmr && depth >= LMR_MIN_DEPTH && !isInCheck && isQuiet
+            && !ext && legalCount > LMR_MIN_MOVES
+            && !_orderTables.isKiller(ply, move.code()) && !givesCheck)
+        {
+            reduction = std::clamp(_lmrReduction(depth, legalCount), Short(0),
+                                   Short(depth - 2));
+        }
+        long long nodesBefore = _stats.nodes + _stats.qnodes;
+        _lineExtensions[ply + 1] = _lineExtensions[ply] + (ext ? 1 : 0);
+        Score score = _searchMove(b, c, depth + (ext ? 1 : 0), ply, alpha,
+                                  beta, reduction, legalCount == 1);
+        move.applyUndo(b);
+        if (isStopped()) {
+            return 0;
+        }
+        if (ext) {
+            Short k = static_cast<Short>(*ext);
+            ++_stats.extensions[k];
+            _stats.extensionNodes[k] +=
+                _stats.nodes + _stats.qnodes - nodesBefore;
+        }
+
+        if (score > bestScore) {
+            bestScore = score;
+            bestCode = move.code();
+        }
+        if (score > alpha) {
+            alpha = score;
+            if (isPvNode) {
+                _updatePv(ply, move);
+            }
+        }
+        if (alpha >= beta) {
+            MoveOrderStats &os = _stats.ordering;
+            ++os.cutoffs;
+            os.firstMoveCutoffs += legalCount == 1 ? 1 : 0;
+            os.ttMoveCutoffs += picker.lastWasTtMove() ? 1 : 0;
+            os.killerCutoffs += picker.lastWasKiller() ? 1 : 0;
+            os.counterCutoffs += picker.lastWasCounterMove() ? 1 : 0;
+            if (isQuiet) {
+                _updateQuietCutoff(move, c, depth, ply, quietsTried);
+            }
+            break;
+        }
+        if (isQuiet) {
+            quietsTried.push_back(move.code());
+        }
+    }
+
+    if (legalCount == 0) {
+        if (isExcludedSearch) {
+            return alpha; // Only the excluded move: Nothing else is as good.
+        }
+        return isInCheck ? -SCORE_MATE + ply : 0;
+    }
+    if (!isExcludedSearch) {
+        Bound bound = bestScore >= beta       ? Bound::Lower
+                      : bestScore > alphaOrig ? Bound::Exact
+                                              : Bound::Upper;
+        _tt.store(key, bestScore, depth, bound, bestCode, ply);
+    }
+    return bestScore;
+}
+
+// A win (or loss) by the tables is scored as one at this ply, so that nearer
+// ones are preferred, but any mate found by search comes first.
+std::optional<Score> Search::_probeTablebases(const Board &b, Color c,
+                                              Short ply)
+{
+    const Tablebases *tablesP = _tablebasesFor(b);
+    if (!tablesP) {
+        return std::nullopt;
+    }
+    std::optional<TbValue> oValue = tablesP->probe(Position::fromBoard(b, c));
+    if (!oValue || *oValue == TB_BROKEN) {
+        return std::nullopt;
+    }
+    ++_stats.tbHits;
+    return isTbWin(*oValue)    ? SCORE_TB_WIN - ply
+           : isTbLoss(*oValue) ? -SCORE_TB_WIN + ply
+                               : 0;
+}
+
+std::optional<vector<std::pair<Move, TbValue>>>
+Search::_tablebaseMoves(Board &b, Color c, const Moves &moves) {
+    const Tablebases *tablesP = _tablebasesFor(b);
+    if (!tablesP) {
+        return std::nullopt;
+    }
+    vector<std::pair<Move, TbValue>> result{};
+    for (const Move &move : moves) {
+        move.apply(b);
+        std::optional<TbValue> oValue =
+            tablesP->probe(Position::fromBoard(b, opponent(c)));
+        move.applyUndo(b);
+        if (!oValue || *oValue == TB_BROKEN) {
+            return std::nullopt;
+        }
+        result.emplace_back(move, tbParent(*oValue));
+    }
+    std::stable_sort(result.begin(), result.end(),
+                     [](const auto &mv1, const auto &mv2) {
+                         return tbRank(mv1.second) > tbRank(mv2.second);
+                     });
+    return result;
+}
+
+// The moves that keep the best result, by distance to mate. Each is scored
+// as a mate (or as a tablebase win, if too far for search), and its PV
+// follows the best moves by the tables.
+vector<SearchResult> Search::_tablebaseResults(Board &b, Color c,
+                                               const Moves &moves, Short k)
+{
+    std::optional<vector<std::pair<Move, TbValue>>> oMoveValues =
+        _tablebaseMoves(b, c, moves);
+    if (!oMoveValues || oMoveValues->empty()) {
+        return {};
+    }
+    ++_stats.tbHits;
+    Wdl bestWdl = toTbResult(oMoveValues->front().second).wdl;
+    Short pvPlies = std::max(_config.maxDepth, Short(2));
+    vector<SearchResult> results{};
+    for (const auto &[move, value] : *oMoveValues) {
+        if (Short(results.size()) >= k || toTbResult(value).wdl != bestWdl) {
+            break;
+        }
+        Moves pv{move};
+        move.apply(b);
+        for (Color side = opponent(c); Short(pv.size()) < pvPlies;
+             side = opponent(side))
+        {
+            std::optional<vector<std::pair<Move, TbValue>>> oReplies =
+                _tablebaseMoves(b, side, _legalMoves(b, side));
+            if (!oReplies || oReplies->empty()) {
+                break;
+            }
+            pv.push_back(oReplies->front().first);
+            pv.back().apply(b);
+        }
+        for (auto iter = pv.rbegin(); iter != pv.rend(); ++iter) {
+            iter->applyUndo(b);
+        }
+        Short plies = tbPlies(value);
+        Score mate = plies < MAX_PLY ? SCORE_MATE - plies : SCORE_TB_WIN;
+        Score score = isTbWin(value) ? mate : isTbLoss(value) ? -mate : 0;
+        results.push_back(
+            SearchResult{move, score, 0, pv, _timeManager.elapsed()});
+    }
+    return results;
+}
+
+// Search captures (and Queen promotions) until the position is quiet, so
+// that the static evaluation is not taken in the middle of an exchange.
+Score Search::_quiesce(Board &b, Color c, Short ply, Score alpha, Score beta) {
+    ++_stats.qnodes;
+    if (_pollStop()) {
+        return 0;
+    }
+    Score standPat = _evaluate(b, c, alpha, beta);
+    if (ply >= MAX_PLY - 1 || standPat >= beta) {
+        return standPat;
+    }
+    if (standPat > alpha) {
+        alpha = standPat;
+    }
+
+    MovePicker picker{_pseudoLegalMoves(b, c, true), NO_MOVE_CODE,
+                      _orderTables, ply, NO_MOVE_CODE,
+                      _config.useMoveOrdering};
+    Score bestScore = standPat;
+    while (const Move *moveP = picker.next()) {
+        const Move &move = *moveP;
+        move.apply(b);
+        if (Move::isInCheck(b, c)) {
+            move.applyUndo(b);
+            continue;
+        }
+        Score score = -_quiesce(b, opponent(c), ply + 1, -beta, -alpha);
+        move.applyUndo(b);
+        if (isStopped()) {
+            return 0;
+        }
+        if (score > bestScore) {
+            bestScore = score;
+        }
+        if (score > alpha) {
+            alpha = score;
+        }
+        if (alpha >= beta) {
+            break;
+        }
+    }
+    return bestScore;
+}
+
+// Search the moves at the root of the tree. On a fail low, the best move and
+// PV from the previous (wider or shallower) search are kept.
+Score Search::_searchRoot(Board &b, Color c, Short depth, Score alpha,
+                          Score beta)
+{
+    ++_stats.nodes;
+    MoveCode ttCode = _rootBestMove ? _rootBestMove->code() : NO_MOVE_CODE;
+    MovePicker picker{_rootMoves, ttCode, _orderTables, 0, NO_MOVE_CODE,
+                      _config.useMoveOrdering};
+
+    Score alphaOrig = alpha;
+    Score bestScore = -SCORE_INFINITE;
+    MoveCode bestCode = NO_MOVE_CODE;
+    Short moveCount = 0;
+    _lineExtensions[0] = 0;
+    while (const Move *moveP = picker.next()) {
+        const Move &move = *moveP;
+        ++moveCount;
+        _lineExtensions[1] = 0;
+        move.apply(b);
+        Score score =
+            _searchMove(b, c, depth, 0, alpha, beta, 0, moveCount == 1);
+        move.applyUndo(b);
+        if (isStopped()) {
+            return bestScore;
+        }
+        if (score > bestScore) {
+            bestScore = score;
+            bestCode = move.code();
+        }
+        if (score > alpha) {
+            alpha = score;
+            _rootBestMove = move;
+            _updatePv(0, move);
+        }
+        if (alpha >= beta) {
+            break;
+        }
+    }
+    if (!_isRootRestricted) {
+        Bound bound = bestScore >= beta       ? Bound::Lower
+                      : bestScore > alphaOrig ? Bound::Exact
+                                              : Bound::Upper;
+        _tt.store(_key(b, c), bestScore, depth, bound, bestCode, 0);
+    }
+    return bestScore;
+}
+
+// Search a root window centered on the previous iteration's score. If the
+// score falls outside it, widen the window on that side and search again.
+Score Search::_aspirationSearch(Board &b, Color c, Short depth,
+                                Score prevScore)
+{
+    if (!_config.useAspiration || depth < ASPIRATION_MIN_DEPTH
+        || std::abs(prevScore) >= SCORE_TB_WIN_BOUND)
+    {
+        return _searchRoot(b, c, depth, -SCORE_INFINITE, SCORE_INFINITE);
+    }
+    Score delta = ASPIRATION_WINDOW;
+    Score alpha = std::max(prevScore - delta, -SCORE_INFINITE);
+    Score beta = std::min(prevScore + delta, SCORE_INFINITE);
+    while (true) {
+        Score score = _searchRoot(b, c, depth, alpha, beta);
+        if (isStopped() || (score > alpha && score < beta)) {
+            return score;
+        }
+        ++_stats.aspirationResearches;
+        delta *= 2;
+        if (score <= alpha) {
+            alpha = std::max(score - delta, -SCORE_INFINITE);
+        } else {
+            beta = std::min(score + delta, SCORE_INFINITE);
+        }
+    }
+}
+
+// MTD(f): A series of null-window root searches, starting from the previous
+// iteration's score. Each fails high (raising the lower bound on the score)
+// or low (lowering the upper bound), until the bounds meet. The
+// transposition table keeps the work of earlier passes, so later ones are
+// cheap.
+// Pruning and lazy evaluation make many passes fail just past beta, so
+// while only one bound is known, the step past the returned score grows
+// (by MTDF_STEP_GROWTH) with each pass in the same direction. Once both are
+// known, the window between them is bisected. A pass that contradicts an
+// earlier one (search instability) is settled by a full-window search.
+Score Search::_mtdf(Board &b, Color c, Short depth, Score guess) {
+    Score score = guess;
+    Score lower = -SCORE_INFINITE;
+    Score upper = SCORE_INFINITE;
+    Score beta = std::max(guess, -SCORE_INFINITE + 1);
+    Score step = 1;
+    std::optional<bool> wasFailHigh = std::nullopt;
+    while (lower < upper) {
+        ++_stats.mtdfPasses;
+        score = _searchRoot(b, c, depth, beta - 1, beta);
+        if (isStopped()) {
+            break;
+        }
+        bool isFailHigh = score >= beta;
+        if (isFailHigh ? score > upper : score < lower) {
+            ++_stats.mtdfPasses;
+            return _searchRoot(b, c, depth, -SCORE_INFINITE, SCORE_INFINITE);
+        }
+        (isFailHigh ? lower : upper) = score;
+        step = wasFailHigh == isFailHigh ? MTDF_STEP_GROWTH * step : 1;
+        wasFailHigh = isFailHigh;
+        beta = isFailHigh ? score + step : score + 1 - step;
+        if ((lower > -SCORE_INFINITE && upper < SCORE_INFINITE)
+            || beta <= lower || beta > upper)
+        {
+            beta = lower + (upper - lower + 1) / 2;
+        }
+    }
+    return score;
+}
+
+// Search the move just applied, which led from ply to ply+1. With PVS, only
+// the first move gets the full window. Later moves (possibly reduced by LMR)
+// get a null window, which just shows that they are no better than alpha;
+// those that beat alpha are searched again, at full depth, then full width.
+Score Search::_searchMove(Board &b, Color c, Short depth, Short ply,
+                          Score alpha, Score beta, Short reduction,
+                          bool isFirstMove)
+{
+    Color opp = opponent(c);
+    Score score = 0;
+    bool isSearchNeeded = true;
+    if (reduction > 0) {
+        ++_stats.lmrReductions;
+        score = -_alphaBeta(b, opp, depth - 1 - reduction, ply + 1,
+                            -alpha - 1, -alpha);
+        isSearchNeeded = score > alpha;
+        _stats.lmrResearches += isSearchNeeded ? 1 : 0;
+    }
+    if (isSearchNeeded && _config.usePvs && !isFirstMove) {
+        score = -_alphaBeta(b, opp, depth - 1, ply + 1, -alpha - 1, -alpha);
+        isSearchNeeded = score > alpha && score < beta;
+        _stats.pvsResearches += isSearchNeeded ? 1 : 0;
+    }
+    if (isSearchNeeded) {
+        score = -_alphaBeta(b, opp, depth - 1, ply + 1, -beta, -alpha);
+    }
+    return score;
+}
+
+// The extension, if any, for the move just applied. Each line may be
+// extended by at most extensionBudget plies in total.
+OptExtension Search::_extension(const Move &move, const OptMove &prevMove,
+                                bool givesCheck, Short ply,
+                                bool isSingular) const
+{
+    if (_lineExtensions[ply] >= _config.extensionBudget) {
+        return std::nullopt;
+    }
+    if (_config.useSingularExt && isSingular) {
+        return Extension::Singular;
+    }
+    if (_config.useCheckExt && givesCheck) {
+        return Extension::Check;
+    }
+    if (_config.useRecaptureExt && move.isCapture() && prevMove
+        && prevMove->isCapture() && prevMove->to() == move.to())
+    {
+        return Extension::Recapture;
+    }
+    if (_config.usePawnExt && move.pieceType() == PieceType::Pawn
+        && move.to().toRelRow(move.color()) == BOARD_PAWN_PROMOTION_ROW - 1)
+    {
+        return Extension::PawnPush;
+    }
+    return std::nullopt;
+}
+
+void Search::_updatePv(Short ply, const Move &move) {
+    Moves &pv = _pvTable[ply];
+    pv.clear();
+    pv.push_back(move);
+    if (ply + 1 < MAX_PLY) {
+        const Moves &childPv = _pvTable[ply + 1];
+        pv.insert(pv.end(), childPv.begin(), childPv.end());
+    }
+}
+
+// A quiet move caused a beta cutoff: Remember it as a killer and countermove,
+// and shift history credit toward it and away from the quiet moves that failed.
+void Search::_updateQuietCutoff(const Move &move, Color c, Short depth,
+                                Short ply,
+                                const vector<MoveCode> &quietsTried)
+{
+    _orderTables.addKiller(ply, move.code());
+    _orderTables.updateHistory(c, move.code(), depth, true);
+    for (MoveCode code : quietsTried) {
+        _orderTables.updateHistory(c, code, depth, false);
+    }
+    const Moves &history = Move::getMoveHistory();
+    if (!history.empty()) {
+        _orderTables.setCounterMove(history.back(), move.code());
+    }
+}
@@ -0,0 +1,274 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "board.h"
+#include "clock.h"
+#include "eval.h"
+#include "move.h"
+#include "move_order.h"
+#include "tablebase.h"
+#include "time_manager.h"
+#include "transposition.h"
+#include "util.h"
+
+// ========================================
+// Extension
+
+// Reasons to search a move one ply deeper.
+enum class Extension {
+    Singular,  // The TT move is much better than the alternatives
+    Check,     // The move gives check
+    Recapture, // The move recaptures on the square of the previous capture
+    PawnPush   // A Pawn moves to its seventh row
+};
+constexpr Short EXTENSION_KINDS = 4;
+
+using OptExtension = std::optional<Extension>;
+
+std::string to_string(Extension ext);
+
+// Stages of a lazy static evaluation (see Search::_evaluate), cheapest
+// first. After each stage but the last, it stops if the score so far is too
+// far outside the window for the remaining stages to bring it back.
+enum class EvalStage {
+    Material, // Tapered material and piece-square tables
+    Pawns,    // Pawn structure and King shelter, via the PawnHashTable
+    Mobility, // Mobility and King-zone attacks
+    Nnue      // The active Nnue, if one is used
+};
+constexpr Short EVAL_STAGES = 4;
+
+std::string to_string(EvalStage stage);
+
+// ========================================
+// SearchConfig / SearchStats / SearchResult
+
+struct SearchConfig {
+    Short maxDepth = 3;       // Iterative deepening stops after this depth
+    Short ttSizeLog2 = 16;    // Transposition table holds 2^ttSizeLog2 entries
+    bool useMoveOrdering = true; // false: Search moves in generation order
+
+    // Selective search. Each can be toggled separately, for A/B self-play.
+    bool useNullMove = true; // Null-move pruning
+    bool useLmr = true;      // Late-move reductions
+    bool useRfp = true;      // Reverse futility pruning
+    bool useLmp = true;      // Late-move pruning
+
+    // Windows
+    bool usePvs = true;        // Null-window searches for non-PV moves
+    bool useAspiration = true; // Root window around the previous score
+
+    // Extensions. Extended plies along any one line are capped by the budget.
+    bool useCheckExt = true;
+    bool useRecaptureExt = true;
+    bool usePawnExt = true;
+    bool useSingularExt = true;
+    Short extensionBudget = 4;
+
+    Short multiPv = 1; // Root moves reported by strategyAlphaBeta
+    bool usePonder = true; // Search on a human opponent's time (see Ponderer)
+
+    bool useMtdf = false; // Root driver: MTD(f) instead of aspiration PVS
+
+    Short pawnHashSizeLog2 = 12; // PawnHashTable holds 2^this entries
+    bool useNnue = true; // Evaluate with the active Nnue, if one is loaded
+    Short evalCacheSizeLog2 = 16; // EvalCache holds 2^this entries (0: off)
+    bool useLazyEval = true; // Staged evaluation with early exits
+    // Also finish each evaluation that exits early, to count the exits that
+    // the full evaluation would not have justified. Slow: For tuning only.
+    bool verifyLazyEval = false;
+    bool useTablebases = true; // Probe the active Tablebases, if any
+};
+
+struct SearchStats {
+    long long nodes = 0;  // Full-width nodes
+    long long qnodes = 0; // Quiescence nodes
+    MoveOrderStats ordering;
+
+    long long nullMoveTries = 0;
+    long long nullMoveCutoffs = 0;
+    long long lmrReductions = 0;
+    long long lmrResearches = 0; // Reduced search beat alpha: Search again
+    long long rfpCutoffs = 0;
+    long long lmpPrunes = 0;     // Quiet moves skipped
+    long long pvsResearches = 0; // Null-window search beat alpha: Widen it
+    long long aspirationResearches = 0; // Root score fell outside the window
+    long long mtdfPasses = 0;    // Null-window root searches by MTD(f)
+    long long pawnProbes = 0;    // Static evaluations
+    long long pawnHits = 0;      // ... whose Pawn structure was cached
+    long long evalCacheProbes = 0;
+    long long evalCacheHits = 0; // Static evaluations not recomputed
+    // Per EvalStage: Lazy evaluations that stopped after it, and (with
+    // verifyLazyEval) those of them whose full score was inside the window.
+    std::array<long long, EVAL_STAGES> lazyExits{};
+    std::array<long long, EVAL_STAGES> lazyMisses{};
+    long long tbHits = 0; // Nodes (and roots) decided by the Tablebases
+
+    // Per Extension: How often it fired, and the nodes searched below the
+    // extended moves (nested extensions are counted for each).
+    std::array<long long, EXTENSION_KINDS> extensions{};
+    std::array<long long, EXTENSION_KINDS> extensionNodes{};
+
+    void clear() { *this = SearchStats{}; }
+};
+
+std::ostream &operator<<(std::ostream &os, const SearchStats &stats);
+
+struct SearchResult {
+    OptMove bestMove;
+    Score score;
+    Short depth;
+    Moves pv; // Principal variation, starting with bestMove
+    Millis elapsed{0}; // For a Ponderer's result: The whole pondering time
+};
+
+std::ostream &operator<<(std::ostream &os, const SearchResult &result);
+
+// ========================================
+// Search
+
+// Iterative-deepening principal variation search (PVS) with aspiration
+// windows, a transposition table, quiescence search, and move ordering
+// (see MovePicker). Alternatively, each iteration is driven by MTD(f).
+// Endings covered by the active Tablebases are not searched: Below the
+// root, a probe decides the node (win, draw or loss). At the root, only
+// the moves that keep the best result are considered, and the one with
+// the best distance to mate is played.
+// Boards are modified with Move::apply and restored with Move::applyUndo.
+// With a TimeManager limit, or when stop() is called (e.g., from another
+// thread), the search stops early and returns the result of the deepest
+// completed iteration.
+class Search {
+  public:
+    // ---------- Static methods
+    static Search &forColor(Color c); // Each computer Player keeps its tables
+    // The Game clock used to budget the time of strategyAlphaBeta, or nullptr.
+    static void setClock(const ChessClock *clockP) { _clockP = clockP; }
+    static ExtMove strategyAlphaBeta(const Board &b, Color c,
+                                     const Pos2Moves &validPlayerMoves);
+
+    // ---------- Constructor
+    Search(const SearchConfig &config = SearchConfig{});
+
+    // ---------- Public read methods
+    const SearchConfig &config() const { return _config; }
+    const SearchStats &stats() const { return _stats; }
+    const TranspositionTable &tt() const { return _tt; }
+    // Its hit and miss counts span searches, e.g., a whole batch analysis.
+    const EvalCache &evalCache() const { return _evalCache; }
+    bool isStopped() const { return _isStopped.load(); }
+    // The opponent's reply expected after the last move played: The second
+    // move of its PV.
+    OptMove predictedReply() const;
+
+    // ---------- Public write methods
+    SearchConfig &config() { return _config; }
+    TimeManager &timeManager() { return _timeManager; }
+    void clear(); // Forget tables, e.g., between games
+    // Set a SearchConfig field by name (e.g., "lmr", "off"). Returns false if
+    // the name or value is not recognized.
+    bool setOption(const std::string &name, const std::string &value);
+    SearchResult search(Board &b, Color c);
+    // The best k root moves, best first, each with its own score and PV.
+    std::vector<SearchResult> searchMultiPv(Board &b, Color c, Short k);
+    // Batch analysis: searchMultiPv for each position. The tables, incl. the
+    // EvalCache, carry over from position to position.
+    std::vector<std::vector<SearchResult>>
+    analyze(const std::vector<std::pair<Board, Color>> &positions, Short k);
+    void stop() { _isStopped.store(true); } // Thread-safe
+    // A result found while pondering, for the position with the given hash.
+    void setPonderResult(Hash boardHash, const SearchResult &result);
+
+  private:
+    static const ChessClock *_clockP;
+
+    // ---------- Private static methods
+    static Hash _key(const Board &b, Color c);
+    static Moves _expandPromotions(const Moves &moves);
+    static Short _lmrReduction(Short depth, Short moveNumber);
+
+    // ---------- Private read methods
+    OptExtension _extension(const Move &move, const OptMove &prevMove,
+                            bool givesCheck, Short ply, bool isSingular) const;
+    Moves _legalMoves(const Board &b, Color c) const;
+    Moves _pseudoLegalMoves(const Board &b, Color c, bool capturesOnly) const;
+    // The Tablebases to probe for the Board, or nullptr
+    const Tablebases *_tablebasesFor(const Board &b) const;
+
+    // ---------- Private write methods
+    void _startSearch();
+    // Probes the EvalCache, then evaluates in stages. Lazy: The score may be
+    // a bound, if it is far outside the window (alpha, beta).
+    Score _evaluate(const Board &b, Color c, Score alpha = -SCORE_INFINITE,
+                    Score beta = SCORE_INFINITE);
+    // The score of a node at ply > 0 that the Tablebases cover
+    std::optional<Score> _probeTablebases(const Board &b, Color c, Short ply);
+    // The value of each move by the Tablebases, best first, or nothing if
+    // they do not cover them all.
+    std::optional<std::vector<std::pair<Move, TbValue>>>
+    _tablebaseMoves(Board &b, Color c, const Moves &moves);
+    // The best k root moves by the Tablebases (see Search), or none if
+    // they do not cover the position.
+    std::vector<SearchResult> _tablebaseResults(Board &b, Color c,
+                                                const Moves &moves, Short k);
+    SearchResult _iterativeDeepening(Board &b, Color c); // Over _rootMoves
+    bool _pollStop();
+    Score _alphaBeta(Board &b, Color c, Short depth, Short ply, Score alpha,
+                     Score beta, bool isNullMoveAllowed = true);
+    Score _aspirationSearch(Board &b, Color c, Short depth, Score prevScore);
+    Score _mtdf(Board &b, Color c, Short depth, Score guess);
+    Score _quiesce(Board &b, Color c, Short ply, Score alpha, Score beta);
+    Score _searchRoot(Board &b, Color c, Short depth, Score alpha, Score beta);
+    Score _searchMove(Board &b, Color c, Short depth, Short ply, Score alpha,
+                      Score beta, Short reduction, bool isFirstMove);
+    void _updatePv(Short ply, const Move &move);
+    void _updateQuietCutoff(const Move &move, Color c, Short depth, Short ply,
+                            const std::vector<MoveCode> &quietsTried);
+
+    SearchConfig _config;
+    SearchStats _stats;
+    TimeManager _timeManager;
+    std::atomic<bool> _isStopped;
+    TranspositionTable _tt;
+    PawnHashTable _pawnTable;
+    EvalCache _evalCache;
+    MoveOrderTables _orderTables;
+
+    // Triangular PV table: Row ply holds the best line found from ply on,
+    // i.e., the move at ply followed by row ply+1.
+    std::array<Moves, MAX_PLY> _pvTable;
+    // Per ply: Extensions used on the line leading to it, and the move (if
+    // any) excluded by a singular extension search.
+    std::array<Short, MAX_PLY> _lineExtensions;
+    std::array<MoveCode, MAX_PLY> _excludedMoves;
+
+    Moves _lastPv; // Of the last move played by strategyAlphaBeta
+    std::optional<std::pair<Hash, SearchResult>> _ponderResult;
+
+    Moves _rootMoves;
+    bool _isRootRestricted; // Multi-PV: Some legal moves are not searched
+    OptMove _rootBestMove;
+};
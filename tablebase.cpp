@@ -0,0 +1,847 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tablebase.h"
+
+using std::string;
+
+namespace {
+
+constexpr char TB_MAGIC[4] = {'G', 'C', 'T', 'B'};
+constexpr std::uint32_t TB_VERSION = 2;
+
+const string TB_PIECE_LETTERS = "KQRBNP"; // In PieceType order
+constexpr PieceType PROMOTION_TYPES[] = {
+    PieceType::Queen, PieceType::Rook, PieceType::Bishop, PieceType::Knight
+};
+
+// ---------- Symmetry
+
+// Transform t: Bit 0 mirrors files, bit 1 mirrors rows, and bit 2 (after
+// them) swaps files and rows.
+Square transformSquare(Square sq, Short t) {
+    Col x = squareCol(sq);
+    Row y = squareRow(sq);
+    if (t & 1) {
+        x = BOARD_COLS - 1 - x;
+    }
+    if (t & 2) {
+        y = BOARD_ROWS - 1 - y;
+    }
+    return t & 4 ? toSquare(y, x) : toSquare(x, y);
+}
+
+// The legal, symmetry-reduced placements of the two Kings.
+struct KingPairs {
+    std::array<std::array<std::int16_t, BOARD_SPACES>, BOARD_SPACES> index;
+    std::vector<std::pair<Square, Square>> pairs; // White King, Black King
+};
+
+KingPairs makeKingPairs(bool hasPawns) {
+    KingPairs result{};
+    for (auto &row : result.index) {
+        row.fill(-1);
+    }
+    for (Square wk = 0; wk < BOARD_SPACES; ++wk) {
+        Col wx = squareCol(wk);
+        Row wy = squareRow(wk);
+        bool isReduced = hasPawns ? wx < 4 : wx < 4 && wy <= wx;
+        if (!isReduced) {
+            continue;
+        }
+        for (Square bk = 0; bk < BOARD_SPACES; ++bk) {
+            if (bk == wk || (kingAttacks(wk) & squareBB(bk))) {
+                continue;
+            }
+            if (!hasPawns && wx == wy && squareRow(bk) > squareCol(bk)) {
+                continue;
+            }
+            result.index[wk][bk] = std::int16_t(result.pairs.size());
+            result.pairs.emplace_back(wk, bk);
+        }
+    }
+    return result;
+}
+
+const KingPairs &kingPairs(bool hasPawns) {
+    static const KingPairs withPawns = makeKingPairs(true);
+    static const KingPairs withoutPawns = makeKingPairs(false);
+    return hasPawns ? withPawns : withoutPawns;
+}
+
+// ---------- Block coding
+
+// A block: Its mode, the size of its palette (uint16), the palette, then
+// the values as palette indexes. BLOCK_PACKED: Bit-packed, with as many
+// bits per index as the palette needs. BLOCK_RUNS: (index, run length - 1)
+// pairs, as varints.
+constexpr std::uint8_t BLOCK_PACKED = 0;
+constexpr std::uint8_t BLOCK_RUNS = 1;
+
+Short bitWidth(std::size_t n) { // Bits to hold values in [0, n)
+    Short result = 0;
+    while ((std::size_t{1} << result) < n) {
+        ++result;
+    }
+    return result;
+}
+
+void putVarint(std::vector<std::uint8_t> &out, std::size_t n) {
+    for (; n >= 0x80; n >>= 7) {
+        out.push_back(std::uint8_t(n | 0x80));
+    }
+    out.push_back(std::uint8_t(n));
+}
+
+// Reads no further than end. Returns nothing if the varint does not end
+// before it, or does not fit.
+std::optional<std::size_t> getVarint(const std::uint8_t *&p,
+                                     const std::uint8_t *end)
+{
+    std::size_t result = 0;
+    for (Short shift = 0; p < end && shift < 64; shift += 7) {
+        std::uint8_t byte = *p++;
+        result |= std::size_t(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            return result;
+        }
+    }
+    return std::nullopt;
+}
+
+std::uint16_t getUint16(const std::uint8_t *p) {
+    std::uint16_t result;
+    std::memcpy(&result, p, sizeof result);
+    return result;
+}
+
+void encodeBlock(const TbValue *values, std::size_t count,
+                 std::vector<std::uint8_t> &out)
+{
+    // Broken positions are never probed: Let them continue the run before.
+    std::vector<TbValue> filled(values, values + count);
+    TbValue prev = TB_DRAW;
+    for (TbValue &v : filled) {
+        v = v == TB_BROKEN ? prev : v;
+        prev = v;
+    }
+    std::vector<TbValue> palette{filled};
+    std::sort(palette.begin(), palette.end());
+    palette.erase(std::unique(palette.begin(), palette.end()),
+                  palette.end());
+    std::vector<std::size_t> codes(count);
+    for (std::size_t k = 0; k < count; ++k) {
+        codes[k] = std::lower_bound(palette.begin(), palette.end(),
+                                    filled[k]) - palette.begin();
+    }
+
+    std::vector<std::uint8_t> runs;
+    for (std::size_t k = 0; k < count;) {
+        std::size_t end = k + 1;
+        while (end < count && codes[end] == codes[k]) {
+            ++end;
+        }
+        putVarint(runs, codes[k]);
+        putVarint(runs, end - k - 1);
+        k = end;
+    }
+    Short width = bitWidth(palette.size());
+    std::vector<std::uint8_t> packed((count * width + 7) / 8, 0);
+    for (std::size_t k = 0; k < count; ++k) {
+        for (Short bit = 0; bit < width; ++bit) {
+            std::size_t pos = k * width + bit;
+            packed[pos / 8] |= ((codes[k] >> bit) & 1) << (pos % 8);
+        }
+    }
+
+    bool isPacked = packed.size() <= runs.size();
+    out.push_back(isPacked ? BLOCK_PACKED : BLOCK_RUNS);
+    std::uint16_t paletteSize = palette.size();
+    const auto *sizeBytes =
+        reinterpret_cast<const std::uint8_t *>(&paletteSize);
+    out.insert(out.end(), sizeBytes, sizeBytes + sizeof paletteSize);
+    const auto *paletteBytes =
+        reinterpret_cast<const std::uint8_t *>(palette.data());
+    out.insert(out.end(), paletteBytes,
+               paletteBytes + palette.size() * sizeof(TbValue));
+    const std::vector<std::uint8_t> &codeBytes = isPacked ? packed : runs;
+    out.insert(out.end(), codeBytes.begin(), codeBytes.end());
+}
+
+// Value k of a block of size bytes. A corrupt block, which would have to be
+// read past its end, or which has a code outside its palette, gives
+// TB_BROKEN.
+TbValue decodeBlock(const std::uint8_t *block, std::size_t size,
+                    std::size_t k)
+{
+    constexpr std::size_t PALETTE_START = 3; // After the mode and its size
+    if (size < PALETTE_START) {
+        return TB_BROKEN;
+    }
+    std::uint8_t mode = block[0];
+    std::uint16_t paletteSize = getUint16(block + 1);
+    const std::uint8_t *palette = block + PALETTE_START;
+    std::size_t codesStart = PALETTE_START + paletteSize * sizeof(TbValue);
+    if (codesStart > size) {
+        return TB_BROKEN;
+    }
+    const std::uint8_t *p = block + codesStart;
+    const std::uint8_t *end = block + size;
+    std::size_t code = 0;
+    if (mode == BLOCK_PACKED) {
+        Short width = bitWidth(paletteSize);
+        std::size_t pos = k * width;
+        if (width > 0 && (pos + width + 7) / 8 > size - codesStart) {
+            return TB_BROKEN;
+        }
+        std::uint32_t bits = 0;
+        for (std::size_t b = 0; 8 * b < pos % 8 + width; ++b) {
+            bits |= std::uint32_t(p[pos / 8 + b]) << (8 * b);
+        }
+        code = (bits >> (pos % 8)) & ((1u << width) - 1);
+    } else if (mode == BLOCK_RUNS) {
+        for (std::size_t start = 0;;) {
+            std::optional<std::size_t> oCode = getVarint(p, end);
+            std::optional<std::size_t> oLength = getVarint(p, end);
+            if (!oCode || !oLength) {
+                return TB_BROKEN;
+            }
+            code = *oCode;
+            start += *oLength + 1;
+            if (k < start) {
+                break;
+            }
+        }
+    } else {
+        return TB_BROKEN;
+    }
+    if (code >= paletteSize) {
+        return TB_BROKEN;
+    }
+    return getUint16(palette + code * sizeof(TbValue));
+}
+
+} // namespace
+
+// ========================================
+// TbValue / TbResult
+
+TbResult toTbResult(TbValue v) {
+    if (isTbWin(v)) {
+        return TbResult{Wdl::Win, tbPlies(v)};
+    }
+    if (isTbLoss(v)) {
+        return TbResult{Wdl::Loss, tbPlies(v)};
+    }
+    return TbResult{Wdl::Draw, 0};
+}
+
+std::ostream &operator<<(std::ostream &os, const TbResult &result) {
+    switch (result.wdl) {
+    case Wdl::Win:  os << "win in " << result.dtm << " plies"; break;
+    case Wdl::Loss: os << "loss in " << result.dtm << " plies"; break;
+    default:        os << "draw"; break;
+    }
+    return os;
+}
+
+// ========================================
+// Material
+
+// ---------- Static methods
+std::optional<Material> Material::fromString(const string &name) {
+    string::size_type vIndex = name.find('v');
+    if (vIndex == string::npos) {
+        return std::nullopt;
+    }
+    Material result{};
+    for (Color c : allColors) {
+        string side = c == Color::White ? name.substr(0, vIndex)
+                                        : name.substr(vIndex + 1);
+        if (side.empty() || std::toupper(side[0]) != 'K') {
+            return std::nullopt;
+        }
+        for (std::size_t k = 1; k < side.size(); ++k) {
+            string::size_type ptIndex =
+                TB_PIECE_LETTERS.find(char(std::toupper(side[k])));
+            if (ptIndex == string::npos || ptIndex == 0) {
+                return std::nullopt;
+            }
+            result.add(c, PieceType(ptIndex));
+        }
+    }
+    return result;
+}
+
+Material Material::ofPosition(const Position &pos) {
+    Material result{};
+    for (Color c : allColors) {
+        for (Short pt = 1; pt < PIECE_TYPES_COUNT; ++pt) {
+            PieceType type = PieceType(pt);
+            result.add(c, type, popCount(pos.pieces(c, type)));
+        }
+    }
+    return result;
+}
+
+std::vector<Material> Material::all(Short pieceCount) {
+    // Multisets of non-King pieces of each size, by their PieceTypes
+    std::vector<std::vector<std::vector<PieceType>>> sets(pieceCount - 1);
+    sets[0].emplace_back();
+    for (Short size = 1; size + 1 < pieceCount; ++size) {
+        for (const std::vector<PieceType> &smaller : sets[size - 1]) {
+            Short first = smaller.empty() ? 1
+                                          : static_cast<Short>(smaller.back());
+            for (Short pt = first; pt < PIECE_TYPES_COUNT; ++pt) {
+                sets[size].push_back(smaller);
+                sets[size].back().push_back(PieceType(pt));
+            }
+        }
+    }
+    std::vector<Material> result;
+    for (Short whiteCount = 0; whiteCount + 2 <= pieceCount; ++whiteCount) {
+        Short blackCount = pieceCount - 2 - whiteCount;
+        for (const std::vector<PieceType> &white : sets[whiteCount]) {
+            for (const std::vector<PieceType> &black : sets[blackCount]) {
+                Material m{};
+                for (PieceType pt : white) {
+                    m.add(Color::White, pt);
+                }
+                for (PieceType pt : black) {
+                    m.add(Color::Black, pt);
+                }
+                if (m.isCanonical()) {
+                    result.push_back(m);
+                }
+            }
+        }
+    }
+    return result;
+}
+
+// ---------- Constructor
+Material::Material() : _counts{} {}
+
+// ---------- Read methods
+string Material::name() const {
+    string result;
+    for (Color c : allColors) {
+        result += c == Color::White ? "K" : "vK";
+        for (PieceType pt : pieces(c)) {
+            result += TB_PIECE_LETTERS[static_cast<Short>(pt)];
+        }
+    }
+    return result;
+}
+
+Short Material::pieceCount() const {
+    Short result = 2;
+    for (const auto &counts : _counts) {
+        for (Short count : counts) {
+            result += count;
+        }
+    }
+    return result;
+}
+
+bool Material::hasPawns() const {
+    return count(Color::White, PieceType::Pawn) > 0
+        || count(Color::Black, PieceType::Pawn) > 0;
+}
+
+bool Material::isCanonical() const {
+    return _counts[colorIndex(Color::White)]
+        >= _counts[colorIndex(Color::Black)];
+}
+
+Material Material::flipped() const {
+    Material result{*this};
+    std::swap(result._counts[0], result._counts[1]);
+    return result;
+}
+
+Material Material::canonical() const {
+    return isCanonical() ? *this : flipped();
+}
+
+std::vector<PieceType> Material::pieces(Color c) const {
+    std::vector<PieceType> result;
+    for (Short pt = 1; pt < PIECE_TYPES_COUNT; ++pt) {
+        result.insert(result.end(), count(c, PieceType(pt)), PieceType(pt));
+    }
+    return result;
+}
+
+std::vector<Material> Material::children() const {
+    std::vector<Material> result;
+    std::set<string> names;
+    auto addChild = [&](const Material &m) {
+        if (m.pieceCount() > 2 && names.insert(m.canonical().name()).second) {
+            result.push_back(m.canonical());
+        }
+    };
+    auto promote = [](Material m, Color c, PieceType pt) {
+        m.add(c, PieceType::Pawn, -1);
+        m.add(c, pt);
+        return m;
+    };
+    for (Color c : allColors) {
+        Color them = opponent(c);
+        for (Short pt = 1; pt < PIECE_TYPES_COUNT; ++pt) {
+            if (count(c, PieceType(pt)) == 0) {
+                continue;
+            }
+            Material captured{*this};
+            captured.add(c, PieceType(pt), -1);
+            addChild(captured);
+            // A capture on the last row can promote.
+            if (PieceType(pt) != PieceType::Pawn
+                && count(them, PieceType::Pawn) > 0)
+            {
+                for (PieceType promoted : PROMOTION_TYPES) {
+                    addChild(promote(captured, them, promoted));
+                }
+            }
+        }
+        if (count(c, PieceType::Pawn) > 0) {
+            for (PieceType promoted : PROMOTION_TYPES) {
+                addChild(promote(*this, c, promoted));
+            }
+        }
+    }
+    return result;
+}
+
+std::ostream &operator<<(std::ostream &os, const Material &m) {
+    os << m.name();
+    return os;
+}
+
+// ========================================
+// TbIndexer
+
+// ---------- Constructor
+TbIndexer::TbIndexer(const Material &m)
+    : _hasPawns{m.hasPawns()}, _pieceCount{m.pieceCount()}, _colors{},
+      _types{}, _size{kingPairs(m.hasPawns()).pairs.size()}
+{
+    _colors[0] = Color::White;
+    _colors[1] = Color::Black;
+    _types[0] = _types[1] = PieceType::King;
+    Short k = 2;
+    for (Color c : allColors) {
+        for (PieceType pt : m.pieces(c)) {
+            _colors[k] = c;
+            _types[k++] = pt;
+            _size *= pt == PieceType::Pawn ? BOARD_SPACES - 2 * BOARD_COLS
+                                           : BOARD_SPACES;
+        }
+    }
+}
+
+// ---------- Read methods
+std::size_t TbIndexer::sliceSize() const {
+    return _size / kingPairs(_hasPawns).pairs.size();
+}
+
+std::size_t TbIndexer::index(const TbSquares &squares) const {
+    const KingPairs &kk = kingPairs(_hasPawns);
+    Short transforms = _hasPawns ? 2 : 8;
+    // With both Kings on the diagonal, a transposed board also fits.
+    std::size_t result = _size;
+    for (Short t = 0; t < transforms; ++t) {
+        std::int16_t kkIndex = kk.index[transformSquare(squares[0], t)]
+                                       [transformSquare(squares[1], t)];
+        if (kkIndex < 0) {
+            continue;
+        }
+        std::size_t index = kkIndex;
+        for (Short k = 2; k < _pieceCount; ++k) {
+            Square sq = transformSquare(squares[k], t);
+            index = _types[k] == PieceType::Pawn
+                ? index * (BOARD_SPACES - 2 * BOARD_COLS) + sq - BOARD_COLS
+                : index * BOARD_SPACES + sq;
+        }
+        result = std::min(result, index);
+    }
+    return result < _size ? result : 0; // 0: Adjacent Kings
+}
+
+bool TbIndexer::decode(std::size_t index, TbSquares &squares) const {
+    Bitboard occupied = 0;
+    bool isOverlapping = false;
+    for (Short k = _pieceCount - 1; k >= 2; --k) {
+        if (_types[k] == PieceType::Pawn) {
+            squares[k] = index % (BOARD_SPACES - 2 * BOARD_COLS) + BOARD_COLS;
+            index /= BOARD_SPACES - 2 * BOARD_COLS;
+        } else {
+            squares[k] = index % BOARD_SPACES;
+            index /= BOARD_SPACES;
+        }
+        isOverlapping |= (occupied & squareBB(squares[k])) != 0;
+        occupied |= squareBB(squares[k]);
+    }
+    const std::pair<Square, Square> &kings =
+        kingPairs(_hasPawns).pairs[index];
+    squares[0] = kings.first;
+    squares[1] = kings.second;
+    return !isOverlapping
+        && !(occupied & (squareBB(kings.first) | squareBB(kings.second)));
+}
+
+TbSquares TbIndexer::squaresOf(const Position &pos,
+                               bool isFlipped /* =false */) const
+{
+    TbSquares result{};
+    std::array<std::array<Bitboard, PIECE_TYPES_COUNT>, COLORS_COUNT> left;
+    for (Color c : allColors) {
+        for (Short pt = 0; pt < PIECE_TYPES_COUNT; ++pt) {
+            left[colorIndex(c)][pt] =
+                pos.pieces(isFlipped ? opponent(c) : c, PieceType(pt));
+        }
+    }
+    for (Short k = 0; k < _pieceCount; ++k) {
+        Bitboard &bb =
+            left[colorIndex(_colors[k])][static_cast<Short>(_types[k])];
+        Square sq = popLsb(bb);
+        result[k] = isFlipped ? sq ^ (BOARD_SPACES - BOARD_COLS) : sq;
+    }
+    return result;
+}
+
+Position TbIndexer::toPosition(const TbSquares &squares,
+                               Color sideToMove) const
+{
+    Position result{};
+    for (Short k = 0; k < _pieceCount; ++k) {
+        result.addPiece(_colors[k], _types[k], squares[k]);
+    }
+    result.setSideToMove(sideToMove);
+    return result;
+}
+
+// ========================================
+// MappedFile
+
+std::unique_ptr<MappedFile> MappedFile::open(const string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    void *data = MAP_FAILED;
+    if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+        data = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd); // The mapping stays
+    if (data == MAP_FAILED) {
+        return nullptr;
+    }
+    return std::unique_ptr<MappedFile>{
+        new MappedFile{static_cast<const std::uint8_t *>(data),
+                       std::size_t(st.st_size)}};
+}
+
+MappedFile::MappedFile(const std::uint8_t *data, std::size_t size)
+    : _data{data}, _size{size}
+{}
+
+MappedFile::~MappedFile() {
+    ::munmap(const_cast<std::uint8_t *>(_data), _size);
+}
+
+// ========================================
+// Tablebase
+
+// ---------- Static methods
+std::optional<Tablebase> Tablebase::load(const string &path) {
+    std::unique_ptr<MappedFile> fileP = MappedFile::open(path);
+    // Magic, then version, name length and values per block
+    constexpr std::size_t FIXED_HEADER = sizeof TB_MAGIC + 3 * 4;
+    if (!fileP || fileP->size() < FIXED_HEADER
+        || std::memcmp(fileP->data(), TB_MAGIC, sizeof TB_MAGIC) != 0)
+    {
+        return std::nullopt;
+    }
+    std::uint32_t header[3];
+    std::memcpy(header, fileP->data() + sizeof TB_MAGIC, sizeof header);
+    if (header[0] != TB_VERSION || header[1] > 2 * TB_MAX_PIECES
+        || header[2] != TB_BLOCK_VALUES
+        || fileP->size() < FIXED_HEADER + header[1])
+    {
+        return std::nullopt;
+    }
+    string name(reinterpret_cast<const char *>(fileP->data()) + FIXED_HEADER,
+                header[1]);
+    std::optional<Material> oMaterial = Material::fromString(name);
+    if (!oMaterial || !oMaterial->isCanonical()
+        || oMaterial->pieceCount() > TB_MAX_PIECES)
+    {
+        return std::nullopt;
+    }
+
+    Tablebase result{*oMaterial, std::move(fileP)};
+    const MappedFile &file = *result._fileP;
+    std::size_t offsetsStart = (FIXED_HEADER + header[1] + 7) / 8 * 8;
+    std::size_t blockCount =
+        (result._indexer.size() + TB_BLOCK_VALUES - 1) / TB_BLOCK_VALUES;
+    std::size_t blocksStart =
+        offsetsStart + COLORS_COUNT * (blockCount + 1) * sizeof(std::uint64_t);
+    if (file.size() < blocksStart) {
+        return std::nullopt;
+    }
+    // Each block lies after the one before, and within the file.
+    for (Short side = 0; side < COLORS_COUNT; ++side) {
+        const std::uint64_t *offsets = reinterpret_cast<const std::uint64_t *>(
+            file.data() + offsetsStart
+            + side * (blockCount + 1) * sizeof(std::uint64_t));
+        if (offsets[blockCount] > file.size() - blocksStart) {
+            return std::nullopt;
+        }
+        for (std::size_t b = 0; b < blockCount; ++b) {
+            if (offsets[b] > offsets[b + 1]) {
+                return std::nullopt;
+            }
+        }
+        result._offsets[side] = offsets;
+    }
+    result._blocks = file.data() + blocksStart;
+    return result;
+}
+
+// ---------- Constructors
+Tablebase::Tablebase(const Material &m)
+    : _material{m}, _indexer{m}, _values{}, _fileP{}, _offsets{},
+      _blocks{nullptr}
+{
+    for (std::vector<TbValue> &values : _values) {
+        values.assign(_indexer.size(), TB_DRAW);
+    }
+}
+
+Tablebase::Tablebase(const Material &m, std::unique_ptr<MappedFile> fileP)
+    : _material{m}, _indexer{m}, _values{}, _fileP{std::move(fileP)},
+      _offsets{}, _blocks{nullptr}
+{}
+
+// ---------- Read methods
+TbValue Tablebase::value(Color sideToMove, std::size_t index) const {
+    Short side = colorIndex(sideToMove);
+    if (!_fileP) {
+        return _values[side][index];
+    }
+    const std::uint64_t *offsets = _offsets[side];
+    std::size_t block = index / TB_BLOCK_VALUES;
+    return decodeBlock(_blocks + offsets[block],
+                       offsets[block + 1] - offsets[block],
+                       index % TB_BLOCK_VALUES);
+}
+
+TbValue Tablebase::probe(const Position &pos) const {
+    bool isFlipped = !(Material::ofPosition(pos) == _material);
+    TbSquares squares = _indexer.squaresOf(pos, isFlipped);
+    Color sideToMove =
+        isFlipped ? opponent(pos.sideToMove()) : pos.sideToMove();
+    return value(sideToMove, _indexer.index(squares));
+}
+
+bool Tablebase::save(const string &path) const {
+    if (_fileP) {
+        return false;
+    }
+    return _save(path, _material, {_values[0].data(), _values[1].data()});
+}
+
+// ---------- Private static methods
+bool Tablebase::_save(const string &path, const Material &m,
+                      const std::array<const TbValue *, COLORS_COUNT> &values)
+{
+    std::size_t size = TbIndexer{m}.size();
+    std::size_t blockCount = (size + TB_BLOCK_VALUES - 1) / TB_BLOCK_VALUES;
+    std::ofstream os{path, std::ios::binary};
+    string name = m.name();
+    std::uint32_t header[3] = {TB_VERSION, std::uint32_t(name.size()),
+                               std::uint32_t(TB_BLOCK_VALUES)};
+    os.write(TB_MAGIC, sizeof TB_MAGIC);
+    os.write(reinterpret_cast<const char *>(header), sizeof header);
+    os.write(name.data(), name.size());
+    std::size_t headerSize = sizeof TB_MAGIC + sizeof header + name.size();
+    const char padding[8] = {};
+    os.write(padding, (8 - headerSize % 8) % 8); // Align the offsets
+
+    // The blocks are streamed after room for the offsets, which are then
+    // filled in: A table need not fit in memory, compressed or not.
+    std::streampos offsetsStart = os.tellp();
+    std::vector<std::uint64_t> offsets(COLORS_COUNT * (blockCount + 1), 0);
+    os.write(reinterpret_cast<const char *>(offsets.data()),
+             offsets.size() * sizeof(std::uint64_t));
+    std::uint64_t blocksSize = 0;
+    std::vector<std::uint8_t> block;
+    for (Short side = 0; side < COLORS_COUNT; ++side) {
+        for (std::size_t b = 0; b < blockCount; ++b) {
+            offsets[side * (blockCount + 1) + b] = blocksSize;
+            std::size_t start = b * TB_BLOCK_VALUES;
+            block.clear();
+            encodeBlock(values[side] + start,
+                        std::min(TB_BLOCK_VALUES, size - start), block);
+            os.write(reinterpret_cast<const char *>(block.data()),
+                     block.size());
+            blocksSize += block.size();
+        }
+        offsets[side * (blockCount + 1) + blockCount] = blocksSize;
+    }
+    os.seekp(offsetsStart);
+    os.write(reinterpret_cast<const char *>(offsets.data()),
+             offsets.size() * sizeof(std::uint64_t));
+    return bool(os);
+}
+
+// ========================================
+// Tablebases
+
+std::unique_ptr<Tablebases> Tablebases::_activeP{};
+
+// ---------- Static methods
+string Tablebases::path(const string &dir, const Material &m) {
+    return dir + "/" + m.canonical().name() + ".tb";
+}
+
+bool Tablebases::load(const string &dir) {
+    std::unique_ptr<Tablebases> tablesP = std::make_unique<Tablebases>(dir);
+    if (tablesP->size() == 0) {
+        return false;
+    }
+    setActive(std::move(tablesP));
+    return true;
+}
+
+void Tablebases::setActive(std::unique_ptr<Tablebases> tablesP) {
+    _activeP = std::move(tablesP);
+}
+
+// ---------- Constructor
+Tablebases::Tablebases(const string &dir)
+    : _dir{dir}, _mutex{}, _tables{}, _maxPieces{0}
+{
+    std::error_code ec;
+    if (dir.empty() || !std::filesystem::is_directory(dir, ec)) {
+        return;
+    }
+    for (const auto &entry : std::filesystem::directory_iterator{dir, ec}) {
+        if (entry.path().extension() != ".tb") {
+            continue;
+        }
+        if (std::optional<Tablebase> oTable =
+                Tablebase::load(entry.path().string())) {
+            add(std::move(*oTable));
+        }
+    }
+}
+
+// ---------- Read methods
+std::size_t Tablebases::size() const {
+    std::shared_lock<std::shared_mutex> lock{_mutex};
+    return _tables.size();
+}
+
+Short Tablebases::maxPieces() const {
+    std::shared_lock<std::shared_mutex> lock{_mutex};
+    return _maxPieces;
+}
+
+const Tablebase *Tablebases::find(const Material &m) const {
+    std::shared_lock<std::shared_mutex> lock{_mutex};
+    auto iter = _tables.find(m.canonical().name());
+    return iter == _tables.end() ? nullptr : iter->second.get();
+}
+
+std::optional<TbValue> Tablebases::probe(const Position &pos) const {
+    if (pos.castlingRights() != 0) {
+        return std::nullopt;
+    }
+    if (pos.enPassantSquare() == NO_SQUARE) {
+        return _probeTable(pos);
+    }
+    // The table assumes no en passant right: Try the captures separately.
+    FastMoves moves{};
+    pos.legalMoves(moves);
+    std::optional<TbValue> best{};
+    bool hasOtherMoves = false;
+    for (const FastMove &move : moves) {
+        bool isEnPassant = move.to() == pos.enPassantSquare()
+            && pos.pieceTypeAt(move.from()) == PieceType::Pawn;
+        if (!isEnPassant) {
+            hasOtherMoves = true;
+            continue;
+        }
+        Position child{pos};
+        PositionUndo undo;
+        child.makeMove(move, undo);
+        std::optional<TbValue> oChild = _probeTable(child);
+        if (!oChild || *oChild == TB_BROKEN) {
+            return std::nullopt;
+        }
+        TbValue v = tbParent(*oChild);
+        if (!best || tbRank(v) > tbRank(*best)) {
+            best = v;
+        }
+    }
+    if (best && hasOtherMoves) {
+        std::optional<TbValue> oOthers = _probeTable(pos);
+        if (!oOthers || *oOthers == TB_BROKEN) {
+            return oOthers;
+        }
+        return tbRank(*oOthers) > tbRank(*best) ? *oOthers : *best;
+    }
+    return best ? best : _probeTable(pos);
+}
+
+// ---------- Write methods
+const Tablebase &Tablebases::add(Tablebase &&tb) {
+    std::unique_lock<std::shared_mutex> lock{_mutex};
+    std::unique_ptr<Tablebase> &tableP = _tables[tb.material().name()];
+    if (!tableP) {
+        tableP = std::make_unique<Tablebase>(std::move(tb));
+        _maxPieces = std::max(_maxPieces, tableP->material().pieceCount());
+    }
+    return *tableP;
+}
+
+// ---------- Private read methods
+std::optional<TbValue> Tablebases::_probeTable(const Position &pos) const {
+    Material m = Material::ofPosition(pos);
+    if (m.pieceCount() == 2) {
+        return TB_DRAW;
+    }
+    const Tablebase *tableP = find(m);
+    if (!tableP) {
+        return std::nullopt;
+    }
+    return tableP->probe(pos);
+}
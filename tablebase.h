@@ -0,0 +1,295 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include "bitboard.h"
+#include "piece.h"
+#include "position.h"
+#include "util.h"
+
+constexpr Short TB_MAX_PIECES = 6; // Incl. Kings
+
+// ========================================
+// TbValue / TbResult
+
+// The value of a position for its side to move, in 16 bits: 0 for a draw,
+// an odd number n for a win in n plies, and an even number n + 2 for a loss
+// in n plies (n = 0: checkmated). The winner is always an odd number of
+// plies from mate, so wins and losses do not collide.
+using TbValue = std::uint16_t;
+constexpr TbValue TB_DRAW = 0;
+constexpr TbValue TB_BROKEN = 0xffff; // Not a legal position
+
+constexpr TbValue tbWin(Short plies) { return TbValue(plies); }
+constexpr TbValue tbLoss(Short plies) { return TbValue(plies + 2); }
+constexpr bool isTbWin(TbValue v) { return v % 2 == 1 && v != TB_BROKEN; }
+constexpr bool isTbLoss(TbValue v) { return v != TB_DRAW && v % 2 == 0; }
+// Plies to mate, for wins and losses.
+constexpr Short tbPlies(TbValue v) { return isTbWin(v) ? v : v - 2; }
+// The value of a position whose move leads to a position of value v.
+constexpr TbValue tbParent(TbValue v) {
+    return isTbLoss(v) ? tbWin(tbPlies(v) + 1)
+        : isTbWin(v)   ? tbLoss(tbPlies(v) + 1)
+                       : TB_DRAW;
+}
+// Orders values for the side to move: Faster wins rank higher, and slower
+// losses rank higher than faster ones.
+constexpr int tbRank(TbValue v) {
+    return isTbWin(v) ? 0x10000 - v : isTbLoss(v) ? v - 0x10000 : 0;
+}
+
+enum class Wdl { Loss = -1, Draw = 0, Win = 1 };
+
+struct TbResult {
+    Wdl wdl;
+    Short dtm; // Plies to mate, for wins and losses
+};
+
+TbResult toTbResult(TbValue v); // For legal positions
+std::ostream &operator<<(std::ostream &os, const TbResult &result);
+
+// ========================================
+// Material
+
+// The pieces of each side, e.g., "KRPvKR". Tables are built for canonical
+// Materials, where White is the stronger side (see isCanonical); positions
+// with the colors the other way round are probed with them swapped.
+class Material {
+  public:
+    // ---------- Static methods
+    static std::optional<Material> fromString(const std::string &name);
+    static Material ofPosition(const Position &pos);
+    // The canonical Materials with the given number of pieces.
+    static std::vector<Material> all(Short pieceCount);
+
+    // ---------- Constructor
+    Material(); // Bare Kings
+
+    // ---------- Read methods
+    std::string name() const;
+    Short count(Color c, PieceType pt) const {
+        return _counts[colorIndex(c)][static_cast<Short>(pt)];
+    }
+    Short pieceCount() const; // Incl. Kings
+    bool hasPawns() const;
+    // White's pieces, strongest first, compare at least as high as Black's.
+    bool isCanonical() const;
+    Material flipped() const; // Colors swapped
+    Material canonical() const;
+    // Non-King pieces of Color c, strongest first.
+    std::vector<PieceType> pieces(Color c) const;
+    // The canonical Materials that one capture and/or promotion leads to,
+    // except bare Kings.
+    std::vector<Material> children() const;
+
+    bool operator==(const Material &other) const {
+        return _counts == other._counts;
+    }
+
+    // ---------- Write methods
+    void add(Color c, PieceType pt, Short delta = 1) {
+        _counts[colorIndex(c)][static_cast<Short>(pt)] += delta;
+    }
+
+  private:
+    std::array<std::array<Short, PIECE_TYPES_COUNT>, COLORS_COUNT> _counts;
+};
+
+std::ostream &operator<<(std::ostream &os, const Material &m);
+
+// ========================================
+// TbIndexer
+
+// Squares of the pieces of a Material, in table order: White King, Black
+// King, White's other pieces strongest first, then Black's.
+using TbSquares = std::array<Square, TB_MAX_PIECES>;
+
+// Maps the positions of a canonical Material, for one side to move, to
+// [0, size()). Positions are reduced by symmetry: With Pawns, by mirroring
+// files so that the White King is on files a-d; without, by the 8
+// symmetries of the board, so that it is in the a1-d1-d4 triangle (and the
+// Black King is on or below the a1-h8 diagonal if the White King is on it).
+// The two Kings share an index over their legal placements, and each other
+// piece has its own over the board (Pawns: ranks 2-7). A position takes the
+// smallest index of its symmetric images, so some indexes are not used:
+// Those that decode to overlapping pieces, or to a position with a smaller
+// index.
+class TbIndexer {
+  public:
+    // ---------- Constructor
+    explicit TbIndexer(const Material &m);
+
+    // ---------- Read methods
+    std::size_t size() const { return _size; }
+    // Indexes per placement of the Kings. Those of each placement are
+    // contiguous, ordered by the White King's square, then the Black's.
+    std::size_t sliceSize() const;
+    Short pieceCount() const { return _pieceCount; }
+    Color pieceColor(Short k) const { return _colors[k]; }
+    PieceType pieceType(Short k) const { return _types[k]; }
+    std::size_t index(const TbSquares &squares) const;
+    // False if pieces overlap. (See also index.)
+    bool decode(std::size_t index, TbSquares &squares) const;
+    // For a position with this Material, or (isFlipped) with the colors
+    // swapped, in which case the board is mirrored top to bottom.
+    TbSquares squaresOf(const Position &pos, bool isFlipped = false) const;
+    Position toPosition(const TbSquares &squares, Color sideToMove) const;
+
+  private:
+    bool _hasPawns;
+    Short _pieceCount;
+    std::array<Color, TB_MAX_PIECES> _colors;
+    std::array<PieceType, TB_MAX_PIECES> _types;
+    std::size_t _size;
+};
+
+// ========================================
+// MappedFile
+
+// A whole file, mapped read-only into memory. Its pages are shared with
+// other processes that map it, through the page cache.
+class MappedFile {
+  public:
+    // nullptr if the file cannot be opened or mapped.
+    static std::unique_ptr<MappedFile> open(const std::string &path);
+
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const std::uint8_t *data() const { return _data; }
+    std::size_t size() const { return _size; }
+
+  private:
+    MappedFile(const std::uint8_t *data, std::size_t size);
+
+    const std::uint8_t *_data;
+    std::size_t _size;
+};
+
+// ========================================
+// Tablebase
+
+constexpr std::size_t TB_BLOCK_VALUES = 4096; // Per compressed block
+
+// The TbValues of all positions of one canonical Material, for each side to
+// move. A table is either in memory (e.g., as built by TbGenerator), or a
+// file mapped with MappedFile, <name>.tb: A header, then per side to move
+// (Black, White) the offsets of its blocks, then the blocks. Each block
+// holds TB_BLOCK_VALUES values, as indexes into a palette of the values it
+// uses, either bit-packed or run-length coded, whichever is smaller.
+// Probing a mapped table reads one block, and no shared state, so any
+// number of threads can probe at once. Unused indexes (see TbIndexer) hold
+// arbitrary values in a file, to keep blocks small.
+class Tablebase {
+  public:
+    // ---------- Static methods
+    static std::optional<Tablebase> load(const std::string &path);
+
+    // ---------- Constructor
+    explicit Tablebase(const Material &m); // In memory, all draws
+
+    // ---------- Read methods
+    const Material &material() const { return _material; }
+    const TbIndexer &indexer() const { return _indexer; }
+    bool isMapped() const { return _fileP != nullptr; }
+    std::size_t fileSize() const { return _fileP ? _fileP->size() : 0; }
+    TbValue value(Color sideToMove, std::size_t index) const;
+    // For a position with this Material, either way round. Castling and en
+    // passant rights are ignored.
+    TbValue probe(const Position &pos) const;
+    bool save(const std::string &path) const; // For tables in memory
+
+  private:
+    friend class TbGenerator;
+
+    // Writes a table whose values per side are given (e.g., mapped from
+    // scratch files), one block at a time.
+    static bool _save(const std::string &path, const Material &m,
+                      const std::array<const TbValue *, COLORS_COUNT> &values);
+
+    Tablebase(const Material &m, std::unique_ptr<MappedFile> fileP);
+
+    Material _material;
+    TbIndexer _indexer;
+    std::array<std::vector<TbValue>, COLORS_COUNT> _values; // In memory
+    std::unique_ptr<MappedFile> _fileP;
+    // Mapped: Per side, the offsets of its blocks into _blocks, plus one
+    std::array<const std::uint64_t *, COLORS_COUNT> _offsets;
+    const std::uint8_t *_blocks;
+};
+
+// ========================================
+// Tablebases
+
+// The tables in a directory, all mapped up front, plus any added later
+// (e.g., just generated). With an empty directory name, only the latter.
+// Thread-safe. The active Tablebases, if any, are shared by search, by
+// GameState (to adjudicate endings) and by probe_tb.
+class Tablebases {
+  public:
+    // ---------- Static methods
+    static std::string path(const std::string &dir, const Material &m);
+    static const Tablebases *active() { return _activeP.get(); }
+    // Map the tables in a directory, and make them active. Returns false if
+    // it has none.
+    static bool load(const std::string &dir);
+    static void setActive(std::unique_ptr<Tablebases> tablesP);
+
+    // ---------- Constructor
+    explicit Tablebases(const std::string &dir);
+
+    // ---------- Read methods
+    const std::string &dir() const { return _dir; }
+    std::size_t size() const; // Tables
+    Short maxPieces() const; // Of the largest table, or 0 if none
+    // The table of a Material, either way round, or nullptr if there is
+    // none. It stays valid as long as the Tablebases.
+    const Tablebase *find(const Material &m) const;
+    // The value of a position without castling rights, or nothing if there
+    // is no table for it. Bare Kings are a draw. An en passant capture, if
+    // legal, is tried as well.
+    std::optional<TbValue> probe(const Position &pos) const;
+
+    // ---------- Write methods
+    // Tables are never replaced (probes may be using them): If there is one
+    // with its Material already, that one is kept and returned.
+    const Tablebase &add(Tablebase &&tb);
+
+  private:
+    static std::unique_ptr<Tablebases> _activeP;
+
+    std::optional<TbValue> _probeTable(const Position &pos) const;
+
+    std::string _dir;
+    mutable std::shared_mutex _mutex; // Readers probe; add writes
+    // By canonical Material name
+    std::map<std::string, std::unique_ptr<Tablebase>> _tables;
+    Short _maxPieces;
+};
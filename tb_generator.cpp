@@ -0,0 +1,761 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "tb_generator.h"
+
+using std::string;
+
+namespace {
+
+// ========================================
+// AtomicBitset
+
+// One bit per position, set and cleared by workers with atomic operations.
+// The words are not owned: They are in memory, or in a ScratchFile.
+class AtomicBitset {
+  public:
+    AtomicBitset(std::uint64_t *words, std::size_t wordCount)
+        : _words{words}, _wordCount{wordCount} {}
+
+    std::size_t wordCount() const { return _wordCount; }
+    std::uint64_t word(std::size_t w) const {
+        return __atomic_load_n(&_words[w], __ATOMIC_RELAXED);
+    }
+    bool test(std::size_t i) const { return (word(i / 64) >> (i % 64)) & 1; }
+
+    void set(std::size_t i) {
+        __atomic_fetch_or(&_words[i / 64], std::uint64_t{1} << (i % 64),
+                          __ATOMIC_RELAXED);
+    }
+    void reset(std::size_t i) {
+        __atomic_fetch_and(&_words[i / 64], ~(std::uint64_t{1} << (i % 64)),
+                           __ATOMIC_RELAXED);
+    }
+    void clear() { std::fill(_words, _words + _wordCount, 0); }
+    void clear(std::size_t w) {
+        __atomic_store_n(&_words[w], 0, __ATOMIC_RELAXED);
+    }
+    void swap(AtomicBitset &other) { std::swap(_words, other._words); }
+
+  private:
+    std::uint64_t *_words;
+    std::size_t _wordCount;
+};
+
+// ========================================
+// ScratchFile
+
+// A file mapped for reading and writing. Changes reach the file as the OS
+// writes the pages back, and at the latest on sync. Pages that are not in
+// use can be dropped from memory, so the file can be larger than it.
+class ScratchFile {
+  public:
+    ScratchFile() : _data{nullptr}, _size{0} {}
+    ~ScratchFile() {
+        if (_data) {
+            ::munmap(_data, _size);
+        }
+    }
+    ScratchFile(const ScratchFile &) = delete;
+    ScratchFile &operator=(const ScratchFile &) = delete;
+
+    // Opens or creates the file, sized to size bytes (new bytes are 0).
+    bool map(const string &path, std::size_t size);
+    template <typename T> T *data() const { return static_cast<T *>(_data); }
+    bool sync() const { return ::msync(_data, _size, MS_SYNC) == 0; }
+
+  private:
+    void *_data;
+    std::size_t _size;
+};
+
+bool ScratchFile::map(const string &path, std::size_t size) {
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    void *data = MAP_FAILED;
+    if (::ftruncate(fd, size) == 0) {
+        data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                      0);
+    }
+    ::close(fd); // The mapping stays
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    _data = data;
+    _size = size;
+    return true;
+}
+
+// ========================================
+// Checkpoint
+
+// How far an out-of-core build has got: Its scratch files hold the first
+// initialized positions, then the passes after them.
+struct Checkpoint {
+    std::size_t initialized = 0; // Words of the flags, per side
+    Short passes = 0;
+    Short maxConversionPlies = 0; // So far
+};
+
+// Nothing if there is no checkpoint, or it is for another table.
+std::optional<Checkpoint> readCheckpoint(const string &path,
+                                         const Material &m, std::size_t size)
+{
+    std::ifstream is{path};
+    string name;
+    std::size_t fileSize = 0;
+    Checkpoint result{};
+    if (!(is >> name >> fileSize >> result.initialized >> result.passes
+          >> result.maxConversionPlies)
+        || name != m.name() || fileSize != size)
+    {
+        return std::nullopt;
+    }
+    return result;
+}
+
+// Replaces the checkpoint file whole, so that it is never half written.
+bool writeCheckpoint(const string &path, const Material &m, std::size_t size,
+                     const Checkpoint &checkpoint)
+{
+    string tempPath = path + ".tmp";
+    {
+        std::ofstream os{tempPath};
+        os << m.name() << " " << size << " " << checkpoint.initialized << " "
+           << checkpoint.passes << " " << checkpoint.maxConversionPlies
+           << "\n";
+        if (!os.flush()) {
+            return false;
+        }
+    }
+    return std::rename(tempPath.c_str(), path.c_str()) == 0;
+}
+
+// The squares a Pawn of Color c on sq can have come from without capturing.
+Bitboard pawnUnmoves(Color c, Square sq, Bitboard occupied) {
+    Short dy = c == Color::White ? -BOARD_COLS : BOARD_COLS;
+    Row startRow = c == Color::White ? 1 : BOARD_ROWS - 2;
+    Square from = sq + dy;
+    if (squareRow(from) < 1 || squareRow(from) > BOARD_ROWS - 2
+        || (occupied & squareBB(from)))
+    {
+        return 0;
+    }
+    Square doubleFrom = from + dy;
+    bool isDoublePush = squareRow(doubleFrom) == startRow
+        && !(occupied & squareBB(doubleFrom));
+    return squareBB(from) | (isDoublePush ? squareBB(doubleFrom) : 0);
+}
+
+// ========================================
+// Retrograde
+
+using TbValues = std::array<TbValue *, COLORS_COUNT>;
+
+// The state of one table under construction (see TbGenerator). Until a
+// position is resolved, its value holds the best result of the moves that
+// leave the table, or tbLoss(0) if there are none. The values and the flags
+// are kept by the caller, in memory or in ScratchFiles. Each step walks
+// them a window of words at a time, in order.
+class Retrograde {
+  public:
+    // Called after each window of initialize, and after each pass of
+    // resolveAll. Returning false stops them.
+    using Progress = std::function<bool()>;
+
+    static constexpr Short FLAG_KINDS = 6; // See Flags
+    // Words of flags for a table of size positions, per side.
+    static std::size_t flagWords(std::size_t size) { return (size + 63) / 64; }
+
+    Retrograde(ThreadPool &pool, const TbIndexer &indexer,
+               const TbValues &values,
+               const std::map<string, const Tablebase *> &children,
+               std::uint64_t *flags, std::size_t windowWords);
+
+    std::size_t initialized() const { return _initialized; } // Words
+    // The slowest mate found outside the table so far
+    Short maxConversionPlies() const { return _maxConversionPlies; }
+    // Initializes the positions from word initialized on. The first call
+    // of a build resumed after a checkpoint restores it, after which the
+    // flags of the passes are rebuilt from the values. Returns false if
+    // stopped.
+    bool initialize(const Checkpoint &from, const Progress &progress);
+    // Passes from from.passes + 1, until one resolves no position and no
+    // conversion is due later. Returns false if stopped.
+    bool resolveAll(const Checkpoint &from, TbGenStats &stats,
+                    const Progress &progress);
+    void finish(TbGenStats &stats);
+
+  private:
+    struct Flags {
+        Flags(std::uint64_t *flags, std::size_t words)
+            : resolved{flags, words}, frontier{flags + words, words},
+              next{flags + 2 * words, words},
+              winCandidates{flags + 3 * words, words},
+              lossCandidates{flags + 4 * words, words},
+              conversions{flags + 5 * words, words} {}
+
+        AtomicBitset resolved;
+        AtomicBitset frontier; // Resolved in the previous pass
+        AtomicBitset next;     // Resolved in this pass
+        AtomicBitset winCandidates;  // Can move to a position just lost
+        AtomicBitset lossCandidates; // Can move to a position just won
+        AtomicBitset conversions; // Won or lost outside the table, so far
+    };
+
+    TbValue _load(Short side, std::size_t i) const {
+        return __atomic_load_n(&_values[side][i], __ATOMIC_RELAXED);
+    }
+    void _store(Short side, std::size_t i, TbValue v) {
+        __atomic_store_n(&_values[side][i], v, __ATOMIC_RELAXED);
+    }
+    long long _resolvePass(Short plies); // Returns the positions resolved
+    long long _restore(Short passes); // The frontier after them
+    TbValue _conversionValue(const Position &child) const;
+    void _initialize(Color c, std::size_t i, Short &maxPlies);
+    void _addPredecessors(Color c, std::size_t i);
+    void _resolve(Color c, std::size_t i, Short plies);
+    bool _isLost(Color c, std::size_t i) const;
+    // Calls f(side, w, worker) for words [first, end) of both sides, a
+    // window at a time.
+    template <typename F>
+    void _forEachWord(std::size_t first, std::size_t end, F &&f);
+    // Calls f(side, i, worker) for each set bit of a bitset chosen per side.
+    template <typename Bits, typename F>
+    void _forEachBit(Bits bits, F &&f);
+
+    ThreadPool &_pool;
+    const TbIndexer &_indexer;
+    TbValues _values;
+    const std::map<string, const Tablebase *> &_children;
+    std::size_t _words; // Per side
+    std::size_t _windowWords;
+    std::array<Flags, COLORS_COUNT> _flags;
+    std::size_t _initialized;
+    Short _maxConversionPlies;
+};
+
+Retrograde::Retrograde(ThreadPool &pool, const TbIndexer &indexer,
+                       const TbValues &values,
+                       const std::map<string, const Tablebase *> &children,
+                       std::uint64_t *flags, std::size_t windowWords)
+    : _pool{pool}, _indexer{indexer}, _values{values}, _children{children},
+      _words{flagWords(indexer.size())},
+      _windowWords{std::max(windowWords, std::size_t{1})},
+      _flags{Flags{flags, _words},
+             Flags{flags + FLAG_KINDS * _words, _words}},
+      _initialized{0}, _maxConversionPlies{0}
+{}
+
+template <typename F>
+void Retrograde::_forEachWord(std::size_t first, std::size_t end, F &&f) {
+    constexpr std::size_t GRAIN = 16; // Words
+    for (std::size_t start = first; start < end; start += _windowWords) {
+        std::size_t count = std::min(_windowWords, end - start);
+        _pool.parallelFor(COLORS_COUNT * count,
+                          [&](std::size_t k, Short worker) {
+            f(Short(k / count), start + k % count, worker);
+        }, GRAIN);
+    }
+}
+
+template <typename Bits, typename F>
+void Retrograde::_forEachBit(Bits bits, F &&f) {
+    _forEachWord(0, _words, [&](Short side, std::size_t w, Short worker) {
+        std::uint64_t word = bits(_flags[side], w);
+        while (word) {
+            std::size_t i = 64 * w + popLsb(word);
+            f(side, i, worker);
+        }
+    });
+}
+
+bool Retrograde::initialize(const Checkpoint &from,
+                            const Progress &progress)
+{
+    _initialized = std::max(_initialized, from.initialized);
+    _maxConversionPlies =
+        std::max(_maxConversionPlies, from.maxConversionPlies);
+    while (_initialized < _words) {
+        std::size_t end = std::min(_initialized + _windowWords, _words);
+        std::vector<Short> maxPlies(_pool.size(), 0);
+        // Positions of one word at a time: Flag words are not shared.
+        _forEachWord(_initialized, end,
+                     [&](Short side, std::size_t w, Short worker) {
+            std::size_t last = std::min(64 * w + 64, _indexer.size());
+            for (std::size_t i = 64 * w; i < last; ++i) {
+                _initialize(Color(side), i, maxPlies[worker]);
+            }
+        });
+        _initialized = end;
+        _maxConversionPlies = std::max(
+            _maxConversionPlies,
+            *std::max_element(maxPlies.begin(), maxPlies.end()));
+        if (!progress()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Retrograde::resolveAll(const Checkpoint &from, TbGenStats &stats,
+                            const Progress &progress)
+{
+    long long resolved = _restore(from.passes);
+    stats.iterations = from.passes;
+    for (Short plies = from.passes + 1;
+         resolved > 0 || plies <= _maxConversionPlies; ++plies)
+    {
+        resolved = _resolvePass(plies);
+        stats.iterations = plies;
+        if (!progress()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Pass plies: Walk back from the frontier, then resolve the candidates.
+long long Retrograde::_resolvePass(Short plies) {
+    _forEachBit([](const Flags &flags, std::size_t w) {
+        return flags.frontier.word(w);
+    }, [&](Short side, std::size_t i, Short) {
+        _addPredecessors(Color(side), i);
+    });
+
+    _forEachBit([](const Flags &flags, std::size_t w) {
+        return (flags.winCandidates.word(w) | flags.lossCandidates.word(w)
+                | flags.conversions.word(w))
+            & ~flags.resolved.word(w);
+    }, [&](Short side, std::size_t i, Short) {
+        _resolve(Color(side), i, plies);
+    });
+
+    // Resolved in this pass, incl. by an interrupted run of it
+    long long result = 0;
+    for (Flags &flags : _flags) {
+        for (std::size_t w = 0; w < _words; ++w) {
+            result += popCount(flags.next.word(w));
+        }
+        flags.frontier.swap(flags.next);
+        flags.next.clear();
+        flags.winCandidates.clear();
+        flags.lossCandidates.clear();
+    }
+    return result;
+}
+
+// The flags that link the passes follow from the values: The frontier of
+// the next pass holds the positions resolved in the last one. Positions
+// resolved by an interrupted pass after it are flagged as such.
+long long Retrograde::_restore(Short passes) {
+    std::vector<long long> counts(_pool.size(), 0);
+    _forEachWord(0, _words, [&](Short side, std::size_t w, Short worker) {
+        Flags &flags = _flags[side];
+        flags.frontier.clear(w);
+        flags.next.clear(w);
+        flags.winCandidates.clear(w);
+        flags.lossCandidates.clear(w);
+        std::uint64_t resolved = flags.resolved.word(w);
+        while (resolved) {
+            std::size_t i = 64 * w + popLsb(resolved);
+            TbValue v = _load(side, i);
+            if (v == TB_BROKEN || v == TB_DRAW) {
+                continue;
+            }
+            if (tbPlies(v) == passes) {
+                flags.frontier.set(i);
+                ++counts[worker];
+            } else if (tbPlies(v) == passes + 1) {
+                flags.next.set(i);
+            }
+        }
+    });
+    long long result = 0;
+    for (long long count : counts) {
+        result += count;
+    }
+    return result;
+}
+
+void Retrograde::finish(TbGenStats &stats) {
+    for (Short side = 0; side < COLORS_COUNT; ++side) {
+        for (std::size_t i = 0; i < _indexer.size(); ++i) {
+            TbValue v = _values[side][i];
+            if (!_flags[side].resolved.test(i)) {
+                _values[side][i] = v = TB_DRAW;
+            }
+            if (v == TB_BROKEN) {
+                continue;
+            }
+            if (isTbWin(v)) {
+                ++stats.wins;
+                stats.longestWin = std::max(stats.longestWin, tbPlies(v));
+            } else if (isTbLoss(v)) {
+                ++stats.losses;
+            } else {
+                ++stats.draws;
+            }
+        }
+    }
+}
+
+TbValue Retrograde::_conversionValue(const Position &child) const {
+    Material m = Material::ofPosition(child);
+    if (m.pieceCount() == 2) {
+        return TB_DRAW;
+    }
+    return _children.at(m.canonical().name())->probe(child);
+}
+
+void Retrograde::_initialize(Color c, std::size_t i, Short &maxPlies) {
+    Short side = colorIndex(c);
+    Flags &flags = _flags[side];
+    TbSquares squares;
+    bool isLegal =
+        _indexer.decode(i, squares) && _indexer.index(squares) == i;
+    Position pos = isLegal ? _indexer.toPosition(squares, c) : Position{};
+    // The side not to move cannot be in check.
+    if (!isLegal || pos.isAttacked(pos.kingSquare(opponent(c)), c)) {
+        _store(side, i, TB_BROKEN);
+        flags.resolved.set(i);
+        return;
+    }
+
+    FastMoves moves{};
+    pos.legalMoves(moves);
+    if (moves.empty()) {
+        bool isMate = pos.isInCheck();
+        _store(side, i, isMate ? tbLoss(0) : TB_DRAW);
+        flags.resolved.set(i);
+        if (isMate) {
+            flags.frontier.set(i);
+        }
+        return;
+    }
+    TbValue best = tbLoss(0); // No move leaves the table
+    PositionUndo undo;
+    for (const FastMove &move : moves) {
+        if (!pos.isCapture(move) && !move.isPromotion()) {
+            continue;
+        }
+        pos.makeMove(move, undo);
+        TbValue v = tbParent(_conversionValue(pos));
+        pos.unmakeMove(move, undo);
+        if (tbRank(v) > tbRank(best)) {
+            best = v;
+        }
+    }
+    _store(side, i, best);
+    if (best != TB_DRAW && best != tbLoss(0)) {
+        flags.conversions.set(i);
+        maxPlies = std::max(maxPlies, tbPlies(best));
+    }
+}
+
+// Mark the positions that can move to the resolved position i: As won, if
+// it is lost, and otherwise as possibly lost.
+void Retrograde::_addPredecessors(Color c, std::size_t i) {
+    Color mover = opponent(c);
+    Flags &prevFlags = _flags[colorIndex(mover)];
+    AtomicBitset &candidates = isTbLoss(_load(colorIndex(c), i))
+        ? prevFlags.winCandidates
+        : prevFlags.lossCandidates;
+    TbSquares squares;
+    _indexer.decode(i, squares);
+    Bitboard occupied = 0;
+    for (Short k = 0; k < _indexer.pieceCount(); ++k) {
+        occupied |= squareBB(squares[k]);
+    }
+    for (Short k = 0; k < _indexer.pieceCount(); ++k) {
+        if (_indexer.pieceColor(k) != mover) {
+            continue;
+        }
+        PieceType pt = _indexer.pieceType(k);
+        Bitboard froms = pt == PieceType::Pawn
+            ? pawnUnmoves(mover, squares[k], occupied)
+            : pieceAttacks(pt, mover, squares[k], occupied) & ~occupied;
+        while (froms) {
+            TbSquares prev = squares;
+            prev[k] = popLsb(froms);
+            // The side to move now cannot have been in check.
+            Position prevPos = _indexer.toPosition(prev, mover);
+            if (prevPos.isAttacked(prevPos.kingSquare(c), mover)) {
+                continue;
+            }
+            std::size_t prevIndex = _indexer.index(prev);
+            if (!prevFlags.resolved.test(prevIndex)) {
+                candidates.set(prevIndex);
+            }
+        }
+    }
+}
+
+// Wins are resolved in odd passes, and losses in even ones.
+void Retrograde::_resolve(Color c, std::size_t i, Short plies) {
+    Short side = colorIndex(c);
+    Flags &flags = _flags[side];
+    TbValue conversion = _load(side, i);
+    bool isConversionDue = flags.conversions.test(i)
+        && tbPlies(conversion) <= plies;
+    TbValue v = TB_DRAW;
+    if (plies % 2 == 1) {
+        bool isWon = flags.winCandidates.test(i)
+            || (isConversionDue && isTbWin(conversion));
+        v = isWon ? tbWin(plies) : TB_DRAW;
+    } else if (isTbLoss(conversion) && tbPlies(conversion) <= plies
+               && (flags.lossCandidates.test(i) || isConversionDue)
+               && _isLost(c, i))
+    {
+        v = tbLoss(plies);
+    }
+    if (v != TB_DRAW) {
+        _store(side, i, v);
+        flags.resolved.set(i);
+        flags.next.set(i);
+    }
+    // Last: A run of this pass that is interrupted before can redo it.
+    if (isConversionDue) {
+        flags.conversions.reset(i);
+    }
+}
+
+// Whether every move that stays in the table leads to a resolved win for
+// the opponent. (Those won in this pass are not, since it resolves losses.)
+bool Retrograde::_isLost(Color c, std::size_t i) const {
+    TbSquares squares;
+    _indexer.decode(i, squares);
+    Position pos = _indexer.toPosition(squares, c);
+    Short childSide = colorIndex(opponent(c));
+    FastMoves moves{};
+    pos.legalMoves(moves);
+    PositionUndo undo;
+    for (const FastMove &move : moves) {
+        if (pos.isCapture(move) || move.isPromotion()) {
+            continue;
+        }
+        pos.makeMove(move, undo);
+        std::size_t childIndex = _indexer.index(_indexer.squaresOf(pos));
+        pos.unmakeMove(move, undo);
+        if (!_flags[childSide].resolved.test(childIndex)
+            || !isTbWin(_load(childSide, childIndex)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+std::ostream &operator<<(std::ostream &os, const TbGenStats &stats) {
+    os << stats.material << ": positions=" << stats.positions
+       << ", wins=" << stats.wins << ", draws=" << stats.draws
+       << ", losses=" << stats.losses << ", longest=" << stats.longestWin
+       << " plies, passes=" << stats.iterations;
+    if (stats.isSaved) {
+        os << ", bytes=" << stats.fileSize;
+    }
+    if (stats.isOutOfCore) {
+        os << ", out of core";
+    }
+    if (stats.resumedAfter) {
+        os << ", resumed after pass " << *stats.resumedAfter;
+    }
+    os << ", ms=" << stats.elapsed.count();
+    return os;
+}
+
+// ========================================
+// TbGenerator
+
+// ---------- Constructor
+TbGenerator::TbGenerator(ThreadPool &pool, Tablebases &tables,
+                         const Report &report /* =nullptr */)
+    : _pool{pool}, _tables{tables}, _report{report}, _scratchDir{},
+      _memoryLimit{0}, _isStopped{false}
+{}
+
+// ---------- Write methods
+void TbGenerator::setScratch(const string &dir, std::size_t memoryLimit) {
+    _scratchDir = dir;
+    _memoryLimit = memoryLimit;
+}
+
+bool TbGenerator::generate(const Material &m) {
+    Material canonical = m.canonical();
+    if (canonical.pieceCount() > TB_MAX_PIECES) {
+        return false;
+    }
+    if (canonical.pieceCount() <= 2 || _tables.find(canonical)) {
+        return true;
+    }
+    bool isSaved = true;
+    for (const Material &child : canonical.children()) {
+        isSaved = generate(child) && isSaved;
+        if (!_tables.find(child)) {
+            return false; // Stopped
+        }
+    }
+
+    TbGenStats stats{};
+    stats.material = canonical;
+    stats.positions = TbIndexer{canonical}.size();
+    // Values and flags, for both sides
+    std::size_t stateSize = COLORS_COUNT * stats.positions * sizeof(TbValue)
+        + COLORS_COUNT * Retrograde::FLAG_KINDS
+              * Retrograde::flagWords(stats.positions) * sizeof(std::uint64_t);
+    stats.isOutOfCore = !_scratchDir.empty() && !_tables.dir().empty()
+        && stateSize > _memoryLimit;
+    string path = Tablebases::path(_tables.dir(), canonical);
+    SteadyClock::time_point start = SteadyClock::now();
+    std::optional<Tablebase> oTable{};
+    if (stats.isOutOfCore) {
+        if (!_buildOutOfCore(canonical, path, stats)) {
+            return false;
+        }
+        oTable = Tablebase::load(path);
+        stats.isSaved = oTable.has_value();
+    } else {
+        oTable = _build(canonical, stats);
+        if (!oTable) {
+            return false;
+        }
+        // Then mapped back from its file, once saved
+        if (!_tables.dir().empty() && oTable->save(path)) {
+            std::optional<Tablebase> oMapped = Tablebase::load(path);
+            stats.isSaved = oMapped.has_value();
+            if (oMapped) {
+                oTable = std::move(oMapped); // Frees the table in memory
+            }
+        }
+    }
+    stats.elapsed =
+        std::chrono::duration_cast<Millis>(SteadyClock::now() - start);
+    if (oTable) {
+        stats.fileSize = oTable->fileSize();
+        _tables.add(std::move(*oTable));
+    }
+    isSaved = isSaved && (_tables.dir().empty() || stats.isSaved);
+    if (_report) {
+        _report(stats);
+    }
+    return isSaved;
+}
+
+// ---------- Private write methods
+std::map<string, const Tablebase *>
+TbGenerator::_children(const Material &m) const {
+    std::map<string, const Tablebase *> result;
+    for (const Material &child : m.children()) {
+        result[child.name()] = _tables.find(child);
+    }
+    return result;
+}
+
+std::optional<Tablebase> TbGenerator::_build(const Material &m,
+                                             TbGenStats &stats)
+{
+    std::map<string, const Tablebase *> children = _children(m);
+    Tablebase result{m};
+    std::vector<std::uint64_t> flags(COLORS_COUNT * Retrograde::FLAG_KINDS
+                                     * Retrograde::flagWords(stats.positions));
+    Retrograde retrograde{_pool, result._indexer,
+                          {result._values[0].data(), result._values[1].data()},
+                          children, flags.data(), flags.size()};
+    Retrograde::Progress progress = [this]() { return !isStopped(); };
+    if (!retrograde.initialize(Checkpoint{}, progress)
+        || !retrograde.resolveAll(Checkpoint{}, stats, progress))
+    {
+        return std::nullopt;
+    }
+    retrograde.finish(stats);
+    return result;
+}
+
+bool TbGenerator::_buildOutOfCore(const Material &m, const string &path,
+                                  TbGenStats &stats)
+{
+    std::map<string, const Tablebase *> children = _children(m);
+    TbIndexer indexer{m};
+    std::size_t size = indexer.size();
+    string base = _scratchDir + "/" + m.name();
+    string checkpointPath = base + ".checkpoint";
+    std::optional<Checkpoint> oCheckpoint =
+        readCheckpoint(checkpointPath, m, size);
+    if (!oCheckpoint) { // Start afresh, from zeroed files
+        std::remove((base + ".values").c_str());
+        std::remove((base + ".flags").c_str());
+    }
+    std::size_t flagWords = Retrograde::flagWords(size);
+    ScratchFile valuesFile, flagsFile;
+    if (!valuesFile.map(base + ".values",
+                        COLORS_COUNT * size * sizeof(TbValue))
+        || !flagsFile.map(base + ".flags",
+                          COLORS_COUNT * Retrograde::FLAG_KINDS * flagWords
+                              * sizeof(std::uint64_t)))
+    {
+        return false;
+    }
+    TbValue *values = valuesFile.data<TbValue>();
+    // A window: The positions of at least one placement of the Kings
+    std::size_t windowWords =
+        std::max((indexer.sliceSize() + 63) / 64, std::size_t{1024});
+    Retrograde retrograde{_pool, indexer, {values, values + size}, children,
+                          flagsFile.data<std::uint64_t>(), windowWords};
+
+    const Checkpoint from = oCheckpoint.value_or(Checkpoint{});
+    if (oCheckpoint) {
+        stats.resumedAfter = from.passes;
+    }
+    // Sync the files, then record how far they have got.
+    Retrograde::Progress progress = [&]() {
+        Checkpoint done{retrograde.initialized(), stats.iterations,
+                        retrograde.maxConversionPlies()};
+        return valuesFile.sync() && flagsFile.sync()
+            && writeCheckpoint(checkpointPath, m, size, done)
+            && !isStopped();
+    };
+    if (!retrograde.initialize(from, progress)
+        || !retrograde.resolveAll(from, stats, progress))
+    {
+        return false;
+    }
+    retrograde.finish(stats);
+    if (!Tablebase::_save(path, m, {values, values + size})) {
+        return false;
+    }
+    std::remove((base + ".values").c_str());
+    std::remove((base + ".flags").c_str());
+    std::remove(checkpointPath.c_str());
+    return true;
+}
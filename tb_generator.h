@@ -0,0 +1,116 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+
+#include "clock.h"
+#include "tablebase.h"
+#include "thread_pool.h"
+#include "util.h"
+
+// What TbGenerator reports for each table it builds.
+struct TbGenStats {
+    Material material;
+    std::size_t positions = 0; // Per side to move, incl. broken indexes
+    long long wins = 0;        // Legal positions, for the side to move
+    long long draws = 0;
+    long long losses = 0;
+    Short longestWin = 0;      // Plies
+    Short iterations = 0;      // Retrograde passes
+    bool isSaved = false;
+    std::size_t fileSize = 0;  // Bytes, once saved
+    bool isOutOfCore = false;  // Built in scratch files (see setScratch)
+    std::optional<Short> resumedAfter{}; // Pass of an interrupted build
+    Millis elapsed{0};
+};
+
+std::ostream &operator<<(std::ostream &os, const TbGenStats &stats);
+
+// ========================================
+// TbGenerator
+//
+// Builds Tablebases by retrograde analysis. First, every position is
+// decoded and its legal moves generated: Mates and stalemates are final,
+// and the best of the moves that leave the table (captures and promotions)
+// is looked up in the smaller tables. Then pass d resolves the positions
+// that are won or lost in d plies: Those that can move to a position lost
+// in d - 1 plies are won, and those whose moves all lead to wins for the
+// opponent, the last of them in d - 1 plies, are lost. Each pass starts from
+// the positions resolved by the one before (the frontier), and walks back
+// to their predecessors with an unmove generator. What is left at the end
+// is drawn.
+//
+// Positions are split across the workers of a ThreadPool. The frontier and
+// the other per-position flags are bitsets, shared by the workers through
+// atomic operations.
+//
+// Tables too large for memory (e.g., of 6 pieces) are built out of core:
+// Their values and flags are kept in scratch files, mapped into memory, so
+// that the OS pages them in and out. Each step walks them slice by slice
+// (see TbIndexer::sliceSize), so the files are read and written mostly in
+// order. After each slice of the initialization, and after each pass, the
+// files are synced and a checkpoint is written, which a later run with the
+// same scratch directory resumes from.
+class TbGenerator {
+  public:
+    using Report = std::function<void(const TbGenStats &)>;
+
+    // ---------- Constructor
+    TbGenerator(ThreadPool &pool, Tablebases &tables,
+                const Report &report = nullptr);
+
+    // ---------- Read methods
+    bool isStopped() const { return _isStopped.load(); }
+
+    // ---------- Write methods
+    // Build the tables whose working state takes more than memoryLimit
+    // bytes out of core, in the directory dir. Only tables that are saved
+    // (see generate) can be.
+    void setScratch(const std::string &dir, std::size_t memoryLimit);
+    // Build the table of a Material, after those it converts to that are
+    // missing from tables. New tables are added to tables, and saved to its
+    // directory, if any, then mapped back from their files in place of
+    // the tables in memory. Returns false if one could not be saved, or
+    // if stopped.
+    bool generate(const Material &m);
+    // Thread-safe (e.g., from a signal handler). The table being built, or
+    // else the next one, stops after its current step: Out of core, after
+    // its checkpoint.
+    void stop() { _isStopped.store(true); }
+
+  private:
+    // The tables that the Material converts to
+    std::map<std::string, const Tablebase *>
+    _children(const Material &m) const;
+    std::optional<Tablebase> _build(const Material &m, TbGenStats &stats);
+    // Saves the table to path. Returns false if stopped, or on an error.
+    bool _buildOutOfCore(const Material &m, const std::string &path,
+                         TbGenStats &stats);
+
+    ThreadPool &_pool;
+    Tablebases &_tables;
+    Report _report;
+    std::string _scratchDir;
+    std::size_t _memoryLimit;
+    std::atomic<bool> _isStopped;
+};
@@ -24,7 +24,9 @@
 // #include "geometry.h"
 // #include "player.h"
 #include "board.h"
+#include "move.h"
 #include "piece.h"
+#include "position.h"
 
 TEST(BoardTest, BoardKings) {
     ScopedTracer(__func__);
@@ -91,3 +93,69 @@ TEST(BoardTest, BoardValue) {
     ASSERT_FLOAT_EQ(b.boardValue(Color::Black), KING_VALUE + 19.0);
     ASSERT_FLOAT_EQ(b.boardValue(Color::White), KING_VALUE + 15.0);
 }
+
+TEST(BoardTest, IncrementalEval) {
+    ScopedTracer(__func__);
+    Move::reset();
+    Board initial{true};
+    EXPECT_EQ(initial.evaluate(Color::White), 0);
+    EXPECT_EQ(initial.evalAccumulator().phase, PHASE_MAX);
+
+    // After each apply and applyUndo of a move of any kind (captures,
+    // castling, en passant, promotions), the accumulators and Zobrist keys
+    // match a Board built from scratch.
+    auto expectFresh = [](const Board &b) {
+        Board fresh = b.clone();
+        const EvalAccumulator &acc = b.evalAccumulator();
+        const EvalAccumulator &freshAcc = fresh.evalAccumulator();
+        EXPECT_EQ(acc.mg, freshAcc.mg);
+        EXPECT_EQ(acc.eg, freshAcc.eg);
+        EXPECT_EQ(acc.phase, freshAcc.phase);
+        EXPECT_EQ(acc.material, freshAcc.material);
+        EXPECT_EQ(b.hash(), fresh.hash());
+        EXPECT_EQ(b.pawnHash(), fresh.pawnHash());
+        EXPECT_EQ(b.pawns(), fresh.pawns());
+        EXPECT_EQ(b.pieceBitboards(), fresh.pieceBitboards());
+    };
+    auto expectUnchanged = [&](Board &b, Color c) {
+        EvalValue before = b.evaluate(c);
+        expectFresh(b);
+        for (Move &move : concatMap(Move::getValidPlayerMoves(b, c))) {
+            move.apply(b);
+            expectFresh(b);
+            move.applyUndo(b);
+            expectFresh(b);
+            EXPECT_EQ(b.evaluate(c), before);
+        }
+    };
+    for (const char *fen : {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/"
+                            "1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+                            "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1"}) {
+        Position pos = *Position::fromFen(fen);
+        Board b = pos.toBoard();
+        expectUnchanged(b, pos.sideToMove());
+    }
+    // En passant follows a double Pawn move.
+    Board b = Position::fromFen("4k3/3p4/8/4P3/8/8/8/4K3 b - - 0 1")->toBoard();
+    Move d7d5{Color::Black, PieceType::Pawn, Pos{"d7"}, Pos{"d5"}};
+    d7d5.apply(b);
+    expectUnchanged(b, Color::White);
+}
+
+TEST(BoardTest, BoardClone) {
+    ScopedTracer(__func__);
+    Move::reset();
+    Board b{true};
+    Board clone = b.clone();
+    EXPECT_EQ(clone, b);
+    EXPECT_EQ(clone.hash(), b.hash());
+    EXPECT_NE(clone.pieceAt(Pos{"e2"}), b.pieceAt(Pos{"e2"})); // Own Pieces
+
+    Move e2e4{Color::White, PieceType::Pawn, Pos{"e2"}, Pos{"e4"}};
+    e2e4.apply(clone);
+    EXPECT_TRUE(b.pieceAt(Pos{"e2"}));
+    EXPECT_EQ(b.pieceAt(Pos{"e2"})->pos(), Pos{"e2"});
+    EXPECT_FALSE(b.pieceAt(Pos{"e2"})->hasMoved());
+    e2e4.applyUndo(clone);
+    EXPECT_EQ(clone, b);
+}
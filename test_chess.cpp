@@ -19,9 +19,16 @@
 #include "test_common.h"
 
 #include "test_board.h"
+#include "test_clock.h"
+#include "test_eval.h"
 #include "test_game_state.h"
 #include "test_logger.h"
+#include "test_mate_solver.h"
+#include "test_mcts.h"
 #include "test_move.h"
+#include "test_nnue.h"
+#include "test_search.h"
+#include "test_tablebase.h"
 #include "test_util.h"
 
 using std::cout;
@@ -0,0 +1,120 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "clock.h"
+#include "game_state.h"
+#include "search.h"
+#include "time_manager.h"
+
+#include "test_common.h"
+
+TEST(ClockTest, TimeControlParse) {
+    ScopedTracer(__func__);
+    std::optional<TimeControl> tc = TimeControl::parse("180+2");
+    ASSERT_TRUE(tc);
+    EXPECT_EQ(tc->base, Millis{180'000});
+    EXPECT_EQ(tc->increment, Millis{2'000});
+    tc = TimeControl::parse("0.5");
+    ASSERT_TRUE(tc);
+    EXPECT_EQ(tc->base, Millis{500});
+    EXPECT_EQ(tc->increment, Millis{0});
+    EXPECT_FALSE(TimeControl::parse("blitz"));
+    EXPECT_FALSE(TimeControl::parse("0+1"));
+    EXPECT_FALSE(TimeControl::parse("1e999"));
+    EXPECT_FALSE(TimeControl::parse("60+1e999"));
+    EXPECT_FALSE(TimeControl::parse("inf"));
+    EXPECT_FALSE(TimeControl::parse("nan"));
+    EXPECT_FALSE(TimeControl::parse("60+nan"));
+    EXPECT_FALSE(TimeControl::parse("1e300"));
+}
+
+TEST(ClockTest, ChessClock) {
+    ScopedTracer(__func__);
+    ChessClock clock{TimeControl{Millis{1'000}, Millis{100}}};
+    clock.start(Color::White);
+    std::this_thread::sleep_for(Millis{20});
+    EXPECT_LT(clock.remaining(Color::White), Millis{1'000});
+    EXPECT_EQ(clock.remaining(Color::Black), Millis{1'000});
+    clock.start(Color::Black); // Stops White's clock, which gains increment
+    EXPECT_GT(clock.remaining(Color::White), Millis{1'000});
+    EXPECT_LE(clock.remaining(Color::White), Millis{1'080});
+    clock.stop();
+    EXPECT_FALSE(clock.running());
+    EXPECT_FALSE(clock.isFlagged(Color::Black));
+
+    clock.reset();
+    EXPECT_EQ(clock.remaining(Color::White), Millis{1'000});
+}
+
+TEST(ClockTest, TimeManagerLimits) {
+    ScopedTracer(__func__);
+    TimeManager tm{};
+    EXPECT_FALSE(tm.isLimited());
+    tm.start(Millis{10'000}, Millis{100});
+    EXPECT_TRUE(tm.isLimited());
+    EXPECT_GT(tm.softLimit(), Millis{0});
+    EXPECT_LE(tm.softLimit(), tm.hardLimit());
+    EXPECT_LT(tm.hardLimit(), Millis{10'000} / 2);
+    EXPECT_TRUE(tm.shouldStartIteration());
+
+    // Low on time: The limits shrink, but stay positive.
+    tm.start(Millis{40}, Millis{0});
+    EXPECT_GT(tm.softLimit(), Millis{0});
+    EXPECT_LT(tm.hardLimit(), Millis{40});
+
+    // The longest time control accepted by TimeControl::parse
+    Millis longest = TimeControl::parse("1e9")->base;
+    tm.start(longest, Millis{0});
+    EXPECT_GT(tm.softLimit(), Millis{0});
+    EXPECT_LE(tm.softLimit(), tm.hardLimit());
+    EXPECT_LT(tm.hardLimit(), longest / 2);
+}
+
+TEST(ClockTest, SearchStopsAtHardLimit) {
+    ScopedTracer(__func__);
+    Move::reset();
+    Board b{true};
+    Search search{SearchConfig{MAX_PLY - 1, 14, true}};
+    search.timeManager().start(Millis{200}, Millis{0});
+    SearchResult result = search.search(b, Color::White);
+    EXPECT_TRUE(result.bestMove);
+    EXPECT_LT(result.depth, MAX_PLY - 1);
+    EXPECT_LE(search.timeManager().elapsed(), Millis{200});
+    EXPECT_EQ(b, Board{true});
+    EXPECT_TRUE(Move::getMoveHistory().empty());
+}
+
+TEST(ClockTest, TimeForfeit) {
+    ScopedTracer(__func__);
+    Board b = Board{false};
+    add_wk_to(b, "e1");
+    add_bk_to(b, "e8");
+    add_bn_to(b, "b8");
+    GameState gs1 = GameState::timeForfeit(b, Color::White);
+    EXPECT_EQ(gs1.gameEnd(), GameEnd::Draw);
+    EXPECT_NE(gs1.drawFlags() & Draw_Clock, Draw_None);
+
+    add_bp_to(b, "a7");
+    GameState gs2 = GameState::timeForfeit(b, Color::White);
+    EXPECT_EQ(gs2.gameEnd(), GameEnd::WinBlack);
+    EXPECT_EQ(gs2.winType(), WinType::Clock);
+}
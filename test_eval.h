@@ -0,0 +1,124 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "board.h"
+#include "eval.h"
+#include "move.h"
+#include "position.h"
+#include "texel_tuner.h"
+#include "thread_pool.h"
+#include "training_data.h"
+#include "util.h"
+
+#include "test_common.h"
+
+TEST(EvalTest, TexelTuner) {
+    ScopedTracer(__func__);
+    ThreadPool pool{2};
+    TexelTuner tuner{pool};
+
+    // The tuner's linear model is the engine's evaluation, up to rounding.
+    const std::vector<std::string> fens{
+        START_FEN,
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "6k1/5ppp/8/8/8/8/1P3PPP/6K1 b - - 0 1"};
+    for (const std::string &fen : fens) {
+        Position pos = *Position::fromFen(fen);
+        Board b = pos.toBoard();
+        Color c = pos.sideToMove();
+        PawnEntry entry = evaluatePawns(b.pawnHash(), b.pawns());
+        Short phase = b.evalAccumulator().phase;
+        EvalValue engineValue = b.evaluate(c)
+            + entry.value(c, pos.kingSquare(Color::Black),
+                          pos.kingSquare(Color::White), phase)
+            + evaluateMobility(c, b.pieceBitboards(), phase);
+        EXPECT_NEAR(tuner.evaluate(pos), engineValue, 3.0) << fen;
+    }
+
+    // White wins with an extra Knight, and loses without its Queen.
+    std::vector<LabeledPosition> batch{};
+    for (const char *line :
+         {"rnbqkb1r/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1;1-0",
+          "r1bqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR b KQkq - 0 1;1-0",
+          "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNB1KBNR w KQkq - 0 1;0-1",
+          "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1;1/2-1/2"})
+    {
+        batch.push_back(*parseLabeledPosition(line));
+    }
+    tuner.addPositions(batch);
+    EXPECT_EQ(tuner.size(), batch.size());
+    double initialError = tuner.fitScale();
+    for (int k = 0; k < 100; ++k) {
+        tuner.step();
+    }
+    EXPECT_LT(tuner.error(), initialError / 2);
+    EXPECT_EQ(tuner.steps(), 100);
+    EvalParams params = tuner.params();
+    EXPECT_GT(params[EP_MG_MATERIAL + int(PieceType::Knight)],
+              EVAL_PARAMS[EP_MG_MATERIAL + int(PieceType::Knight)]);
+
+    // The header has one value per parameter.
+    std::ostringstream os;
+    writeEvalParams(os, params, "test");
+    std::string text = os.str();
+    std::string body = text.substr(text.find("EVAL_PARAMS{"));
+    int valueCount = 0;
+    std::istringstream is{body};
+    for (std::string line; std::getline(is, line);) {
+        if (line.rfind("    //", 0) != 0 && line.find(',') != line.npos) {
+            std::istringstream values{line};
+            for (std::string v; std::getline(values, v, ',');) {
+                valueCount += v.find_first_of("0123456789") != v.npos;
+            }
+        }
+    }
+    EXPECT_EQ(valueCount, EVAL_PARAM_COUNT);
+}
+
+TEST(EvalTest, Mobility) {
+    ScopedTracer(__func__);
+    // The Knight attacks 8 squares, of which the Pawn on d7 attacks c6 and e6.
+    Board b =
+        Position::fromFen("4k3/3p4/8/8/3N4/8/8/4K3 w - - 0 1")->toBoard();
+    int knight = static_cast<int>(PieceType::Knight);
+    EXPECT_EQ(evaluateMobility(Color::White, b.pieceBitboards(), 0),
+              6 * EVAL_PARAMS[EP_EG_MOBILITY + knight]);
+    EXPECT_EQ(evaluateMobility(Color::Black, b.pieceBitboards(), PHASE_MAX),
+              -6 * EVAL_PARAMS[EP_MG_MOBILITY + knight]);
+
+    // A Queen on e6 attacks d7, e7, f7 and e8, in the zone of the King on e8.
+    b = Position::fromFen("4k3/8/4Q3/8/8/8/8/4K3 b - - 0 1")->toBoard();
+    int kingZone = 0;
+    visitMobilityTerms(Color::White, b.pieceBitboards(),
+                       [&](int mgParam, int, int count) {
+                           if (mgParam >= EP_KING_ATTACK) {
+                               kingZone += count;
+                           }
+                       });
+    EXPECT_EQ(kingZone, 4);
+    EXPECT_TRUE(Move::isInCheck(b, Color::Black));
+}
@@ -21,6 +21,9 @@
 #include "game_state.h"
 #include "geometry.h"
 #include "move.h"
+#include "tablebase.h"
+#include "tb_generator.h"
+#include "thread_pool.h"
 
 TEST(BoardStateTest, NearMate) {
     ScopedTracer(__func__);
@@ -113,3 +116,31 @@ TEST(BoardStateTest, Draw_kb_kb) {
         && (gs.drawFlags() & Draw_InsufficientResources) != Draw_None
         );
 }
+
+TEST(BoardStateTest, Tablebase) {
+    ScopedTracer(__func__);
+    ThreadPool pool{2};
+    auto tablesP = std::make_unique<Tablebases>(""); // In memory
+    TbGenerator generator{pool, *tablesP};
+    ASSERT_TRUE(generator.generate(*Material::fromString("KRvK")));
+    Tablebases::setActive(std::move(tablesP));
+
+    Board b{false};
+    add_bk_to(b, "e5");
+    add_wk_to(b, "c2");
+    add_wr_to(b, "h7");
+    // Black to move, but White mates by force.
+    const Pos2Moves &p2m1 = Move::getValidPlayerMoves(b, Color::Black);
+    GameState gs1{b, Color::White, false, p2m1};
+    EXPECT_EQ(gs1.gameEnd(), GameEnd::WinWhite);
+    EXPECT_EQ(gs1.winType(), WinType::Tablebase);
+
+    // The Rook hangs.
+    b.removePieceAt(Pos("h7"));
+    add_wr_to(b, "e6");
+    const Pos2Moves &p2m2 = Move::getValidPlayerMoves(b, Color::Black);
+    GameState gs2{b, Color::White, false, p2m2};
+    EXPECT_EQ(gs2.gameEnd(), GameEnd::Draw);
+    EXPECT_NE(gs2.drawFlags() & Draw_Tablebase, Draw_None);
+    Tablebases::setActive(nullptr);
+}
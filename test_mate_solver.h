@@ -0,0 +1,99 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "mate_solver.h"
+#include "position.h"
+#include "util.h"
+
+#include "test_common.h"
+
+TEST(MateSolverTest, CheckGenerators) {
+    ScopedTracer(__func__);
+    // In check from a Knight; and with checks by a Pawn, a promotion, and
+    // castling, discovered checks, and en passant.
+    for (const char *fen :
+         {"r3k2r/p1ppqpb1/bn2pnN1/3P4/1p2P3/5Q1p/PPPBBPPP/R3K2R b KQkq - 0 1",
+          "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+          "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+          "5k2/8/8/2pP4/8/8/8/R3K2R w KQ c6 0 1"})
+    {
+        Position pos = *Position::fromFen(fen);
+        FastMoves legal{};
+        FastMoves checks{};
+        pos.legalMoves(legal);
+        pos.checkingMoves(checks);
+        Short checkCount = 0;
+        PositionUndo undo;
+        for (const FastMove &move : legal) {
+            pos.makeMove(move, undo);
+            bool isCheck = pos.isInCheck();
+            pos.unmakeMove(move, undo);
+            EXPECT_EQ(pos.givesCheck(move), isCheck) << fen << ": " << move;
+            checkCount += isCheck;
+        }
+        EXPECT_EQ(checks.size(), checkCount) << fen;
+        if (pos.isInCheck()) {
+            FastMoves evasions{};
+            pos.checkEvasions(evasions);
+            EXPECT_EQ(evasions.size(), legal.size()) << fen;
+        }
+    }
+}
+
+TEST(MateSolverTest, SolvesMateInN) {
+    ScopedTracer(__func__);
+    MateSolver solver{};
+    Position pos = *Position::fromFen("r5rk/5p1p/5R2/4B3/8/8/7P/7K w - - 0 1");
+    MateResult result = solver.solve(pos);
+    ASSERT_EQ(result.status, MateStatus::Mate);
+    EXPECT_EQ(result.plies, 5);
+    ASSERT_EQ(result.pv.size(), 5u);
+    EXPECT_EQ(result.pv.front(), FastMove(Pos{"f6"}.index(),
+                                          Pos{"a6"}.index()));
+    PositionUndo undo;
+    for (const FastMove &move : result.pv) {
+        pos.makeMove(move, undo);
+    }
+    FastMoves moves{};
+    pos.legalMoves(moves);
+    EXPECT_TRUE(pos.isInCheck() && moves.empty());
+
+    // Within fewer plies, or without checks, there is no mate. With too few
+    // nodes, the result is unknown.
+    ASSERT_TRUE(solver.setOption("matePlies", "3"));
+    EXPECT_EQ(solver.solve(*Position::fromFen("r5rk/5p1p/5R2/4B3/8/8/7P/7K "
+                                              "w - - 0 1"))
+                  .status,
+              MateStatus::NoMate);
+    ASSERT_TRUE(solver.setOption("matePlies", "0"));
+    EXPECT_EQ(solver.solve(*Position::fromFen(START_FEN)).status,
+              MateStatus::NoMate);
+    ASSERT_TRUE(solver.setOption("mateNodes", "10"));
+    ASSERT_FALSE(solver.setOption("mateNodes", "many"));
+    ASSERT_FALSE(solver.setOption("mateNodes", "0"));
+    ASSERT_FALSE(solver.setOption("matePlies", "-1"));
+    ASSERT_FALSE(solver.setOption("mateHash", "64"));
+    EXPECT_EQ(solver.config().maxNodes, 10);
+    EXPECT_EQ(solver.config().maxPlies, 0);
+    EXPECT_EQ(solver.solve(*Position::fromFen("8/8/8/8/8/2k5/8/K6Q w - - 0 1"))
+                  .status,
+              MateStatus::Unknown);
+}
@@ -0,0 +1,155 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "board.h"
+#include "mcts.h"
+#include "move.h"
+#include "position.h"
+#include "util.h"
+
+#include "test_common.h"
+
+TEST(MctsTest, PositionMoveGeneration) {
+    ScopedTracer(__func__);
+    Move::reset();
+    const std::string kiwipete =
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
+    Position start = Position::fromBoard(Board{true}, Color::White);
+    EXPECT_EQ(start.fen(), START_FEN);
+    EXPECT_EQ(start, *Position::fromFen(START_FEN));
+    EXPECT_FALSE(Position::fromFen("rnbqkbnr/pppppppp/9/8 w"));
+
+    // Perft counts, incl. castling, en passant and promotions
+    Position pos = *Position::fromFen(kiwipete);
+    EXPECT_EQ(start.perft(3), 8'902);
+    EXPECT_EQ(pos.perft(3), 97'862);
+    EXPECT_EQ(pos.fen(), kiwipete); // Restored by unmakeMove
+
+    // The key is updated incrementally.
+    FastMoves moves{};
+    pos.legalMoves(moves);
+    PositionUndo undo;
+    for (const FastMove &move : moves) {
+        pos.makeMove(move, undo);
+        EXPECT_EQ(pos.key(), Position::fromFen(pos.fen())->key()) << move;
+        pos.unmakeMove(move, undo);
+    }
+}
+
+TEST(MctsTest, FindsMateInOne) {
+    ScopedTracer(__func__);
+    Move::reset();
+    Board b = mkCheckmatesBoard();
+
+    for (Short threads : {1, 4}) {
+        Position pos = Position::fromBoard(b, Color::Black);
+        Mcts mcts{MctsConfig{5'000, 1.4, 200, threads, 1 << 18}};
+        mcts.timeManager().startUnlimited();
+        FastMove best = mcts.search(pos);
+        ASSERT_FALSE(best.isNull());
+        PositionUndo undo;
+        pos.makeMove(best, undo);
+        FastMoves replies{};
+        pos.legalMoves(replies);
+        EXPECT_TRUE(replies.empty() && pos.isInCheck()) << best;
+
+        // No virtual loss is left behind.
+        const MctsStats &stats = mcts.stats();
+        EXPECT_EQ(stats.iterations, 5'000);
+        EXPECT_EQ(stats.threads, threads);
+        EXPECT_EQ(mcts.root().visits, 5'000u);
+        long long childVisits = 0;
+        for (const MctsNode *childP : mcts.children(mcts.root())) {
+            childVisits += childP->visits;
+        }
+        EXPECT_EQ(childVisits, 5'000);
+        EXPECT_GT(stats.nodes, std::size_t(mcts.root().childCount));
+        EXPECT_EQ(stats.memoryBytes, (std::size_t{1} << 18) * sizeof(MctsNode));
+    }
+
+    // As a Player strategy, on a Board
+    Mcts &mcts = Mcts::forColor(Color::Black);
+    ASSERT_TRUE(mcts.setOption("iterations", "2000"));
+    ASSERT_TRUE(mcts.setOption("nodes", "100000"));
+    // An invalid value leaves the config unchanged.
+    MctsConfig config = mcts.config();
+    ASSERT_FALSE(mcts.setOption("threads", "0"));
+    ASSERT_FALSE(mcts.setOption("iterations", "-1"));
+    ASSERT_FALSE(mcts.setOption("playoutPlies", "0"));
+    ASSERT_FALSE(mcts.setOption("nodes", "10"));
+    ASSERT_FALSE(mcts.setOption("nodes", "99999999999999999999"));
+    EXPECT_EQ(mcts.config().threads, config.threads);
+    EXPECT_EQ(mcts.config().maxIterations, config.maxIterations);
+    EXPECT_EQ(mcts.config().maxPlayoutPlies, config.maxPlayoutPlies);
+    EXPECT_EQ(mcts.config().maxNodes, config.maxNodes);
+    ASSERT_TRUE(mcts.setOption("threads", "2"));
+    ExtMove extMove = Mcts::strategyMcts(
+        b, Color::Black, Move::getValidPlayerMoves(b, Color::Black));
+    ASSERT_TRUE(extMove.optMove);
+    Move mate{*extMove.optMove};
+    mate.apply(b);
+    EXPECT_TRUE(Move::getValidPlayerMoves(b, Color::White).empty());
+    mate.applyUndo(b);
+}
+
+TEST(MctsTest, NodePoolAndTreeReuse) {
+    ScopedTracer(__func__);
+    MctsNodePool pool{};
+    pool.reset(64);
+    std::optional<NodeIndex> a = pool.allocate(20);
+    std::optional<NodeIndex> b = pool.allocate(30);
+    ASSERT_TRUE(a && b);
+    EXPECT_EQ(*a, 1u);
+    EXPECT_EQ(*b, 21u);
+    EXPECT_FALSE(pool.allocate(14));
+    pool.truncate(*b);
+    EXPECT_EQ(pool.allocate(43), b);
+    EXPECT_EQ(pool.used(), 64u);
+
+    // A small pool is pruned, and stays within its capacity.
+    Position pos = *Position::fromFen(START_FEN);
+    Mcts mcts{MctsConfig{4'000, 1.4, 200, 1, 4'096}};
+    mcts.timeManager().startUnlimited();
+    FastMove best = mcts.search(pos);
+    const MctsStats &stats = mcts.stats();
+    EXPECT_GT(stats.prunedNodes, 0);
+    EXPECT_LE(stats.nodes, 4'096u);
+    EXPECT_GT(stats.nodes, 4'096u / 2); // Compaction leaves no gaps
+    EXPECT_EQ(stats.reusedVisits, 0);
+
+    // After two moves, the tree below them is searched further.
+    std::uint32_t bestVisits = mcts.children(mcts.root()).front()->visits;
+    PositionUndo undo;
+    pos.makeMove(best, undo);
+    mcts.advance(best);
+    EXPECT_EQ(mcts.root().visits, bestVisits);
+    FastMove reply = mcts.children(mcts.root()).front()->move;
+    std::uint32_t replyVisits = mcts.children(mcts.root()).front()->visits;
+    pos.makeMove(reply, undo);
+    mcts.advance(reply);
+    mcts.search(pos);
+    EXPECT_EQ(stats.reusedVisits, replyVisits);
+    EXPECT_EQ(mcts.root().visits, replyVisits + 4'000);
+
+    // A move outside the tree, or another position: A new tree
+    mcts.advance(FastMove{});
+    mcts.search(*Position::fromFen(START_FEN));
+    EXPECT_EQ(stats.reusedVisits, 0);
+}
@@ -0,0 +1,185 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <cstdio>
+#include <random>
+
+#include <gtest/gtest.h>
+
+#include "batch_eval.h"
+#include "board.h"
+#include "move.h"
+#include "nnue.h"
+#include "nnue_trainer.h"
+#include "thread_pool.h"
+#include "position.h"
+#include "util.h"
+
+#include "test_common.h"
+
+// Small random weights: The accumulators cannot overflow.
+std::unique_ptr<Nnue> mkRandomNnue(unsigned seed) {
+    std::mt19937 gen{seed};
+    auto uniform = [&gen](int lo, int hi) {
+        return std::uniform_int_distribution<int>{lo, hi}(gen);
+    };
+    NnueWeights w;
+    for (auto &v : w.inputBiases) { v = uniform(0, 64); }
+    for (auto &v : w.inputWeights) { v = uniform(-8, 8); }
+    for (auto &v : w.hiddenBiases) { v = uniform(-2000, 2000); }
+    for (auto &v : w.hiddenWeights) { v = uniform(-64, 64); }
+    w.outputBias = uniform(-2000, 2000);
+    for (auto &v : w.outputWeights) { v = uniform(-64, 64); }
+    return std::make_unique<Nnue>(std::move(w));
+}
+
+TEST(NnueTest, IncrementalAndSimd) {
+    ScopedTracer(__func__);
+    Move::reset();
+    Nnue::setActive(mkRandomNnue(1));
+    NnueSimd bestSimd = Nnue::simd();
+    const char *fens[] = {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1"};
+    for (const char *fen : fens) {
+        Position pos = *Position::fromFen(fen);
+        Board b = pos.toBoard();
+        Color c = pos.sideToMove();
+        Score before = b.nnueEvaluate(c);
+        // Every kernel agrees with the scalar one.
+        for (NnueSimd simd : {NnueSimd::Sse41, NnueSimd::Avx2}) {
+            if (Nnue::setSimd(simd)) {
+                EXPECT_EQ(b.clone().nnueEvaluate(c), before) << to_string(simd);
+            }
+        }
+        Nnue::setSimd(NnueSimd::Scalar);
+        EXPECT_EQ(b.clone().nnueEvaluate(c), before);
+        Nnue::setSimd(bestSimd);
+
+        // Incremental updates, including King moves, match a refresh.
+        for (Move &move : concatMap(Move::getValidPlayerMoves(b, c))) {
+            move.apply(b);
+            EXPECT_EQ(b.nnueEvaluate(opponent(c)),
+                      b.clone().nnueEvaluate(opponent(c)));
+            move.applyUndo(b);
+            EXPECT_EQ(b.nnueEvaluate(c), before);
+        }
+    }
+    Nnue::setActive(nullptr);
+}
+
+TEST(NnueTest, BatchEvaluator) {
+    ScopedTracer(__func__);
+    // Positions along a random game, more than a few blocks of them
+    std::mt19937 gen{3};
+    std::vector<Position> positions{*Position::fromFen(
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1")};
+    while (positions.size() < 50) {
+        Position pos = positions.back();
+        FastMoves moves;
+        pos.legalMoves(moves);
+        if (moves.empty()) {
+            break;
+        }
+        PositionUndo undo;
+        pos.makeMove(moves[gen() % moves.size()], undo);
+        positions.push_back(pos);
+    }
+
+    // The same scores as the Board evaluations used by Search.
+    ThreadPool pool{2};
+    BatchEvaluator classical{pool, false};
+    std::vector<EvalValue> scores = classical.evaluate(positions);
+    ASSERT_EQ(scores.size(), positions.size());
+    for (std::size_t k = 0; k < positions.size(); ++k) {
+        Board b = positions[k].toBoard();
+        Color c = positions[k].sideToMove();
+        Short phase = b.evalAccumulator().phase;
+        PawnEntry entry = evaluatePawns(b.pawnHash(), b.pawns());
+        EvalValue expected = b.evaluate(c)
+            + entry.value(c, positions[k].kingSquare(Color::Black),
+                          positions[k].kingSquare(Color::White), phase)
+            + evaluateMobility(c, b.pieceBitboards(), phase);
+        EXPECT_EQ(scores[k], expected) << positions[k].fen();
+    }
+
+    Nnue::setActive(mkRandomNnue(4));
+    BatchEvaluator nnue{pool};
+    scores = nnue.evaluate(positions);
+    for (std::size_t k = 0; k < positions.size(); ++k) {
+        EXPECT_EQ(scores[k], positions[k].toBoard().nnueEvaluate(
+                                 positions[k].sideToMove()));
+    }
+    Nnue::setActive(nullptr);
+}
+
+TEST(NnueTest, SaveAndLoad) {
+    ScopedTracer(__func__);
+    const char *path = "test_nnue.bin";
+    std::unique_ptr<Nnue> nnueP = mkRandomNnue(2);
+    ASSERT_TRUE(nnueP->save(path));
+    Board b{true};
+    Nnue::setActive(std::move(nnueP));
+    Score saved = b.nnueEvaluate(Color::White);
+    ASSERT_TRUE(Nnue::load(path));
+    EXPECT_EQ(b.nnueEvaluate(Color::White), saved); // Refreshed
+    EXPECT_FALSE(Nnue::load("no_such_file.bin"));
+    std::remove(path);
+    Nnue::setActive(nullptr);
+    EXPECT_EQ(b.nnueEvaluate(Color::White), b.evaluate(Color::White));
+}
+
+TEST(NnueTest, Trainer) {
+    ScopedTracer(__func__);
+    std::vector<LabeledPosition> batch{};
+    for (const char *line :
+         {"4k3/8/8/8/8/8/8/3QK3 w - - 0 1;1-0",
+          "4k3/8/8/8/8/8/8/3QK3 b - - 0 1;1-0",
+          "3qk3/8/8/8/8/8/8/4K3 w - - 0 1;0-1",
+          "4k3/pppppppp/8/8/8/8/PPPPPPPP/4K3 w - - 0 1;1/2-1/2",
+          "4k3/8/8/8/8/8/8/R3K3 b - - 0 1;500",
+          "4k3/8/8/8/8/8/8/4K3 w - - 0 1"}) {
+        std::optional<LabeledPosition> oLabeled = parseLabeledPosition(line);
+        if (oLabeled) {
+            batch.push_back(*oLabeled);
+        }
+    }
+    ASSERT_EQ(batch.size(), 5u); // The last line has no label
+    EXPECT_FLOAT_EQ(batch[4].result, expectedResult(500));
+
+    ThreadPool pool{2};
+    NnueTrainer trainer{pool, NnueTrainerConfig{0.003f}};
+    double initialLoss = trainer.loss(batch);
+    for (int step = 0; step < 200; ++step) {
+        trainer.trainBatch(batch);
+    }
+    EXPECT_LT(trainer.loss(batch), initialLoss / 4);
+    EXPECT_GT(trainer.evaluate(batch[0].pos), 100);
+    EXPECT_LT(trainer.evaluate(batch[2].pos), -100);
+
+    // The quantized network evaluates about as the float one does.
+    Nnue::setActive(trainer.quantize());
+    for (const LabeledPosition &labeled : batch) {
+        Board b = labeled.pos.toBoard();
+        float expected = trainer.evaluate(labeled.pos);
+        EXPECT_NEAR(b.nnueEvaluate(labeled.pos.sideToMove()), expected,
+                    10 + std::abs(expected) / 20);
+    }
+    Nnue::setActive(nullptr);
+}
@@ -0,0 +1,496 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "board.h"
+#include "move.h"
+#include "move_order.h"
+#include "ponder.h"
+#include "position.h"
+#include "search.h"
+#include "tablebase.h"
+#include "tb_generator.h"
+#include "thread_pool.h"
+#include "util.h"
+
+#include "test_common.h"
+
+TEST(SearchTest, MovePickerOrder) {
+    ScopedTracer(__func__);
+    Board b = mkCheckmatesBoard();
+    Move quiet{Color::Black, PieceType::Rook, Pos{"h5"}, Pos{"h4"}};
+    Move killer{Color::Black, PieceType::Rook, Pos{"h5"}, Pos{"g5"}};
+    Move ttMove{Color::Black, PieceType::Knight, Pos{"f4"}, Pos{"g6"}};
+    Move winningCapture{Color::Black, PieceType::Pawn, Pos{"b7"}, Pos{"c6"},
+                        b.pieceAt(Pos{"c6"}), true};
+    // Capturing a less valuable piece might lose material.
+    Move rxb{Color::Black, PieceType::Rook, Pos{"h5"}, Pos{"e5"},
+             b.pieceAt(Pos{"e5"})};
+    Move qxp{Color::Black, PieceType::Queen, Pos{"h3"}, Pos{"h2"},
+             b.pieceAt(Pos{"h2"})};
+
+    MoveOrderTables tables{};
+    tables.addKiller(2, killer.code());
+
+    MovePicker picker{Moves{quiet, qxp, killer, winningCapture, rxb, ttMove},
+                      ttMove.code(), tables, 2};
+    Moves picked{};
+    while (const Move *moveP = picker.next()) {
+        picked.push_back(*moveP);
+    }
+    Moves expected{ttMove, winningCapture, killer, quiet, rxb, qxp};
+    ASSERT_EQ(picked, expected);
+}
+
+TEST(SearchTest, MateInOne) {
+    ScopedTracer(__func__);
+    Move::reset();
+    Board b = mkCheckmatesBoard();
+    Board bRef = mkCheckmatesBoard();
+
+    Search search{SearchConfig{2, 12, true}};
+    SearchResult result = search.search(b, Color::Black);
+    ASSERT_TRUE(result.bestMove);
+    EXPECT_EQ(result.score, SCORE_MATE - 1);
+    EXPECT_EQ(b, bRef);
+    EXPECT_TRUE(Move::getMoveHistory().empty());
+}
+
+TEST(SearchTest, OrderingReducesNodes) {
+    ScopedTracer(__func__);
+    Move::reset();
+    Board b = mkCastlingBoard();
+
+    Search ordered{SearchConfig{3, 14, true}};
+    Search unordered{SearchConfig{3, 14, false}};
+    for (Search *searchP : {&ordered, &unordered}) {
+        ASSERT_TRUE(searchP->setOption("extBudget", "0")); // Same tree shape
+        // Selective search depends on move order, and so may change the score
+        for (const char *name : {"nullMove", "lmr", "rfp", "lmp"}) {
+            ASSERT_TRUE(searchP->setOption(name, "off"));
+        }
+    }
+    SearchResult orderedResult = ordered.search(b, Color::White);
+    SearchResult unorderedResult = unordered.search(b, Color::White);
+
+    EXPECT_EQ(orderedResult.score, unorderedResult.score);
+    EXPECT_LT(ordered.stats().nodes + ordered.stats().qnodes,
+              unordered.stats().nodes + unordered.stats().qnodes);
+    EXPECT_GT(ordered.stats().ordering.firstMoveCutoffRate(),
+              unordered.stats().ordering.firstMoveCutoffRate());
+}
+
+TEST(SearchTest, SelectiveSearchToggles) {
+    ScopedTracer(__func__);
+    Move::reset();
+    Board b{true};
+
+    Search selective{SearchConfig{4, 14, true}};
+    Search fullWidth{SearchConfig{4, 14, true}};
+    for (const char *name : {"nullMove", "lmr", "rfp", "lmp"}) {
+        ASSERT_TRUE(fullWidth.setOption(name, "off"));
+    }
+    ASSERT_FALSE(fullWidth.setOption("lmr", "maybe"));
+    ASSERT_FALSE(fullWidth.setOption("noSuchOption", "on"));
+
+    selective.search(b, Color::White);
+    fullWidth.search(b, Color::White);
+    const SearchStats &ss = selective.stats();
+    const SearchStats &fs = fullWidth.stats();
+    EXPECT_GT(ss.nullMoveTries + ss.lmrReductions + ss.lmpPrunes, 0);
+    EXPECT_EQ(fs.nullMoveTries + fs.lmrReductions + fs.rfpCutoffs
+                  + fs.lmpPrunes, 0);
+    EXPECT_LT(ss.nodes + ss.qnodes, fs.nodes + fs.qnodes);
+    EXPECT_EQ(b, Board{true});
+}
+
+TEST(SearchTest, SelectiveSearchFindsMate) {
+    ScopedTracer(__func__);
+    Move::reset();
+    Board b = mkCheckmatesBoard();
+
+    Search search{SearchConfig{4, 14, true}};
+    SearchResult result = search.search(b, Color::Black);
+    EXPECT_EQ(result.score, SCORE_MATE - 1);
+}
+
+TEST(SearchTest, PrincipalVariation) {
+    ScopedTracer(__func__);
+    Move::reset();
+    Board b = mkCheckmatesBoard();
+    Board bRef = mkCheckmatesBoard();
+
+    Search pvs{SearchConfig{4, 14, true}};
+    Search fullWindow{SearchConfig{4, 14, true}};
+    ASSERT_TRUE(fullWindow.setOption("pvs", "off"));
+    ASSERT_TRUE(fullWindow.setOption("aspiration", "off"));
+    SearchResult pvsResult = pvs.search(b, Color::White);
+    SearchResult fullResult = fullWindow.search(b, Color::White);
+
+    EXPECT_EQ(pvsResult.score, fullResult.score);
+    EXPECT_EQ(fullWindow.stats().pvsResearches
+                  + fullWindow.stats().aspirationResearches, 0);
+
+    // The PV starts with the best move, and each move is playable in turn.
+    ASSERT_FALSE(pvsResult.pv.empty());
+    EXPECT_EQ(pvsResult.pv.front(), *pvsResult.bestMove);
+    Color c = Color::White;
+    for (const Move &move : pvsResult.pv) {
+        ASSERT_EQ(move.color(), c);
+        move.apply(b);
+        EXPECT_FALSE(Move::isInCheck(b, c));
+        c = opponent(c);
+    }
+    for (auto it = pvsResult.pv.rbegin(); it != pvsResult.pv.rend(); ++it) {
+        it->applyUndo(b);
+    }
+    EXPECT_EQ(b, bRef);
+}
+
+TEST(SearchTest, Extensions) {
+    ScopedTracer(__func__);
+    Move::reset();
+    Board b = mkCheckmatesBoard();
+
+    Search extended{SearchConfig{5, 14, true}};
+    Search unextended{SearchConfig{5, 14, true}};
+    ASSERT_TRUE(unextended.setOption("extBudget", "0"));
+    ASSERT_FALSE(unextended.setOption("extBudget", "many"));
+    extended.search(b, Color::White);
+    unextended.search(b, Color::White);
+
+    const SearchStats &es = extended.stats();
+    const SearchStats &us = unextended.stats();
+    Short checkIndex = static_cast<Short>(Extension::Check);
+    EXPECT_GT(es.extensions[checkIndex], 0);
+    EXPECT_GE(es.extensionNodes[checkIndex], es.extensions[checkIndex]);
+    for (Short k = 0; k < EXTENSION_KINDS; ++k) {
+        EXPECT_EQ(us.extensions[k], 0) << to_string(Extension(k));
+    }
+
+    // Extensions must not hide a mate.
+    SearchResult result = extended.search(b, Color::Black);
+    EXPECT_EQ(result.score, SCORE_MATE - 1);
+}
+
+TEST(SearchTest, Mtdf) {
+    ScopedTracer(__func__);
+    Move::reset();
+    Board b = mkCheckmatesBoard();
+
+    Search mtdf{SearchConfig{4, 14, true}};
+    ASSERT_TRUE(mtdf.setOption("mtdf", "on"));
+    SearchResult result = mtdf.search(b, Color::Black);
+    EXPECT_EQ(result.score, SCORE_MATE - 1);
+    EXPECT_GT(mtdf.stats().mtdfPasses, 1);
+    EXPECT_EQ(b, mkCheckmatesBoard());
+
+    // From a FEN, via Position: Both drivers agree without selectivity.
+    const std::string fen =
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
+    Position pos = *Position::fromFen(fen);
+    Board kiwipete = pos.toBoard();
+    EXPECT_EQ(Position::fromBoard(kiwipete, Color::White), pos);
+    Search pvs{SearchConfig{2, 14, true}};
+    Search mtdf2{SearchConfig{2, 14, true}};
+    ASSERT_TRUE(mtdf2.setOption("mtdf", "on"));
+    for (Search *searchP : {&pvs, &mtdf2}) {
+        for (const char *name : {"nullMove", "lmr", "rfp", "lmp"}) {
+            ASSERT_TRUE(searchP->setOption(name, "off"));
+        }
+    }
+    EXPECT_EQ(pvs.search(kiwipete, Color::White).score,
+              mtdf2.search(kiwipete, Color::White).score);
+    EXPECT_EQ(pvs.stats().mtdfPasses, 0);
+}
+
+TEST(SearchTest, PawnHash) {
+    ScopedTracer(__func__);
+    auto bb = [](std::initializer_list<const char *> squares) {
+        Bitboard result = 0;
+        for (const char *sq : squares) {
+            result |= squareBB(Pos{sq}.index());
+        }
+        return result;
+    };
+    // White: Doubled, isolated, passed a-Pawns. Black: Isolated, passed h7.
+    PawnEntry entry = evaluatePawns(1, {bb({"h7"}), bb({"a2", "a3"})});
+    EXPECT_EQ(entry.mg, -15 - -5);
+    EXPECT_EQ(entry.eg, -20 - -5);
+    // Shield of a King on g1: f2 and g2 in place, h3 advanced.
+    entry = evaluatePawns(2, {0, bb({"f2", "g2", "h3"})});
+    EXPECT_EQ(entry.shield[colorIndex(Color::White)][6], -10);
+    EXPECT_EQ(entry.shield[colorIndex(Color::Black)][6], -75);
+
+    // Pawn structures repeat far more often than positions do.
+    Move::reset();
+    Search search{SearchConfig{3, 14, true}};
+    Board b{true};
+    search.search(b, Color::White);
+    EXPECT_GT(search.stats().pawnProbes, 0);
+    EXPECT_GT(search.stats().pawnHits * 2, search.stats().pawnProbes);
+}
+
+TEST(SearchTest, EvalCache) {
+    ScopedTracer(__func__);
+    EvalCache cache{4};
+    EXPECT_EQ(cache.size(), 16u);
+    cache.store(0x1234, 1, 57);
+    EXPECT_EQ(cache.probe(0x1234, 1), std::optional<EvalValue>{57});
+    EXPECT_FALSE(cache.probe(0x1234, 2)); // Another evaluator
+    EXPECT_FALSE(cache.probe(0x1244, 1)); // Same slot, another position
+    EXPECT_EQ(cache.hits(), 1);
+    EXPECT_EQ(cache.misses(), 2);
+
+    // The same score with and without the cache, in fewer evaluations.
+    Move::reset();
+    Search cached{SearchConfig{3, 14, true}};
+    Search uncached{SearchConfig{3, 14, true}};
+    EXPECT_TRUE(uncached.setOption("evalCache", "0"));
+    EXPECT_FALSE(uncached.setOption("evalCache", "-1"));
+    EXPECT_FALSE(uncached.setOption("evalCache", "64"));
+    EXPECT_FALSE(uncached.setOption("evalCache", "99999999999"));
+    EXPECT_EQ(uncached.config().evalCacheSizeLog2, 0);
+    Board b{true};
+    SearchResult cachedResult = cached.search(b, Color::White);
+    SearchResult uncachedResult = uncached.search(b, Color::White);
+    EXPECT_EQ(cachedResult.score, uncachedResult.score);
+    EXPECT_GT(cached.stats().evalCacheHits, 0);
+    EXPECT_EQ(uncached.stats().evalCacheHits, 0);
+    EXPECT_LT(cached.stats().pawnProbes, uncached.stats().pawnProbes);
+
+    // Batch analysis: A repeated position is evaluated from the cache.
+    std::vector<std::pair<Board, Color>> positions;
+    positions.emplace_back(Board{true}, Color::White);
+    positions.emplace_back(Board{true}, Color::White);
+    cached.clear();
+    cached.analyze(positions, 1);
+    EXPECT_GT(cached.stats().evalCacheHits * 2,
+              cached.stats().evalCacheProbes);
+}
+
+TEST(SearchTest, LazyEval) {
+    ScopedTracer(__func__);
+    // White wins the Queen. Most quiescence nodes are far outside the window.
+    Position pos = *Position::fromFen("4k3/8/8/3q4/8/8/3R4/4K3 w - - 0 1");
+    SearchResult results[2];
+    for (bool useLazyEval : {false, true}) {
+        Move::reset();
+        Board b = pos.toBoard();
+        Search search{SearchConfig{3, 14, true}};
+        search.config().useLazyEval = useLazyEval;
+        search.config().verifyLazyEval = true;
+        results[useLazyEval] = search.search(b, Color::White);
+        const SearchStats &stats = search.stats();
+        long long exits = 0;
+        for (Short k = 0; k < EVAL_STAGES; ++k) {
+            exits += stats.lazyExits[k];
+            EXPECT_EQ(stats.lazyMisses[k], 0);
+        }
+        EXPECT_EQ(exits > 0, useLazyEval);
+    }
+    ASSERT_TRUE(results[0].bestMove && results[1].bestMove);
+    EXPECT_EQ(*results[0].bestMove, *results[1].bestMove);
+    EXPECT_GT(results[1].score, 500);
+}
+
+TEST(SearchTest, MultiPv) {
+    ScopedTracer(__func__);
+    Move::reset();
+    Board b = mkCheckmatesBoard();
+    Board bRef = mkCheckmatesBoard();
+
+    Search search{SearchConfig{3, 14, true}};
+    std::vector<SearchResult> results = search.searchMultiPv(b, Color::Black, 4);
+    ASSERT_EQ(results.size(), 4u);
+    EXPECT_EQ(results[0].score, SCORE_MATE - 1);
+    for (Short k = 0; k < Short(results.size()); ++k) {
+        ASSERT_TRUE(results[k].bestMove);
+        EXPECT_EQ(results[k].pv.front(), *results[k].bestMove);
+        EXPECT_GE(results[0].score, results[k].score);
+        for (Short j = 0; j < k; ++j) {
+            EXPECT_FALSE(*results[j].bestMove == *results[k].bestMove);
+        }
+    }
+    EXPECT_GT(search.tt().hits(), 0);
+    EXPECT_EQ(b, bRef);
+
+    // Batch analysis
+    std::vector<std::pair<Board, Color>> positions{
+        {Board{true}, Color::White}, {mkCheckmatesBoard(), Color::Black}};
+    std::vector<std::vector<SearchResult>> analyses =
+        search.analyze(positions, 2);
+    ASSERT_EQ(analyses.size(), 2u);
+    EXPECT_EQ(analyses[0].size(), 2u);
+    EXPECT_EQ(analyses[1][0].score, SCORE_MATE - 1);
+
+    // Without an iteration to complete, there is no move to report.
+    search.config().maxDepth = 0;
+    results = search.searchMultiPv(b, Color::Black, 4);
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_FALSE(results[0].bestMove);
+}
+
+TEST(SearchTest, Pondering) {
+    ScopedTracer(__func__);
+    Move::reset();
+    Board b{true};
+    Search &search = Search::forColor(Color::White);
+    search.clear();
+    search.config().maxDepth = 3;
+    search.timeManager().startUnlimited();
+
+    ExtMove botMove = Search::strategyAlphaBeta(
+        b, Color::White, Move::getValidPlayerMoves(b, Color::White));
+    OptMove predicted = search.predictedReply();
+    ASSERT_TRUE(botMove.optMove);
+    ASSERT_TRUE(predicted);
+    botMove.optMove->apply(b);
+    Board bRef = b.clone();
+
+    // The human plays the predicted reply: A hit.
+    Ponderer ponderer{};
+    ponderer.start(search, b, Color::Black);
+    while (!ponderer.isDone()) { // To maxDepth, however long that takes
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+    ponderer.stop(predicted);
+    EXPECT_EQ(ponderer.hits(), 1);
+    EXPECT_EQ(b, bRef);
+    Moves history = Move::getMoveHistory();
+    ASSERT_EQ(history.size(), 1u); // The pondering thread had its own
+
+    // The bot's search does not run again for the pondered position.
+    predicted->apply(b);
+    long long nodesBefore = search.stats().nodes;
+    ExtMove ponderedMove = Search::strategyAlphaBeta(
+        b, Color::White, Move::getValidPlayerMoves(b, Color::White));
+    EXPECT_TRUE(ponderedMove.optMove);
+    EXPECT_EQ(search.stats().nodes, nodesBefore);
+
+    // No prediction matches: A miss.
+    ponderer.start(search, b, Color::Black);
+    ponderer.stop(std::nullopt);
+    ponderer.start(search, b, Color::Black);
+    ponderer.stop(Move{Color::Black, PieceType::Pawn, Pos{"a7"}, Pos{"a6"}});
+    EXPECT_EQ(ponderer.misses(), 1);
+    search.clear();
+}
+
+TEST(SearchTest, PonderingTimed) {
+    ScopedTracer(__func__);
+    Move::reset();
+    Board b{true};
+    Search &search = Search::forColor(Color::White);
+    search.clear();
+    search.config().maxDepth = 2;
+    ExtMove botMove = Search::strategyAlphaBeta(
+        b, Color::White, Move::getValidPlayerMoves(b, Color::White));
+    OptMove predicted = search.predictedReply();
+    ASSERT_TRUE(botMove.optMove);
+    ASSERT_TRUE(predicted);
+    botMove.optMove->apply(b);
+
+    // Under a clock, the depth is unlimited (as with chess -t), so pondering
+    // only ends when the human moves. Once it took the bot's soft limit, a
+    // hit is played without searching again.
+    ChessClock clock{TimeControl{Millis{1'000}, Millis{0}}};
+    Search::setClock(&clock);
+    search.config().maxDepth = MAX_PLY - 1;
+    TimeManager budget{};
+    budget.start(clock.remaining(Color::White), Millis{0});
+    Ponderer ponderer{};
+    ponderer.start(search, b, Color::Black);
+    while (search.timeManager().elapsed() <= budget.softLimit()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+    ponderer.stop(predicted);
+    EXPECT_EQ(ponderer.hits(), 1);
+    predicted->apply(b);
+    long long nodesBefore = search.stats().nodes;
+    botMove = Search::strategyAlphaBeta(
+        b, Color::White, Move::getValidPlayerMoves(b, Color::White));
+    ASSERT_TRUE(botMove.optMove);
+    EXPECT_EQ(search.stats().nodes, nodesBefore);
+    predicted = search.predictedReply();
+    ASSERT_TRUE(predicted);
+    botMove.optMove->apply(b);
+
+    // A hit pondered for much less than the budget is searched again.
+    ChessClock slowClock{TimeControl{Millis{600'000}, Millis{0}}};
+    Search::setClock(&slowClock);
+    search.config().maxDepth = 4; // Well within the budget
+    ponderer.start(search, b, Color::Black);
+    ponderer.stop(predicted);
+    EXPECT_EQ(ponderer.hits(), 2);
+    predicted->apply(b);
+    nodesBefore = search.stats().nodes;
+    botMove = Search::strategyAlphaBeta(
+        b, Color::White, Move::getValidPlayerMoves(b, Color::White));
+    EXPECT_TRUE(botMove.optMove);
+    EXPECT_GT(search.stats().nodes, nodesBefore);
+
+    Search::setClock(nullptr);
+    search.config().maxDepth = SearchConfig{}.maxDepth;
+    search.clear();
+}
+
+TEST(SearchTest, Tablebases) {
+    ScopedTracer(__func__);
+    ThreadPool pool{2};
+    auto tablesP = std::make_unique<Tablebases>(""); // In memory
+    TbGenerator generator{pool, *tablesP};
+    ASSERT_TRUE(generator.generate(*Material::fromString("KQvK")));
+    Tablebases::setActive(std::move(tablesP));
+    const Tablebases &tables = *Tablebases::active();
+
+    // At the root: The fastest mate, without a search
+    Position pos = *Position::fromFen("8/8/8/4k3/8/8/8/1K5Q w - - 0 1");
+    TbValue rootValue = *tables.probe(pos);
+    ASSERT_TRUE(isTbWin(rootValue));
+    Move::reset();
+    Board b = pos.toBoard();
+    Search search{SearchConfig{3, 14, true}};
+    SearchResult result = search.search(b, Color::White);
+    ASSERT_TRUE(result.bestMove);
+    EXPECT_EQ(result.score, SCORE_MATE - tbPlies(rootValue));
+    EXPECT_EQ(search.stats().nodes, 0);
+    EXPECT_EQ(result.pv.size(), 3u);
+    result.bestMove->apply(b);
+    EXPECT_EQ(tbParent(*tables.probe(Position::fromBoard(b, Color::Black))),
+              rootValue);
+    result.bestMove->applyUndo(b);
+
+    // Below the root: Winning the Rook leads to a covered ending.
+    for (bool useTablebases : {true, false}) {
+        Move::reset();
+        b = Position::fromFen("r7/8/8/4k3/8/8/8/1K5Q w - - 0 1")->toBoard();
+        search.config().useTablebases = useTablebases;
+        result = search.search(b, Color::White);
+        ASSERT_TRUE(result.bestMove);
+        EXPECT_TRUE(result.bestMove->isCapture());
+        EXPECT_EQ(result.score >= SCORE_TB_WIN_BOUND, useTablebases);
+        EXPECT_EQ(search.stats().tbHits > 0, useTablebases);
+    }
+    Tablebases::setActive(nullptr);
+}
@@ -0,0 +1,249 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "position.h"
+#include "tablebase.h"
+#include "tb_generator.h"
+#include "thread_pool.h"
+#include "util.h"
+
+#include "test_common.h"
+
+TbValue probeFen(Tablebases &tables, const std::string &fen) {
+    std::optional<TbValue> oValue = tables.probe(*Position::fromFen(fen));
+    return oValue ? *oValue : TB_BROKEN;
+}
+
+TEST(TablebaseTest, Material) {
+    ScopedTracer(__func__);
+    std::optional<Material> oMaterial = Material::fromString("KpvKRr");
+    ASSERT_TRUE(oMaterial);
+    EXPECT_EQ(oMaterial->name(), "KPvKRR");
+    EXPECT_EQ(oMaterial->pieceCount(), 5);
+    EXPECT_FALSE(oMaterial->isCanonical());
+    EXPECT_EQ(oMaterial->canonical().name(), "KRRvKP");
+    EXPECT_FALSE(Material::fromString("KQK"));
+    EXPECT_FALSE(Material::fromString("KQvKK"));
+
+    std::vector<std::string> names;
+    for (const Material &m : Material::fromString("KPvKN")->children()) {
+        names.push_back(m.name());
+    }
+    std::vector<std::string> expected{"KNvK", "KPvK", "KQvKN", "KRvKN",
+                                      "KBvKN", "KNvKN", "KQvK", "KRvK",
+                                      "KBvK"};
+    std::sort(names.begin(), names.end());
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(names, expected);
+    EXPECT_EQ(Material::all(3).size(), 5u);
+    EXPECT_EQ(Material::all(4).size(), 30u); // 15 on one side, 15 split
+}
+
+TEST(TablebaseTest, Generate) {
+    ScopedTracer(__func__);
+    ThreadPool pool{2};
+    Tablebases tables{"."};
+    std::vector<TbGenStats> reports;
+    TbGenerator generator{pool, tables, [&reports](const TbGenStats &s) {
+        reports.push_back(s);
+    }};
+    ASSERT_TRUE(generator.generate(*Material::fromString("KvKQ")));
+    ASSERT_TRUE(generator.generate(*Material::fromString("KRvK")));
+    ASSERT_EQ(reports.size(), 2u);
+    EXPECT_EQ(reports[0].longestWin, 19); // Mate in 10
+    EXPECT_EQ(reports[1].longestWin, 31); // Mate in 16
+    EXPECT_TRUE(reports[0].isSaved);
+
+    // Either way round
+    EXPECT_EQ(probeFen(tables, "k7/8/1K6/8/8/8/7Q/8 w - - 0 1"), tbWin(1));
+    EXPECT_EQ(probeFen(tables, "K7/8/1k6/8/8/8/7q/8 b - - 0 1"), tbWin(1));
+    EXPECT_EQ(probeFen(tables, "k7/2Q5/1K6/8/8/8/8/8 b - - 0 1"), TB_DRAW);
+    EXPECT_EQ(probeFen(tables, "k7/7Q/1K6/8/8/8/8/8 b - - 0 1"), tbLoss(2));
+    EXPECT_EQ(probeFen(tables, "8/8/3k4/8/8/8/8/K7 w - - 0 1"), TB_DRAW);
+    EXPECT_FALSE(tables.probe(*Position::fromFen(START_FEN)));
+
+    // Each value is the best over the moves, by the tables. The tables are
+    // mapped from their files by now.
+    const Tablebase *tableP = tables.find(*Material::fromString("KQvK"));
+    ASSERT_TRUE(tableP);
+    EXPECT_TRUE(tableP->isMapped());
+    EXPECT_EQ(tableP->fileSize(), reports[0].fileSize);
+    const TbIndexer &indexer = tableP->indexer();
+    long long mismatches = 0;
+    for (Color c : allColors) {
+        for (std::size_t i = 0; i < indexer.size(); ++i) {
+            TbSquares squares;
+            if (!indexer.decode(i, squares) || indexer.index(squares) != i) {
+                continue; // Not a position
+            }
+            Position pos = indexer.toPosition(squares, c);
+            if (pos.isAttacked(pos.kingSquare(opponent(c)), c)) {
+                continue; // Broken: The side not to move is in check
+            }
+            TbValue v = tableP->value(c, i);
+            FastMoves moves{};
+            pos.legalMoves(moves);
+            TbValue best = pos.isInCheck() ? tbLoss(0) : TB_DRAW;
+            PositionUndo undo;
+            for (Short k = 0; k < moves.size(); ++k) {
+                pos.makeMove(moves[k], undo);
+                TbValue childValue = tbParent(*tables.probe(pos));
+                pos.unmakeMove(moves[k], undo);
+                if (k == 0 || tbRank(childValue) > tbRank(best)) {
+                    best = childValue;
+                }
+            }
+            mismatches += v == best ? 0 : 1;
+        }
+    }
+    EXPECT_EQ(mismatches, 0);
+
+    // A table in use is never replaced.
+    std::optional<Tablebase> oReloaded =
+        Tablebase::load(Tablebases::path(".", *Material::fromString("KQvK")));
+    ASSERT_TRUE(oReloaded);
+    EXPECT_EQ(&tables.add(std::move(*oReloaded)), tableP);
+
+    // Loaded from the files by another Tablebases
+    Tablebases loaded{"."};
+    EXPECT_EQ(loaded.size(), 2u);
+    EXPECT_EQ(loaded.maxPieces(), 3);
+    EXPECT_EQ(probeFen(loaded, "k7/8/1K6/8/8/8/7Q/8 w - - 0 1"), tbWin(1));
+    std::remove(Tablebases::path(".", *Material::fromString("KQvK")).c_str());
+    std::remove(Tablebases::path(".", *Material::fromString("KRvK")).c_str());
+    EXPECT_FALSE(Tablebases{"."}.find(*Material::fromString("KQvK")));
+}
+
+TEST(TablebaseTest, Corrupt) {
+    ScopedTracer(__func__);
+    ThreadPool pool{2};
+    Material kqk = *Material::fromString("KQvK");
+    Tablebases tables{"."};
+    ASSERT_TRUE(TbGenerator(pool, tables).generate(kqk));
+    std::string path = Tablebases::path(".", kqk);
+    std::ifstream ifs{path, std::ios::binary};
+    std::vector<char> bytes{std::istreambuf_iterator<char>{ifs},
+                            std::istreambuf_iterator<char>{}};
+    std::remove(path.c_str());
+    // The header, with "KQvK" padded to 8 bytes, then Black's offsets
+    constexpr std::size_t OFFSETS_START = 24;
+    std::size_t blockCount =
+        (tables.find(kqk)->indexer().size() + TB_BLOCK_VALUES - 1)
+        / TB_BLOCK_VALUES;
+    ASSERT_GE(blockCount, 3u);
+    std::size_t blocksStart = OFFSETS_START
+        + COLORS_COUNT * (blockCount + 1) * sizeof(std::uint64_t);
+    const std::string corruptPath = "./corrupt_tablebase_test";
+    auto loadCorrupt = [&](const std::vector<char> &corrupt) {
+        std::ofstream{corruptPath, std::ios::binary}.write(corrupt.data(),
+                                                           corrupt.size());
+        std::optional<Tablebase> oTable = Tablebase::load(corruptPath);
+        std::remove(corruptPath.c_str());
+        return oTable;
+    };
+    ASSERT_TRUE(loadCorrupt(bytes));
+
+    // A middle block offset past the next one, or before the previous one
+    for (std::uint64_t offset : {std::uint64_t{1} << 40, std::uint64_t{0}}) {
+        std::vector<char> corrupt{bytes};
+        std::memcpy(&corrupt[OFFSETS_START + 2 * sizeof offset], &offset,
+                    sizeof offset);
+        EXPECT_FALSE(loadCorrupt(corrupt));
+    }
+
+    // A palette too small for the codes of Black's first block, or too
+    // large for the block: Its values are broken.
+    for (std::uint16_t paletteSize : {0, 0xffff}) {
+        std::vector<char> corrupt{bytes};
+        std::memcpy(&corrupt[blocksStart + 1], &paletteSize,
+                    sizeof paletteSize);
+        std::optional<Tablebase> oTable = loadCorrupt(corrupt);
+        ASSERT_TRUE(oTable);
+        for (std::size_t i = 0; i < TB_BLOCK_VALUES; ++i) {
+            ASSERT_EQ(oTable->value(Color::Black, i), TB_BROKEN);
+        }
+    }
+}
+
+TEST(TablebaseTest, Pawns) {
+    ScopedTracer(__func__);
+    ThreadPool pool{2};
+    Tablebases tables{""}; // In memory
+    TbGenerator generator{pool, tables};
+    ASSERT_TRUE(generator.generate(*Material::fromString("KPvK")));
+    // The defending King in front of the Pawn holds; the attacking King in
+    // front of it wins, whoever is to move.
+    EXPECT_EQ(probeFen(tables, "8/8/8/8/8/4k3/4P3/4K3 w - - 0 1"), TB_DRAW);
+    EXPECT_TRUE(isTbWin(probeFen(tables, "4k3/8/4K3/4P3/8/8/8/8 w - - 0 1")));
+    EXPECT_TRUE(
+        isTbLoss(probeFen(tables, "4k3/8/4K3/4P3/8/8/8/8 b - - 0 1")));
+    // A Rook Pawn with the defending King in the corner is drawn.
+    EXPECT_EQ(probeFen(tables, "k7/8/1K6/P7/8/8/8/8 w - - 0 1"), TB_DRAW);
+    EXPECT_EQ(probeFen(tables, "8/8/8/8/8/1k6/p7/K7 w - - 0 1"),
+              probeFen(tables, "k7/P7/1K6/8/8/8/8/8 b - - 0 1"));
+}
+
+TEST(TablebaseTest, OutOfCore) {
+    ScopedTracer(__func__);
+    ThreadPool pool{2};
+    Material krk = *Material::fromString("KRvK");
+    Tablebases inMemory{""};
+    TbGenerator{pool, inMemory}.generate(krk);
+
+    // Stopped after its first checkpoint, then resumed by another run
+    Tablebases tables{"."};
+    TbGenerator stopped{pool, tables};
+    stopped.setScratch(".", 0);
+    stopped.stop();
+    EXPECT_FALSE(stopped.generate(krk));
+    EXPECT_FALSE(tables.find(krk));
+    std::vector<TbGenStats> reports;
+    TbGenerator generator{pool, tables, [&reports](const TbGenStats &s) {
+        reports.push_back(s);
+    }};
+    generator.setScratch(".", 0);
+    ASSERT_TRUE(generator.generate(krk));
+    ASSERT_EQ(reports.size(), 1u);
+    EXPECT_TRUE(reports[0].isOutOfCore);
+    EXPECT_EQ(reports[0].resumedAfter, std::optional<Short>{0});
+    EXPECT_EQ(reports[0].longestWin, 31);
+    EXPECT_FALSE(std::ifstream{"./KRvK.checkpoint"}); // Scratch removed
+
+    const Tablebase &expected = *inMemory.find(krk);
+    const Tablebase &actual = *tables.find(krk);
+    const TbIndexer &indexer = expected.indexer();
+    long long mismatches = 0;
+    for (Color c : allColors) {
+        for (std::size_t i = 0; i < indexer.size(); ++i) {
+            TbValue v = expected.value(c, i);
+            mismatches += v == TB_BROKEN || v == actual.value(c, i) ? 0 : 1;
+        }
+    }
+    EXPECT_EQ(mismatches, 0);
+    std::remove(Tablebases::path(".", krk).c_str());
+}
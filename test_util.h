@@ -16,7 +16,11 @@
 
 #pragma once
 
+#include <atomic>
+#include <vector>
+
 #include "geometry.h"
+#include "thread_pool.h"
 #include "util.h"
 
 TEST(UtilTest, UtilMisc) {
@@ -32,3 +36,21 @@ TEST(UtilTest, UtilMisc) {
 
     EXPECT_EQ(knightDirs.size(), (unsigned long)8);
 }
+
+TEST(UtilTest, ThreadPool) {
+    ScopedTracer(__func__);
+    ThreadPool pool{3};
+    EXPECT_EQ(pool.size(), 3);
+    std::vector<int> visits(1000);
+    std::atomic<int> workerMask{0};
+    for (int job = 0; job < 3; ++job) { // Workers wait between jobs
+        pool.parallelFor(visits.size(), [&](std::size_t i, Short worker) {
+            ++visits[i];
+            workerMask |= 1 << worker;
+        }, 7);
+    }
+    for (int v : visits) {
+        EXPECT_EQ(v, 3);
+    }
+    EXPECT_EQ(workerMask & ~7, 0);
+}
@@ -0,0 +1,440 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iomanip>
+
+#include "texel_tuner.h"
+
+using std::string, std::vector;
+
+namespace {
+
+// ---------- Adam
+constexpr float BETA1 = 0.9f;
+constexpr float BETA2 = 0.999f;
+constexpr float EPSILON = 1e-8f;
+
+constexpr Short MAX_QUIESCE_PLY = 16; // Longer capture sequences stand pat
+
+// The endgame param paired with a middlegame param (see eval.h).
+int egParamOf(int mgParam) {
+    if (mgParam < EP_EG_MATERIAL) {
+        return mgParam + PIECE_TYPES_COUNT;
+    }
+    if (mgParam >= EP_MG_PST && mgParam < EP_EG_PST) {
+        return mgParam + PIECE_TYPES_COUNT * BOARD_SPACES;
+    }
+    if (mgParam >= EP_DOUBLED && mgParam < EP_MG_PASSED) {
+        return mgParam + 1;
+    }
+    if (mgParam >= EP_MG_PASSED && mgParam < EP_EG_PASSED) {
+        return mgParam + BOARD_ROWS;
+    }
+    if (mgParam >= EP_MG_MOBILITY && mgParam < EP_EG_MOBILITY) {
+        return mgParam + PIECE_TYPES_COUNT;
+    }
+    return NO_EVAL_PARAM;
+}
+
+// Call term(c, mgParam, egParam, count) for each evaluation term of pos, as
+// in Board::evaluate, evaluatePawns and evaluateMobility. Returns the phase.
+template <typename Term>
+Short visitTerms(const Position &pos, Term &&term) {
+    PieceBitboards pieces{};
+    PawnBitboards pawns{};
+    for (Color c : {Color::Black, Color::White}) {
+        for (Short pt = 0; pt < PIECE_TYPES_COUNT; ++pt) {
+            pieces[colorIndex(c)][pt] = pos.pieces(c, PieceType(pt));
+        }
+        pawns[colorIndex(c)] = pos.pieces(c, PieceType::Pawn);
+    }
+    Short phase = 0;
+    for (Color c : {Color::Black, Color::White}) {
+        auto colorTerm = [&](int mgParam, int egParam, int count) {
+            term(c, mgParam, egParam, count);
+        };
+        for (Short pt = 0; pt < PIECE_TYPES_COUNT; ++pt) {
+            for (Bitboard bb = pos.pieces(c, PieceType(pt)); bb;) {
+                Square sq = popLsb(bb);
+                int entry = pt * BOARD_SPACES + pstEntry(c, sq);
+                colorTerm(EP_MG_MATERIAL + pt, EP_EG_MATERIAL + pt, 1);
+                colorTerm(EP_MG_PST + entry, EP_EG_PST + entry, 1);
+                phase += PHASE_WEIGHTS[pt];
+            }
+        }
+        visitPawnTerms(c, pawns, colorTerm);
+        Square kingSq = pos.kingSquare(c);
+        if (relativeRow(c, squareRow(kingSq)) <= 1) {
+            visitShieldTerms(c, pawns[colorIndex(c)], squareCol(kingSq),
+                             colorTerm);
+        }
+        visitMobilityTerms(c, pieces, colorTerm);
+    }
+    return std::min(phase, PHASE_MAX);
+}
+
+} // namespace
+
+void writeEvalParams(std::ostream &os, const EvalParams &params,
+                     const string &source)
+{
+    struct Section {
+        string title;
+        int begin;
+        int count;
+    };
+    const string pieceNames[PIECE_TYPES_COUNT] = {
+        "King", "Queen", "Rook", "Bishop", "Knight", "Pawn"};
+    vector<Section> sections{
+        {"Material (mg): King, Queen, Rook, Bishop, Knight, Pawn",
+         EP_MG_MATERIAL, PIECE_TYPES_COUNT},
+        {"Material (eg)", EP_EG_MATERIAL, PIECE_TYPES_COUNT}};
+    for (int phase = 0; phase < 2; ++phase) {
+        for (Short pt = 0; pt < PIECE_TYPES_COUNT; ++pt) {
+            sections.push_back(
+                {string{"Piece-square table ("} + (phase == 0 ? "mg" : "eg")
+                     + "): " + pieceNames[pt],
+                 (phase == 0 ? EP_MG_PST : EP_EG_PST) + pt * BOARD_SPACES,
+                 BOARD_SPACES});
+        }
+    }
+    sections.push_back({"Doubled, isolated and backward Pawn (mg, eg)",
+                        EP_DOUBLED, EP_MG_PASSED - EP_DOUBLED});
+    sections.push_back({"Passed Pawn, by relative row (mg)", EP_MG_PASSED,
+                        BOARD_ROWS});
+    sections.push_back({"Passed Pawn, by relative row (eg)", EP_EG_PASSED,
+                        BOARD_ROWS});
+    sections.push_back({"Shield Pawn advanced, shield Pawn missing (mg)",
+                        EP_SHIELD_ADVANCED, 2});
+    sections.push_back({"Mobility, per safe square (mg), by PieceType",
+                        EP_MG_MOBILITY, PIECE_TYPES_COUNT});
+    sections.push_back({"Mobility, per safe square (eg)", EP_EG_MOBILITY,
+                        PIECE_TYPES_COUNT});
+    sections.push_back({"King zone attack, per square (mg), by PieceType",
+                        EP_KING_ATTACK, PIECE_TYPES_COUNT});
+
+    os << "// Games_Chess\n"
+          "// Copyright (C) 2021, by Jay M. Coskey\n"
+          "//\n"
+          "// This program is free software: you can redistribute it and/or"
+          " modify\n"
+          "// it under the terms of the GNU General Public License as"
+          " published by\n"
+          "// the Free Software Foundation, either version 3 of the License,"
+          " or\n"
+          "// (at your option) any later version.\n"
+          "//\n"
+          "// This program is distributed in the hope that it will be useful,"
+          "\n"
+          "// but WITHOUT ANY WARRANTY; without even the implied warranty of\n"
+          "// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the\n"
+          "// GNU General Public License for more details.\n"
+          "//\n"
+          "// You should have received a copy of the GNU General Public"
+          " License\n"
+          "// along with this program.  If not, see"
+          " <http://www.gnu.org/licenses/>.\n"
+          "\n"
+          "// Evaluation parameters, in centipawns, in the index layout of"
+          " eval.h (see\n"
+          "// EvalParams). Written by tune_eval from: "
+       << source << "\n\n"
+       << "#pragma once\n\n#include <array>\n\n// clang-format off\n"
+       << "inline constexpr std::array<int, " << EVAL_PARAM_COUNT
+       << "> EVAL_PARAMS{\n";
+    for (const Section &section : sections) {
+        os << "    // " << section.title << "\n";
+        for (int k = 0; k < section.count; ++k) {
+            os << (k % BOARD_COLS == 0 ? "    " : " ") << std::setw(4)
+               << params[section.begin + k] << ",";
+            if (k % BOARD_COLS == BOARD_COLS - 1 || k == section.count - 1) {
+                os << "\n";
+            }
+        }
+    }
+    os << "};\n// clang-format on\n";
+}
+
+// ========================================
+// TexelTuner
+
+// ---------- Constructor
+TexelTuner::TexelTuner(ThreadPool &pool,
+                       const TexelTunerConfig &config /* =TexelTunerConfig{} */,
+                       const EvalParams &params /* =EVAL_PARAMS */)
+    : _poolP{&pool}, _config{config}, _step{0},
+      _params(params.begin(), params.end()), _egParams(EVAL_PARAM_COUNT),
+      _m(EVAL_PARAM_COUNT, 0.0f), _v(EVAL_PARAM_COUNT, 0.0f),
+      _workerGrads(pool.size(), vector<double>(EVAL_PARAM_COUNT))
+{
+    for (int param = 0; param < EVAL_PARAM_COUNT; ++param) {
+        _egParams[param] = egParamOf(param);
+    }
+}
+
+// ---------- Read methods
+float TexelTuner::evaluate(const Position &pos) const {
+    float mg = 0.0f;
+    float eg = 0.0f;
+    Short phase = visitTerms(pos, [&](Color c, int mgParam, int egParam,
+                                      int count) {
+        int signedCount = c == Color::White ? count : -count;
+        mg += signedCount * _params[mgParam];
+        if (egParam != NO_EVAL_PARAM) {
+            eg += signedCount * _params[egParam];
+        }
+    });
+    float whiteValue = (mg * phase + eg * (PHASE_MAX - phase)) / PHASE_MAX;
+    return pos.sideToMove() == Color::White ? whiteValue : -whiteValue;
+}
+
+double TexelTuner::error() const { return _error(_config.scale); }
+
+EvalParams TexelTuner::params() const {
+    EvalParams result{};
+    for (int param = 0; param < EVAL_PARAM_COUNT; ++param) {
+        result[param] = EvalValue(std::lround(_params[param]));
+    }
+    return result;
+}
+
+// ---------- Write methods
+void TexelTuner::addPositions(const vector<LabeledPosition> &batch) {
+    vector<vector<TexelTerm>> batchTerms(batch.size());
+    vector<Short> phases(batch.size());
+    _poolP->parallelFor(batch.size(), [&](std::size_t k, Short) {
+        Position pos = batch[k].pos;
+        Position leaf{};
+        _quiesce(pos, -INFINITY, INFINITY, 0, leaf);
+        phases[k] = _collectTerms(leaf, batchTerms[k]);
+    }, 64);
+    for (std::size_t k = 0; k < batch.size(); ++k) {
+        _positions.push_back(Entry{batch[k].result,
+                                   std::uint32_t(_terms.size()),
+                                   std::uint8_t(batchTerms[k].size()),
+                                   std::uint8_t(phases[k])});
+        const vector<TexelTerm> &terms = batchTerms[k];
+        _terms.insert(_terms.end(), terms.begin(), terms.end());
+    }
+}
+
+double TexelTuner::fitScale() {
+    // The error is unimodal in the scale: Golden-section search.
+    const double ratio = (std::sqrt(5.0) - 1) / 2;
+    double lo = 50.0;
+    double hi = 2000.0;
+    double a = hi - ratio * (hi - lo);
+    double b = lo + ratio * (hi - lo);
+    double errorA = _error(a);
+    double errorB = _error(b);
+    while (hi - lo > 1.0) {
+        if (errorA < errorB) {
+            hi = b;
+            b = a;
+            errorB = errorA;
+            a = hi - ratio * (hi - lo);
+            errorA = _error(a);
+        } else {
+            lo = a;
+            a = b;
+            errorA = errorB;
+            b = lo + ratio * (hi - lo);
+            errorB = _error(b);
+        }
+    }
+    _config.scale = float((lo + hi) / 2);
+    return error();
+}
+
+double TexelTuner::step() {
+    vector<double> errors(_poolP->size(), 0.0);
+    for (vector<double> &grads : _workerGrads) {
+        std::fill(grads.begin(), grads.end(), 0.0);
+    }
+    _poolP->parallelFor(_positions.size(), [&](std::size_t k, Short worker) {
+        const Entry &entry = _positions[k];
+        const TexelTerm *terms = &_terms[entry.firstTerm];
+        float eval = _evaluate(terms, entry.termCount, entry.phase);
+        float predicted = expectedResult(eval, _config.scale);
+        float diff = predicted - entry.result;
+        errors[worker] += diff * diff;
+        // d(diff^2)/d(eval), then split by phase
+        double g = 2.0 * diff * predicted * (1 - predicted) / _config.scale;
+        double gMg = g * entry.phase / PHASE_MAX;
+        double gEg = g * (PHASE_MAX - entry.phase) / PHASE_MAX;
+        vector<double> &grads = _workerGrads[worker];
+        for (Short t = 0; t < entry.termCount; ++t) {
+            grads[terms[t].param] += gMg * terms[t].count;
+            int egParam = _egParams[terms[t].param];
+            if (egParam != NO_EVAL_PARAM) {
+                grads[egParam] += gEg * terms[t].count;
+            }
+        }
+    }, 1024);
+
+    ++_step;
+    double n = std::max<std::size_t>(_positions.size(), 1);
+    float stepSize = _config.learningRate
+                   * std::sqrt(1 - std::pow(BETA2, _step))
+                   / (1 - std::pow(BETA1, _step));
+    for (int param = 0; param < EVAL_PARAM_COUNT; ++param) {
+        double sum = 0.0;
+        for (const vector<double> &grads : _workerGrads) {
+            sum += grads[param];
+        }
+        float grad = float(sum / n);
+        _m[param] = BETA1 * _m[param] + (1 - BETA1) * grad;
+        _v[param] = BETA2 * _v[param] + (1 - BETA2) * grad * grad;
+        _params[param] -= stepSize * _m[param] / (std::sqrt(_v[param])
+                                                  + EPSILON);
+    }
+    double errorSum = 0.0;
+    for (double e : errors) {
+        errorSum += e;
+    }
+    return errorSum / n;
+}
+
+// ---------- Private read methods
+Short TexelTuner::_collectTerms(const Position &pos,
+                                vector<TexelTerm> &terms) const
+{
+    terms.clear();
+    Short phase = visitTerms(pos, [&](Color c, int mgParam,
+                                      [[maybe_unused]] int egParam,
+                                      int count) {
+        assert(egParam == _egParams[mgParam]);
+        terms.push_back(TexelTerm{
+            std::uint16_t(mgParam),
+            std::int16_t(c == Color::White ? count : -count)});
+    });
+
+    // Merge the terms of each param, e.g., a White and a Black Pawn.
+    std::sort(terms.begin(), terms.end(),
+              [](const TexelTerm &a, const TexelTerm &b) {
+                  return a.param < b.param;
+              });
+    std::size_t size = 0;
+    for (const TexelTerm &t : terms) {
+        if (size > 0 && terms[size - 1].param == t.param) {
+            terms[size - 1].count += t.count;
+        } else {
+            terms[size++] = t;
+        }
+    }
+    terms.erase(std::remove_if(terms.begin(), terms.begin() + size,
+                               [](const TexelTerm &t) { return t.count == 0; }),
+                terms.end());
+    return phase;
+}
+
+// White's point of view
+float TexelTuner::_evaluate(const TexelTerm *terms, Short count,
+                            Short phase) const
+{
+    float mg = 0.0f;
+    float eg = 0.0f;
+    for (Short t = 0; t < count; ++t) {
+        mg += terms[t].count * _params[terms[t].param];
+        int egParam = _egParams[terms[t].param];
+        if (egParam != NO_EVAL_PARAM) {
+            eg += terms[t].count * _params[egParam];
+        }
+    }
+    return (mg * phase + eg * (PHASE_MAX - phase)) / PHASE_MAX;
+}
+
+// Fail-soft quiescence search over captures and Queen promotions, from the
+// point of view of the side to move. leaf is set to the quiet position at
+// the end of the principal variation.
+float TexelTuner::_quiesce(Position &pos, float alpha, float beta, Short ply,
+                           Position &leaf) const
+{
+    float best = evaluate(pos);
+    leaf = pos;
+    if (best >= beta || ply >= MAX_QUIESCE_PLY) {
+        return best;
+    }
+    alpha = std::max(alpha, best);
+
+    FastMoves moves;
+    pos.legalMoves(moves);
+    // Most valuable victim first, then least valuable attacker
+    vector<std::pair<PieceValue, FastMove>> tactical{};
+    for (const FastMove &move : moves) {
+        bool isPromotion = move.isPromotion();
+        if (isPromotion && move.promotionType() != PieceType::Queen) {
+            continue;
+        }
+        if (!pos.isCapture(move) && !isPromotion) {
+            continue;
+        }
+        PieceValue victim = 0;
+        if (!pos.isEmpty(move.to())) {
+            victim = Piece::pieceValue(pos.pieceTypeAt(move.to()));
+        } else if (!isPromotion) { // En passant
+            victim = Piece::pieceValue(PieceType::Pawn);
+        }
+        if (isPromotion) {
+            victim += Piece::pieceValue(PieceType::Queen);
+        }
+        PieceValue attacker = Piece::pieceValue(pos.pieceTypeAt(move.from()));
+        tactical.emplace_back(16 * victim - attacker, move);
+    }
+    std::stable_sort(tactical.begin(), tactical.end(),
+                     [](const auto &a, const auto &b) {
+                         return a.first > b.first;
+                     });
+
+    Position childLeaf{};
+    for (const auto &[order, move] : tactical) {
+        PositionUndo undo;
+        pos.makeMove(move, undo);
+        float score = -_quiesce(pos, -beta, -alpha, ply + 1, childLeaf);
+        pos.unmakeMove(move, undo);
+        if (score > best) {
+            best = score;
+            if (score > alpha) {
+                alpha = score;
+                leaf = childLeaf;
+                if (score >= beta) {
+                    break;
+                }
+            }
+        }
+    }
+    return best;
+}
+
+double TexelTuner::_error(float scale) const {
+    vector<double> errors(_poolP->size(), 0.0);
+    _poolP->parallelFor(_positions.size(), [&](std::size_t k, Short worker) {
+        const Entry &entry = _positions[k];
+        float eval = _evaluate(&_terms[entry.firstTerm], entry.termCount,
+                               entry.phase);
+        float diff = expectedResult(eval, scale) - entry.result;
+        errors[worker] += diff * diff;
+    }, 1024);
+    double errorSum = 0.0;
+    for (double e : errors) {
+        errorSum += e;
+    }
+    return errorSum / std::max<std::size_t>(_positions.size(), 1);
+}
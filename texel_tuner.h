@@ -0,0 +1,117 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "eval.h"
+#include "position.h"
+#include "thread_pool.h"
+#include "training_data.h"
+#include "util.h"
+
+// Write params in the format of eval_params.h. source says where they came
+// from, for the comment at the top.
+void writeEvalParams(std::ostream &os, const EvalParams &params,
+                     const std::string &source);
+
+struct TexelTunerConfig {
+    float learningRate = 1.0f; // Adam step size, in centipawns
+    float scale = DEFAULT_SCORE_SCALE; // Of expectedResult, until fitScale
+};
+
+// One term of the evaluation of a position: How many more times it applies
+// to White than to Black. param is the middlegame EvalParams index; the
+// endgame one follows from it.
+struct TexelTerm {
+    std::uint16_t param;
+    std::int16_t count;
+};
+
+// ========================================
+// TexelTuner
+//
+// Fits EvalParams to game results, by Texel's tuning method: Minimize the
+// mean squared difference between the result of each position and the
+// expected result of its evaluation, expectedResult(eval, scale).
+//
+// Each position is first resolved by a quiescence search (captures and
+// promotions), and the quiet position at the end of its principal variation
+// is kept. Its evaluation is linear in the parameters, so the tuner stores
+// only its phase and a short list of TexelTerms, which makes the gradient
+// exact and cheap. Positions and gradients are split across the workers of
+// a ThreadPool, which sum the gradient in their own buffers.
+class TexelTuner {
+  public:
+    // ---------- Constructor
+    TexelTuner(ThreadPool &pool,
+               const TexelTunerConfig &config = TexelTunerConfig{},
+               const EvalParams &params = EVAL_PARAMS);
+
+    // ---------- Read methods
+    std::size_t size() const { return _positions.size(); }
+    float scale() const { return _config.scale; }
+    // Centipawns, side to move, by the current (unrounded) parameters.
+    float evaluate(const Position &pos) const;
+    double error() const; // Mean squared error over the positions
+    EvalParams params() const; // Rounded to centipawns
+    long long steps() const { return _step; }
+
+    // ---------- Write methods
+    void addPositions(const std::vector<LabeledPosition> &batch);
+    // Choose the scale that minimizes the error with the current parameters,
+    // so that tuning does not just stretch the evaluation. Returns the error.
+    double fitScale();
+    // One Adam step over all positions. Returns the error before the step.
+    double step();
+
+  private:
+    // A resolved position, as a range of _terms.
+    struct Entry {
+        float result; // White's
+        std::uint32_t firstTerm;
+        std::uint8_t termCount;
+        std::uint8_t phase; // Capped at PHASE_MAX
+    };
+
+    // ---------- Private read methods
+    // Terms of pos, merged by param; returns the phase.
+    Short _collectTerms(const Position &pos,
+                        std::vector<TexelTerm> &terms) const;
+    float _evaluate(const TexelTerm *terms, Short count, Short phase) const;
+    float _quiesce(Position &pos, float alpha, float beta, Short ply,
+                   Position &leaf) const;
+    double _error(float scale) const;
+
+    ThreadPool *_poolP;
+    TexelTunerConfig _config;
+    long long _step;
+
+    std::vector<float> _params;
+    std::vector<int> _egParams; // Per middlegame param, or NO_EVAL_PARAM
+    std::vector<float> _m; // Adam moments
+    std::vector<float> _v;
+    std::vector<std::vector<double>> _workerGrads;
+
+    std::vector<Entry> _positions;
+    std::vector<TexelTerm> _terms;
+};
@@ -0,0 +1,81 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "thread_pool.h"
+
+// ---------- Constructor / Destructor
+ThreadPool::ThreadPool(Short size /* =0 */)
+    : _threads{}, _mutex{}, _jobReady{}, _jobDone{}, _jobP{nullptr},
+      _jobCount{0}, _pendingCount{0}, _isStopping{false}
+{
+    if (size <= 0) {
+        size = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (Short worker = 1; worker < size; ++worker) {
+        _threads.emplace_back(&ThreadPool::_workerLoop, this, worker);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _isStopping = true;
+    }
+    _jobReady.notify_all();
+    for (std::thread &thread : _threads) {
+        thread.join();
+    }
+}
+
+// ---------- Public methods
+void ThreadPool::run(const std::function<void(Short worker)> &job) {
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _jobP = &job;
+        ++_jobCount;
+        _pendingCount = Short(_threads.size());
+    }
+    _jobReady.notify_all();
+    job(0);
+    std::unique_lock<std::mutex> lock{_mutex};
+    _jobDone.wait(lock, [this] { return _pendingCount == 0; });
+    _jobP = nullptr;
+}
+
+// ---------- Private methods
+void ThreadPool::_workerLoop(Short worker) {
+    unsigned long jobsSeen = 0;
+    for (;;) {
+        const std::function<void(Short)> *jobP;
+        {
+            std::unique_lock<std::mutex> lock{_mutex};
+            _jobReady.wait(lock, [&] {
+                return _isStopping || _jobCount != jobsSeen;
+            });
+            if (_isStopping) {
+                return;
+            }
+            jobsSeen = _jobCount;
+            jobP = _jobP;
+        }
+        (*jobP)(worker);
+        std::lock_guard<std::mutex> lock{_mutex};
+        if (--_pendingCount == 0) {
+            _jobDone.notify_one();
+        }
+    }
+}
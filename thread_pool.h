@@ -0,0 +1,80 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "util.h"
+
+// ========================================
+// ThreadPool
+//
+// A fixed set of threads that run one job at a time, e.g., a parallel loop
+// over the positions of a batch. The calling thread takes part as worker 0,
+// so a pool of size 1 runs everything inline. Jobs get the worker index, to
+// use per-worker buffers without locking.
+class ThreadPool {
+  public:
+    ThreadPool(Short size = 0); // 0: One worker per hardware thread
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    Short size() const { return Short(_threads.size()) + 1; }
+
+    // Call job(worker) once on each worker, and wait for all of them.
+    void run(const std::function<void(Short worker)> &job);
+
+    // Call f(i, worker) for each i in [0, count). Workers claim chunks of
+    // grain indexes as they go, so uneven items even out.
+    template <typename F>
+    void parallelFor(std::size_t count, F &&f, std::size_t grain = 1) {
+        std::atomic<std::size_t> next{0};
+        run([&](Short worker) {
+            for (;;) {
+                std::size_t begin = next.fetch_add(grain);
+                if (begin >= count) {
+                    return;
+                }
+                std::size_t end = std::min(begin + grain, count);
+                for (std::size_t i = begin; i < end; ++i) {
+                    f(i, worker);
+                }
+            }
+        });
+    }
+
+  private:
+    void _workerLoop(Short worker);
+
+    std::vector<std::thread> _threads;
+    std::mutex _mutex;
+    std::condition_variable _jobReady;
+    std::condition_variable _jobDone;
+    const std::function<void(Short)> *_jobP;
+    unsigned long _jobCount; // Jobs started, to wake each worker once per job
+    Short _pendingCount;     // Workers still running the current job
+    bool _isStopping;
+};
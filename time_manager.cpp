@@ -0,0 +1,86 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+
+#include "clock.h"
+#include "time_manager.h"
+#include "util.h"
+
+// Expected number of moves still to be made with the remaining time.
+constexpr Short MOVES_TO_GO = 25;
+// Time the search cannot see: Move generation by Game, output, and the
+// delay in noticing that the hard limit was reached.
+constexpr Millis MOVE_OVERHEAD{30};
+constexpr Short HARD_LIMIT_FACTOR = 4;   // Hard limit vs soft limit
+constexpr double HARD_LIMIT_MAX_SHARE = 0.5; // Of the available time
+
+// ========================================
+// TimeManager
+
+// ---------- Constructor
+TimeManager::TimeManager()
+    : _isLimited{false}, _startTime{SteadyClock::now()}, _softLimit{0},
+      _hardLimit{0}, _stableIterations{0}
+{}
+
+// ---------- Public read methods
+Millis TimeManager::elapsed() const {
+    return std::chrono::duration_cast<Millis>(SteadyClock::now()
+                                              - _startTime);
+}
+
+bool TimeManager::isHardLimitReached() const {
+    return _isLimited && elapsed() >= _hardLimit;
+}
+
+// The next iteration usually takes longer than all the previous ones, so
+// it is not started once most of the (scaled) soft limit is gone.
+bool TimeManager::shouldStartIteration() const {
+    if (!_isLimited) {
+        return true;
+    }
+    static const double stability2scale[] = {1.6, 1.0, 0.8, 0.6};
+    double scale = stability2scale[std::min(_stableIterations, Short(3))];
+    return elapsed().count() < scale * _softLimit.count();
+}
+
+// ---------- Public write methods
+void TimeManager::start(Millis remaining, Millis increment) {
+    _isLimited = true;
+    _startTime = SteadyClock::now();
+    _stableIterations = 0;
+
+    Millis available = std::max(remaining - MOVE_OVERHEAD, Millis{1});
+    _softLimit = std::min(available / MOVES_TO_GO + increment * 3 / 4,
+                          available / HARD_LIMIT_FACTOR);
+    _softLimit = std::max(_softLimit, Millis{1});
+    _hardLimit = std::min(_softLimit * HARD_LIMIT_FACTOR,
+                          Millis{Millis::rep(HARD_LIMIT_MAX_SHARE
+                                             * available.count())});
+    _hardLimit = std::max(_hardLimit, _softLimit);
+}
+
+void TimeManager::startUnlimited() {
+    _isLimited = false;
+    _startTime = SteadyClock::now();
+    _stableIterations = 0;
+    _softLimit = _hardLimit = Millis{0};
+}
+
+void TimeManager::onIterationDone(bool hasBestMoveChanged) {
+    _stableIterations = hasBestMoveChanged ? 0 : _stableIterations + 1;
+}
@@ -0,0 +1,55 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "clock.h"
+#include "util.h"
+
+// ========================================
+// TimeManager
+
+// Allocates a searching bot's time for one move, from its remaining clock
+// time and increment:
+//   * Soft limit: Iterative deepening starts no new iteration after this.
+//                 It is scaled down while the best move stays the same, and
+//                 up when it has just changed.
+//   * Hard limit: The search stops, even in mid-iteration. It always leaves
+//                 a safety margin, so that the bot does not lose on time.
+class TimeManager {
+  public:
+    TimeManager();
+
+    // ---------- Public read methods
+    bool isLimited() const { return _isLimited; }
+    Millis elapsed() const;
+    Millis softLimit() const { return _softLimit; }
+    Millis hardLimit() const { return _hardLimit; }
+    bool isHardLimitReached() const;
+    bool shouldStartIteration() const;
+
+    // ---------- Public write methods
+    void start(Millis remaining, Millis increment);
+    void startUnlimited();
+    void onIterationDone(bool hasBestMoveChanged);
+
+  private:
+    bool _isLimited;
+    SteadyClock::time_point _startTime;
+    Millis _softLimit;
+    Millis _hardLimit;
+    Short _stableIterations; // Iterations since the best move last changed
+};
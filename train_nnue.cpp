@@ -0,0 +1,142 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <libgen.h>
+
+#include "clock.h"
+#include "nnue.h"
+#include "nnue_trainer.h"
+#include "thread_pool.h"
+#include "training_data.h"
+#include "util.h"
+
+using std::cerr, std::cout;
+using std::string, std::vector;
+
+// Trains an NNUE network (see nnue.h) from a file of labeled positions (see
+// training_data.h), streamed a batch at a time, and writes the quantized
+// network after each epoch.
+int main(int argc, char **argv) {
+    string progname{basename(argv[0])};
+    vector<string> args(argv + 1, argv + argc);
+    string usage = "Usage: " + progname
+        + " <data_file> <network_file> [-e <epochs>] [-b <batch_size>]\n"
+          "       [-l <learning_rate>] [-j <threads>] [-i <initial_network>]"
+          "\n";
+    if (args.size() < 2) {
+        cerr << progname << ": " << usage;
+        exit(1);
+    }
+    string dataPath = args[0];
+    string networkPath = args[1];
+    int epochs = 1;
+    std::size_t batchSize = 16384;
+    Short threads = 0; // All hardware threads
+    NnueTrainerConfig config{};
+    std::optional<string> initialPath{};
+    try {
+        for (std::size_t k = 2; k + 1 < args.size(); k += 2) {
+            const string &value = args[k + 1];
+            if (args[k] == "-e") {
+                epochs = std::stoi(value);
+            } else if (args[k] == "-b") {
+                batchSize = std::stoul(value);
+            } else if (args[k] == "-l") {
+                config.learningRate = std::stof(value);
+            } else if (args[k] == "-j") {
+                threads = std::stoi(value);
+            } else if (args[k] == "-i") {
+                initialPath = value;
+            } else {
+                throw std::invalid_argument{args[k]};
+            }
+        }
+    } catch (std::exception &ex) {
+        cerr << progname << ": Bad argument: " << ex.what() << "\n" << usage;
+        exit(1);
+    }
+    if (args.size() % 2 != 0 || batchSize == 0) {
+        cerr << progname << ": " << usage;
+        exit(1);
+    }
+
+    TrainingDataReader reader{dataPath};
+    if (!reader.isOpen()) {
+        cerr << progname << ": Cannot read " << dataPath << "\n";
+        exit(1);
+    }
+    ThreadPool pool{threads};
+    NnueTrainer trainer{pool, config};
+    if (initialPath) {
+        if (!Nnue::load(*initialPath)) {
+            cerr << progname << ": Cannot load network: " << *initialPath
+                 << "\n";
+            exit(1);
+        }
+        trainer.load(*Nnue::active());
+    }
+    cout << "threads=" << pool.size() << ", batch=" << batchSize
+         << ", learning_rate=" << config.learningRate << "\n";
+
+    vector<string> lines{};
+    vector<std::optional<LabeledPosition>> parsed{};
+    vector<LabeledPosition> batch{};
+    for (int epoch = 1; epoch <= epochs; ++epoch) {
+        SteadyClock::time_point start = SteadyClock::now();
+        long long positions = 0;
+        long long skipped = 0;
+        double lossSum = 0.0;
+        reader.rewind();
+        while (reader.readLines(lines, batchSize) > 0) {
+            // Parsing FENs costs about as much as training on them.
+            parsed.assign(lines.size(), std::nullopt);
+            pool.parallelFor(lines.size(), [&](std::size_t k, Short) {
+                parsed[k] = parseLabeledPosition(lines[k]);
+            }, 256);
+            batch.clear();
+            for (const std::optional<LabeledPosition> &oLabeled : parsed) {
+                if (oLabeled) {
+                    batch.push_back(*oLabeled);
+                } else {
+                    ++skipped;
+                }
+            }
+            lossSum += trainer.trainBatch(batch) * batch.size();
+            positions += batch.size();
+        }
+        Millis elapsed =
+            std::chrono::duration_cast<Millis>(SteadyClock::now() - start);
+        cout << "epoch " << epoch << ": positions=" << positions
+             << ", skipped=" << skipped << std::fixed << std::setprecision(5)
+             << ", loss=" << (positions > 0 ? lossSum / positions : 0.0)
+             << std::setprecision(0) << ", positions/s="
+             << positions * 1000.0 / std::max(1LL, (long long)elapsed.count())
+             << std::defaultfloat << "\n";
+        if (!trainer.quantize()->save(networkPath)) {
+            cerr << progname << ": Cannot write " << networkPath << "\n";
+            exit(1);
+        }
+    }
+    cout << "Wrote " << networkPath << "\n";
+}
@@ -0,0 +1,85 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <cmath>
+
+#include "training_data.h"
+
+using std::string;
+
+float expectedResult(float score, float scale /* =DEFAULT_SCORE_SCALE */) {
+    return 1.0f / (1.0f + std::exp(-score / scale));
+}
+
+std::optional<LabeledPosition> parseLabeledPosition(const string &line) {
+    std::size_t sep = line.rfind(';');
+    if (sep == string::npos) {
+        return std::nullopt;
+    }
+    std::optional<Position> oPos = Position::fromFen(line.substr(0, sep));
+    if (!oPos) {
+        return std::nullopt;
+    }
+    string label = line.substr(sep + 1);
+    label.erase(0, label.find_first_not_of(" \t"));
+    label.erase(label.find_last_not_of(" \t\r") + 1);
+    if (label == "1-0") {
+        return LabeledPosition{*oPos, 1.0f};
+    }
+    if (label == "0-1") {
+        return LabeledPosition{*oPos, 0.0f};
+    }
+    if (label == "1/2-1/2") {
+        return LabeledPosition{*oPos, 0.5f};
+    }
+    try {
+        std::size_t end;
+        float score = std::stof(label, &end);
+        if (end != label.size()) {
+            return std::nullopt;
+        }
+        return LabeledPosition{*oPos, expectedResult(score)};
+    } catch (std::exception &) {
+        return std::nullopt;
+    }
+}
+
+// ========================================
+// TrainingDataReader
+
+// ---------- Constructor
+TrainingDataReader::TrainingDataReader(const string &path) : _is{path} {}
+
+// ---------- Methods
+std::size_t TrainingDataReader::readLines(std::vector<string> &lines,
+                                          std::size_t count)
+{
+    lines.clear();
+    string line;
+    while (lines.size() < count && std::getline(_is, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        lines.push_back(std::move(line));
+    }
+    return lines.size();
+}
+
+void TrainingDataReader::rewind() {
+    _is.clear();
+    _is.seekg(0);
+}
@@ -0,0 +1,63 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "position.h"
+#include "util.h"
+
+// ========================================
+// Training data
+//
+// Labeled positions, one per line: "<FEN>;<label>", where the label is a
+// game result (1-0, 1/2-1/2 or 0-1) or a score in centipawns, from White's
+// point of view. Blank lines and lines starting with '#' are skipped.
+
+// Scores map to expected results by a logistic curve: +scale centipawns is
+// an expected result of about 0.73.
+constexpr float DEFAULT_SCORE_SCALE = 400.0f;
+
+float expectedResult(float score, float scale = DEFAULT_SCORE_SCALE);
+
+struct LabeledPosition {
+    Position pos;
+    float result; // White's expected result, from 0 (loss) to 1 (win)
+};
+
+std::optional<LabeledPosition> parseLabeledPosition(const std::string &line);
+
+// Reads a training file a chunk at a time, so that files much larger than
+// memory can be used, once per epoch.
+class TrainingDataReader {
+  public:
+    TrainingDataReader(const std::string &path);
+
+    bool isOpen() const { return _is.is_open(); }
+    // Replace lines with up to count data lines. Returns how many were read:
+    // Fewer than count at the end of the file.
+    std::size_t readLines(std::vector<std::string> &lines, std::size_t count);
+    void rewind(); // For the next epoch
+
+  private:
+    std::ifstream _is;
+};
@@ -0,0 +1,83 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "transposition.h"
+#include "util.h"
+
+// ---------- Static public methods
+Score TranspositionTable::scoreToTT(Score score, Short ply) {
+    if (score >= SCORE_TB_WIN_BOUND) {
+        return score + ply;
+    }
+    if (score <= -SCORE_TB_WIN_BOUND) {
+        return score - ply;
+    }
+    return score;
+}
+
+Score TranspositionTable::scoreFromTT(Score score, Short ply) {
+    if (score >= SCORE_TB_WIN_BOUND) {
+        return score - ply;
+    }
+    if (score <= -SCORE_TB_WIN_BOUND) {
+        return score + ply;
+    }
+    return score;
+}
+
+// ---------- Constructor
+TranspositionTable::TranspositionTable(Short sizeLog2 /* =16 */)
+    : _entries(std::size_t{1} << sizeLog2), _mask{(Hash{1} << sizeLog2) - 1},
+      _probes{0}, _hits{0}
+{}
+
+// ---------- Read methods
+const TTEntry *TranspositionTable::probe(Hash key) const {
+    ++_probes;
+    const TTEntry &entry = _entries[key & _mask];
+    if (entry.bound == Bound::None || entry.key != key) {
+        return nullptr;
+    }
+    ++_hits;
+    return &entry;
+}
+
+// ---------- Write methods
+
+// Replacement: Keep the deeper result for the same position; always replace
+// entries for other positions.
+void TranspositionTable::store(Hash key, Score score, Short depth, Bound bound,
+                               MoveCode moveCode, Short ply)
+{
+    TTEntry &entry = _entries[key & _mask];
+    if (entry.key == key && depth < entry.depth && bound != Bound::Exact) {
+        return;
+    }
+    if (entry.key == key && moveCode == NO_MOVE_CODE) {
+        moveCode = entry.moveCode; // Keep the old best move
+    }
+    entry.key = key;
+    entry.score = scoreToTT(score, ply);
+    entry.depth = depth;
+    entry.bound = bound;
+    entry.moveCode = moveCode;
+}
+
+void TranspositionTable::clear() {
+    std::fill(_entries.begin(), _entries.end(), TTEntry{});
+    _probes = 0;
+    _hits = 0;
+}
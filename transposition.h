@@ -0,0 +1,76 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <vector>
+
+#include "move_order.h"
+#include "util.h"
+
+// Search scores are in centipawns, from the viewpoint of the side to move.
+using Score = int;
+
+constexpr Score SCORE_INFINITE = 1'000'000;
+constexpr Score SCORE_MATE = 100'000;
+constexpr Score SCORE_MATE_BOUND = SCORE_MATE - MAX_PLY; // |score| >= this: mate
+// Won according to the tablebases, at the ply of the probe: Above every
+// evaluation, below every mate found by search.
+constexpr Score SCORE_TB_WIN = SCORE_MATE_BOUND - 1;
+constexpr Score SCORE_TB_WIN_BOUND = SCORE_TB_WIN - MAX_PLY; // Mate or TB win
+
+enum class Bound : unsigned char { None, Exact, Lower, Upper };
+
+struct TTEntry {
+    Hash key = 0;
+    Score score = 0;
+    Short depth = -1;
+    Bound bound = Bound::None;
+    MoveCode moveCode = NO_MOVE_CODE;
+};
+
+// ========================================
+// TranspositionTable
+
+// Fixed-size, direct-mapped table of search results keyed by Zobrist hash.
+// Mate scores (and tablebase wins) are stored relative to the node, not the
+// root, so that they remain valid when the same position is reached at a
+// different ply.
+class TranspositionTable {
+  public:
+    static Score scoreToTT(Score score, Short ply);
+    static Score scoreFromTT(Score score, Short ply);
+
+    TranspositionTable(Short sizeLog2 = 16);
+
+    // ---------- Read methods
+    const TTEntry *probe(Hash key) const;
+    std::size_t size() const { return _entries.size(); }
+    long long probes() const { return _probes; }
+    long long hits() const { return _hits; }
+
+    // ---------- Write methods
+    void store(Hash key, Score score, Short depth, Bound bound,
+               MoveCode moveCode, Short ply);
+    void clear();
+
+  private:
+    std::vector<TTEntry> _entries;
+    Hash _mask;
+
+    mutable long long _probes;
+    mutable long long _hits;
+};
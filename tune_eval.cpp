@@ -0,0 +1,142 @@
+// Games_Chess
+// Copyright (C) 2021, by Jay M. Coskey
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <libgen.h>
+
+#include "clock.h"
+#include "texel_tuner.h"
+#include "thread_pool.h"
+#include "training_data.h"
+#include "util.h"
+
+using std::cerr, std::cout;
+using std::string, std::vector;
+
+// Tunes the evaluation parameters (see eval.h) on a file of positions labeled
+// with game results (see training_data.h), and writes them in the format of
+// eval_params.h. To use them, replace eval_params.h and rebuild.
+int main(int argc, char **argv) {
+    string progname{basename(argv[0])};
+    vector<string> args(argv + 1, argv + argc);
+    string usage = "Usage: " + progname
+        + " <data_file> <header_file> [-i <iterations>] [-l <learning_rate>]"
+          "\n       [-j <threads>] [-k <scale>]\n";
+    if (args.size() < 2) {
+        cerr << progname << ": " << usage;
+        exit(1);
+    }
+    string dataPath = args[0];
+    string headerPath = args[1];
+    int iterations = 1000;
+    Short threads = 0; // All hardware threads
+    TexelTunerConfig config{};
+    bool isScaleFixed = false;
+    try {
+        for (std::size_t k = 2; k + 1 < args.size(); k += 2) {
+            const string &value = args[k + 1];
+            if (args[k] == "-i") {
+                iterations = std::stoi(value);
+            } else if (args[k] == "-l") {
+                config.learningRate = std::stof(value);
+            } else if (args[k] == "-j") {
+                threads = std::stoi(value);
+            } else if (args[k] == "-k") {
+                config.scale = std::stof(value);
+                isScaleFixed = true;
+            } else {
+                throw std::invalid_argument{args[k]};
+            }
+        }
+    } catch (std::exception &ex) {
+        cerr << progname << ": Bad argument: " << ex.what() << "\n" << usage;
+        exit(1);
+    }
+    if (args.size() % 2 != 0) {
+        cerr << progname << ": " << usage;
+        exit(1);
+    }
+
+    TrainingDataReader reader{dataPath};
+    if (!reader.isOpen()) {
+        cerr << progname << ": Cannot read " << dataPath << "\n";
+        exit(1);
+    }
+    ThreadPool pool{threads};
+    TexelTuner tuner{pool, config};
+
+    // Load everything, resolving each position by quiescence search.
+    SteadyClock::time_point start = SteadyClock::now();
+    constexpr std::size_t CHUNK_SIZE = 65536;
+    vector<string> lines{};
+    vector<std::optional<LabeledPosition>> parsed{};
+    vector<LabeledPosition> chunk{};
+    long long skipped = 0;
+    while (reader.readLines(lines, CHUNK_SIZE) > 0) {
+        parsed.assign(lines.size(), std::nullopt);
+        pool.parallelFor(lines.size(), [&](std::size_t k, Short) {
+            parsed[k] = parseLabeledPosition(lines[k]);
+        }, 256);
+        chunk.clear();
+        for (const std::optional<LabeledPosition> &oLabeled : parsed) {
+            if (oLabeled) {
+                chunk.push_back(*oLabeled);
+            } else {
+                ++skipped;
+            }
+        }
+        tuner.addPositions(chunk);
+    }
+    if (tuner.size() == 0) {
+        cerr << progname << ": No positions in " << dataPath << "\n";
+        exit(1);
+    }
+    Millis elapsed =
+        std::chrono::duration_cast<Millis>(SteadyClock::now() - start);
+    double error = isScaleFixed ? tuner.error() : tuner.fitScale();
+    cout << "threads=" << pool.size() << ", positions=" << tuner.size()
+         << ", skipped=" << skipped << ", load_ms=" << elapsed.count()
+         << ", scale=" << tuner.scale() << std::fixed << std::setprecision(6)
+         << ", error=" << error << std::defaultfloat << "\n";
+
+    for (int iteration = 1; iteration <= iterations; ++iteration) {
+        error = tuner.step();
+        if (iteration % 100 == 0 || iteration == iterations) {
+            cout << "iteration " << iteration << ": error=" << std::fixed
+                 << std::setprecision(6) << error << std::defaultfloat
+                 << "\n";
+        }
+    }
+
+    std::ofstream os{headerPath};
+    writeEvalParams(os, tuner.params(),
+                    dataPath + ", " + std::to_string(tuner.size())
+                        + " positions, " + std::to_string(iterations)
+                        + " iterations");
+    if (!os) {
+        cerr << progname << ": Cannot write " << headerPath << "\n";
+        exit(1);
+    }
+    cout << "Wrote " << headerPath << "\n";
+}
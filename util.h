@@ -18,6 +18,7 @@
 
 #include <iostream>
 #include <map>
+#include <optional>
 #include <random>
 #include <set>
 #include <vector>